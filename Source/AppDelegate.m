@@ -422,6 +422,18 @@
 }
 
 
+- (IBAction) exportAllAudio:(id)sender
+{
+    ExportAudioController *exportAudioController = [[ExportAudioController alloc] init];
+
+    NSArray *presets = [[PresetManager sharedInstance] enabledPresets];
+
+    if ([presets count] > 0) {
+        [exportAudioController presentOpenPanelForPresets:presets];
+    }
+}
+
+
 - (IBAction) showMainWindow:(id)sender
 {
     [[self mainWindowController] showWindow:self];
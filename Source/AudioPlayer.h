@@ -3,6 +3,8 @@
 
 @import Foundation;
 
+#import "Meter.h"
+
 @class Preset;
 
 extern NSString * const AudioPlayerDidUpdateNotificationName;
@@ -24,6 +26,8 @@ extern NSString * const AudioPlayerDidUpdateNotificationName;
 
 - (void) terminate;
 
+// Setting a preset builds its program on a background queue. The previous
+// program keeps playing until the new one is ready; error updates then.
 @property (nonatomic) Preset *preset;
 
 @property (nonatomic) double volume;
@@ -35,4 +39,8 @@ extern NSString * const AudioPlayerDidUpdateNotificationName;
 
 @property (nonatomic, getter=isMuted) BOOL muted;
 
+// Returns NO unless the meteringEnabled setting is on and a measurement exists.
+// Does not lock, but must be called on the main thread.
+- (BOOL) getMeterSnapshot:(MeterSnapshot *)outSnapshot;
+
 @end
@@ -5,12 +5,16 @@
 
 #import "AppDelegate.h"
 #import "Biquad.h"
+#import "FloatingPoint.h"
 #import "NoisyProgram.h"
 #import "Preset.h"
 #import "Ramper.h"
+#import "RenderAhead.h"
+#import "Resampler.h"
 #import "StereoField.h"
 #import "Utils.h"
 #import "Settings.h"
+#import "WorkerPool.h"
 
 #include <stdatomic.h>
 
@@ -20,6 +24,9 @@
 
 static NSTimeInterval sTerminateTime = 0.05;
 
+// Frames the render ahead thread renders per call
+static const size_t sRenderAheadChunkFrameCount = 1024;
+
 typedef struct {
     volatile float volume;
     volatile float stereoWidth;
@@ -31,6 +38,12 @@ typedef struct {
     _Atomic(NoisyProgram *) nextProgram;
     
     Ramper *ramper;
+    Resampler *resampler;
+    RenderAhead *renderAhead;
+    Meter *meter;
+
+    // Renders in which a subnormal value was flushed to zero
+    _Atomic(uint64_t) denormalEvents;
 } RenderData;
 
 
@@ -48,10 +61,22 @@ NSString * const AudioPlayerDidUpdateNotificationName = @"AudioPlayerDidUpdateNo
     AVAudioEngine *_audioEngine;
     
     BOOL _terminating;
+
+    // The program runs at _activeSampleRate (the engine rate), which is
+    // resampled to _deviceSampleRate when they differ.
     double _activeSampleRate;
+    double _deviceSampleRate;
     NSError *_error;
     
     NSTimeInterval _programModifiedTimeInterval;
+
+    // Programs are built on _programQueue. Each request increments _programGeneration,
+    // which cancels older builds at their next checkpoint.
+    dispatch_queue_t _programQueue;
+    _Atomic(uint64_t) _programGeneration;
+
+    // Shared by every program. Lives as long as the player.
+    WorkerPool *_workerPool;
     
     AudioUnit _outputAudioUnit;
 }
@@ -75,8 +100,19 @@ NSString * const AudioPlayerDidUpdateNotificationName = @"AudioPlayerDidUpdateNo
     if ((self = [super init])) {
         _renderData.ramper = RamperCreate();
 
+        dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+        _programQueue = dispatch_queue_create("AudioPlayer.program", attr);
+
         // Restore persisted settings
         Settings *settings = [Settings sharedInstance];
+
+        // The render thread works alongside the pool, so leave it a processor
+        NSInteger processorCount = [[NSProcessInfo processInfo] activeProcessorCount];
+        NSInteger workerCount = MIN([settings renderWorkerCount], processorCount - 1);
+
+        if (workerCount > 0) {
+            _workerPool = WorkerPoolCreate(workerCount);
+        }
         
         [self setVolume:[settings volume]];
         [self setStereoWidth:[settings stereoWidth]];
@@ -96,6 +132,68 @@ NSString * const AudioPlayerDidUpdateNotificationName = @"AudioPlayerDidUpdateNo
 
 #pragma mark - Private Methods
 
+static NoisyProgram *sAdoptNextProgram(RenderData *renderData)
+{
+    NoisyProgram *program     = atomic_load(&renderData->program);
+    NoisyProgram *nextProgram = atomic_load(&renderData->nextProgram);
+
+    if (program != nextProgram) {
+        atomic_store(&renderData->program, nextProgram);
+        program = nextProgram;
+    }
+
+    return program;
+}
+
+
+// Renders the active program with its auto gain applied.
+// Called from the device callback, or from the render ahead thread when enabled.
+static void sRenderProgram(void *context, float *left, float *right, size_t frameCount)
+{
+    RenderData *renderData = (RenderData *)context;
+
+    NoisyProgram *program = sAdoptNextProgram(renderData);
+
+    if (!program) {
+        memset(left,  0, sizeof(float) * frameCount);
+        memset(right, 0, sizeof(float) * frameCount);
+
+        return;
+    }
+
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+    FloatingPointTestAndClearDenormals();
+
+    NoisyProgramProcess(program, left, right, frameCount);
+
+    if (FloatingPointTestAndClearDenormals()) {
+        atomic_fetch_add_explicit(&renderData->denormalEvents, 1, memory_order_relaxed);
+    }
+
+    FloatingPointRestore(&floatingPointState);
+
+    NoisyProgramApplyAutoGain(program, left, right, frameCount);
+
+    if (NoisyProgramGetChannelCount(program) == 1) {
+        memcpy(right, left, sizeof(float) * frameCount);
+    }
+}
+
+
+// Renders at the engine rate, resampled to the device rate when they differ
+static void sRenderEngine(void *context, float *left, float *right, size_t frameCount)
+{
+    RenderData *renderData = (RenderData *)context;
+
+    if (renderData->resampler) {
+        ResamplerRead(renderData->resampler, left, right, frameCount);
+    } else {
+        sRenderProgram(context, left, right, frameCount);
+    }
+}
+
+
 static OSStatus sRender(
     void *inRefCon,
     AudioUnitRenderActionFlags *ioActionFlags,
@@ -106,44 +204,50 @@ static OSStatus sRender(
 ) {
     RenderData *renderData = (RenderData *)inRefCon;
 
-    NoisyProgram *program     = atomic_load(&renderData->program);
-    NoisyProgram *nextProgram = atomic_load(&renderData->nextProgram);
-
-    if (program != nextProgram) {
-        atomic_store(&renderData->program, nextProgram);
-        program = nextProgram;
-    }
-
     float *left  = ioData->mBuffers[0].mData;
     float *right = ioData->mBuffers[1].mData;
 
-    if (!program) {
+    RenderAhead *renderAhead = renderData->renderAhead;
+
+    if (renderAhead) {
+        RenderAheadRead(renderAhead, left, right, inNumberFrames);
+
+    } else if (RamperIsSilent(renderData->ramper)) {
+        // Faded out, either muted or waiting for _reallyStopOutput. Skip the program,
+        // but keep adopting nextProgram so that _remakeProgram doesn't stall.
+        sAdoptNextProgram(renderData);
+
         memset(left,  0, sizeof(float) * inNumberFrames);
         memset(right, 0, sizeof(float) * inNumberFrames);
 
-        return noErr;
-    }
+        if (renderData->meter) {
+            MeterWrite(renderData->meter, left, right, inNumberFrames);
+        }
 
-    NoisyProgramProcess(program, left, right, inNumberFrames);
+        *ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
 
-    if (NoisyProgramGetChannelCount(program) == 1) {
-        RamperProcess(renderData->ramper, left, NULL, inNumberFrames);
-        memcpy(right, left, sizeof(float) * inNumberFrames);
+        return noErr;
 
     } else {
-        RamperProcess(renderData->ramper, left, right, inNumberFrames);
-        ApplyStereoFieldWidth(renderData->stereoWidth, left, right, inNumberFrames);
+        sRenderEngine(renderData, left, right, inNumberFrames);
     }
 
-    float leftAutoGain;
-    float rightAutoGain;
-    NoisyProgramGetAutoGain(program, &leftAutoGain, &rightAutoGain);
+    // Fades, width, volume, and balance are applied here rather than in
+    // sRenderProgram() so that they stay immediate when rendering ahead.
+    // Width is a no-op for mono programs, as both channels are identical.
+    // Auto gain was applied by sRenderProgram(), so with separate auto gain,
+    // width mixes the already normalized channels.
+    RamperProcess(renderData->ramper, left, right, inNumberFrames);
+    ApplyStereoFieldWidth(renderData->stereoWidth, left, right, inNumberFrames);
 
-    float leftVolume    = renderData->volume * leftAutoGain;
-    float rightVolume   = renderData->volume * rightAutoGain;
+    float volume        = renderData->volume;
     float stereoBalance = renderData->stereoBalance;
 
-    ApplyStereoFieldVolumeAndBalance(leftVolume, rightVolume, stereoBalance, left, right, inNumberFrames);
+    ApplyStereoFieldVolumeAndBalance(volume, volume, stereoBalance, left, right, inNumberFrames);
+
+    if (renderData->meter) {
+        MeterWrite(renderData->meter, left, right, inNumberFrames);
+    }
 
     return noErr;
 }
@@ -337,8 +441,29 @@ static void sHandleStreamFormatChanged(
         @"AudioUnitInitialize"
     );
     
-    _activeSampleRate = sampleRate;
-    [self _remakeProgram];
+    double engineSampleRate = [[Settings sharedInstance] engineSampleRate];
+    if (engineSampleRate <= 0) engineSampleRate = sampleRate;
+
+    // Programs are built for a specific sample rate. Drop the current one
+    // rather than play it at the wrong rate until the new one is ready.
+    // With a fixed engine rate, device changes keep the current program.
+    BOOL needsProgram = (_activeSampleRate != engineSampleRate);
+
+    if (needsProgram) {
+        [self _installProgram:NULL];
+    }
+
+    _activeSampleRate = engineSampleRate;
+    _deviceSampleRate = sampleRate;
+
+    [self _remakeResampler];
+    [self _remakeRenderAhead];
+    [self _remakeMeter];
+    [self _updateWorkerPool];
+
+    if (needsProgram) {
+        [self _remakeProgram];
+    }
 
     if (wasRunning) {
         [self _reallyStartOutput];
@@ -346,6 +471,94 @@ static void sHandleStreamFormatChanged(
 }
 
 
+// Must only be called while output is stopped
+- (void) _remakeResampler
+{
+    ResamplerFree(_renderData.resampler);
+    _renderData.resampler = NULL;
+
+    if (_activeSampleRate > 0 && _deviceSampleRate > 0 && _activeSampleRate != _deviceSampleRate) {
+        ResamplerQuality quality = (ResamplerQuality)[[Settings sharedInstance] resamplerQuality];
+
+        _renderData.resampler = ResamplerCreate(_activeSampleRate, _deviceSampleRate, quality, sRenderProgram, &_renderData);
+    }
+}
+
+
+// Must only be called while output is stopped
+- (void) _remakeRenderAhead
+{
+    RenderAheadFree(_renderData.renderAhead);
+    _renderData.renderAhead = NULL;
+
+    NSTimeInterval duration = [[Settings sharedInstance] renderAheadDuration];
+    size_t frameCount = lround(duration * _deviceSampleRate);
+
+    if (frameCount > 0) {
+        _renderData.renderAhead = RenderAheadCreate(frameCount, sRenderAheadChunkFrameCount, sRenderEngine, &_renderData);
+    }
+}
+
+
+// Workers join the device's workgroup when they help its callback. With render
+// ahead, programs render on the render ahead thread instead, outside of it.
+- (void) _updateWorkerPool
+{
+    if (!_workerPool) return;
+
+    os_workgroup_t workgroup = NULL;
+    double period = 0;
+
+    if (!_renderData.renderAhead) {
+        UInt32 dataSize = sizeof(workgroup);
+
+        OSStatus err = AudioUnitGetProperty(
+            _outputAudioUnit,
+            kAudioOutputUnitProperty_OSWorkgroup,
+            kAudioUnitScope_Global, 0,
+            &workgroup, &dataSize
+        );
+
+        if (err != noErr) workgroup = NULL;
+
+        UInt32 bufferFrameSize = 0;
+        dataSize = sizeof(bufferFrameSize);
+
+        err = AudioUnitGetProperty(
+            _outputAudioUnit,
+            kAudioDevicePropertyBufferFrameSize,
+            kAudioUnitScope_Global, 0,
+            &bufferFrameSize, &dataSize
+        );
+
+        if (err == noErr && _deviceSampleRate > 0) {
+            period = bufferFrameSize / _deviceSampleRate;
+        }
+
+    } else if (_activeSampleRate > 0) {
+        period = sRenderAheadChunkFrameCount / _activeSampleRate;
+    }
+
+    WorkerPoolSetWorkgroup(_workerPool, workgroup);
+    WorkerPoolSetPeriod(_workerPool, period);
+
+    // The property returns a retained workgroup
+    if (workgroup) os_release(workgroup);
+}
+
+
+// Must only be called while output is stopped
+- (void) _remakeMeter
+{
+    MeterFree(_renderData.meter);
+    _renderData.meter = NULL;
+
+    if ([[Settings sharedInstance] meteringEnabled] && _deviceSampleRate > 0) {
+        _renderData.meter = MeterCreate(_deviceSampleRate);
+    }
+}
+
+
 - (BOOL) _isRunning
 {
     if (!_outputAudioUnit) return NO;
@@ -366,30 +579,51 @@ static void sHandleStreamFormatChanged(
 {
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(_reallyStopOutput) object:nil];
     CheckError(AudioOutputUnitStop(_outputAudioUnit), @"AudioOutputUnitStop");
+
+    RenderAhead *renderAhead = _renderData.renderAhead;
+
+    if (renderAhead) {
+        RenderAheadStop(renderAhead);
+
+        RenderAheadStats stats;
+        RenderAheadGetStats(renderAhead, &stats);
+
+        if (stats.underruns > 0) {
+            NSLog(@"Render ahead: %llu underruns, %llu frames of silence, capacity %zu frames",
+                stats.underruns, stats.underrunFrames, stats.capacity
+            );
+        }
+    }
+
+    uint64_t denormalEvents = atomic_exchange(&_renderData.denormalEvents, 0);
+
+    if (denormalEvents > 0) {
+        NSLog(@"Flushed denormals during %llu renders", denormalEvents);
+    }
 }
 
 
 - (void) _reallyStartOutput
 {
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(_reallyStopOutput) object:nil];
+
+    if (_renderData.renderAhead) {
+        RenderAheadStart(_renderData.renderAhead);
+    }
+
     CheckError(AudioOutputUnitStart(_outputAudioUnit), @"AudioOutputUnitStart");
 }
 
 
-- (void) _remakeProgram
+// Hands a program to the render thread and frees the previous one
+- (void) _installProgram:(NoisyProgram *)newProgram
 {
-    NSError *error = nil;
-
-    NoisyProgram *newProgram = _preset ?
-        NoisyProgramCreate(_preset, _stereoWidth > 0 ? 2 : 1, _activeSampleRate, &error) :
-        NULL;
-
     NoisyProgram *previousProgram = atomic_load(&_renderData.program);
     atomic_store(&_renderData.nextProgram, newProgram);
 
     BOOL needsRestart = NO;
 
-    // Wait for sRender() to move nextBiquadSetup to biquadSetup
+    // Wait for sRender() to move nextProgram to program
     NSInteger loopGuard = 0;
     while ([self _isRunning]) {
         if (newProgram == atomic_load(&_renderData.program)) {
@@ -412,19 +646,63 @@ static void sHandleStreamFormatChanged(
         atomic_store(&_renderData.program, newProgram);
     }
 
-    _programModifiedTimeInterval = [[_preset modificationDate] timeIntervalSinceReferenceDate];
-    [self setError:error];
-
-    if (needsRestart && !error) {
+    if (needsRestart && newProgram) {
         [self play];
     }
 
-    if (previousProgram) {
+    if (previousProgram && previousProgram != newProgram) {
         NoisyProgramFree(previousProgram);
     }
 }
 
 
+/*
+    Builds run on _programQueue. When presets are switched quickly, each
+    request supersedes the previous one: pending builds are cancelled inside
+    ProgramBuilder or while priming, and only the program of the newest
+    request is installed.
+*/
+- (void) _remakeProgram
+{
+    uint64_t generation = atomic_fetch_add(&_programGeneration, 1) + 1;
+
+    Preset *preset      = _preset;
+    size_t channelCount = _stereoWidth > 0 ? 2 : 1;
+    double sampleRate   = _activeSampleRate;
+    WorkerPool *workerPool = _workerPool;
+
+    _programModifiedTimeInterval = [[preset modificationDate] timeIntervalSinceReferenceDate];
+
+    BOOL (^isCancelled)(void) = ^{
+        return (BOOL)(atomic_load_explicit(&self->_programGeneration, memory_order_relaxed) != generation);
+    };
+
+    dispatch_async(_programQueue, ^{
+        NSError *error = nil;
+        NoisyProgram *program = NULL;
+
+        if (preset && !isCancelled()) {
+            program = NoisyProgramCreate(preset, channelCount, sampleRate, isCancelled, &error);
+        }
+
+        if (program) {
+            NoisyProgramSetWorkerPool(program, workerPool);
+            NoisyProgramSetRealTime(program, YES);
+        }
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (isCancelled()) {
+                NoisyProgramFree(program);
+                return;
+            }
+
+            [self _installProgram:program];
+            [self setError:error];
+        });
+    });
+}
+
+
 - (void) _postNotificationName:(NSString *)name
 {
     [[NSNotificationCenter defaultCenter] postNotificationName:name object:self];
@@ -436,7 +714,7 @@ static void sHandleStreamFormatChanged(
     BOOL shouldBeRunning = _playing && !_muted && !_terminating;
     BOOL isRunning = [self _isRunning];
 
-    size_t frameDuration = lround(fadeDuration * _activeSampleRate);
+    size_t frameDuration = lround(fadeDuration * _deviceSampleRate);
 
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(_reallyStopOutput) object:nil];
 
@@ -618,5 +896,13 @@ static void sHandleStreamFormatChanged(
 }
 
 
+- (BOOL) getMeterSnapshot:(MeterSnapshot *)outSnapshot
+{
+    // Only replaced on the main thread
+    Meter *meter = _renderData.meter;
+    return meter ? MeterGetSnapshot(meter, outSnapshot) : NO;
+}
+
+
 @end
 
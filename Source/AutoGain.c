@@ -0,0 +1,431 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "AutoGain.h"
+
+#include <Accelerate/Accelerate.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+static const size_t sMaxFramesToProcess  = 512;
+
+static const double sBlockDuration       = 0.1; // Gating blocks are four of these
+static const size_t sGatingBlockCount    = 4;
+static const size_t sShortTermBlockCount = 30;
+
+static const double sAbsoluteGate        = -70.0;
+static const double sRelativeGate        = -10.0;
+static const double sHistogramResolution = 0.1;
+static const size_t sHistogramBinCount   = 800; // -70 to +10 LUFS
+
+static const size_t sSettlingBlockCount  = 30;
+static const double sSettlingRate        = 40.0; // dB per second
+static const double sSteeringRate        = 0.5;  // dB per second
+
+
+typedef struct AutoGainHistogram {
+    double energies[sHistogramBinCount];
+    uint64_t counts[sHistogramBinCount];
+} AutoGainHistogram;
+
+
+// A set of measured channels which share a gain
+typedef struct AutoGainGroup {
+    AutoGainHistogram *histogram;
+
+    float peak;
+    double gain;     // In dB, at the end of the current block
+    float linearGain;
+    float linearStep;
+} AutoGainGroup;
+
+
+typedef struct AutoGain {
+    size_t channelCount;
+    bool separate;
+
+    double targetLoudness;
+    double peakLevel;
+
+    vDSP_biquad_Setup kWeighting;
+    float delays[2][6];
+
+    size_t blockFrameCount;
+    size_t blockFrameIndex;
+    uint64_t blockCount;
+    double blockSums[2];
+
+    // Mean squares of the most recent blocks, per channel
+    double blockEnergies[2][sShortTermBlockCount];
+
+    // Group 0 is always both channels. Groups 1 and 2 are each channel, when separate.
+    AutoGainGroup groups[3];
+
+    size_t settlingBlocks;
+    bool settled;
+
+    float scratch[sMaxFramesToProcess];
+} AutoGain;
+
+
+#pragma mark - Private Functions
+
+/*
+    The two K-weighting stages from ITU-R BS.1770, a high shelf modeling the head
+    and a high-pass ("RLB"), recomputed for the sample rate. See the derivation in
+    libebur128; the constants reproduce the 48kHz coefficients from the standard.
+*/
+static vDSP_biquad_Setup sCreateKWeightingSetup(double sampleRate)
+{
+    double coefficients[10];
+
+    double f0 = 1681.974450955533;
+    double G  = 3.999843853973347;
+    double Q  = 0.7071752369554196;
+
+    double K  = tan(M_PI * f0 / sampleRate);
+    double Vh = pow(10.0, G / 20.0);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + (K / Q) + (K * K);
+
+    coefficients[0] = (Vh + (Vb * K / Q) + (K * K)) / a0;
+    coefficients[1] = 2.0 * ((K * K) - Vh) / a0;
+    coefficients[2] = (Vh - (Vb * K / Q) + (K * K)) / a0;
+    coefficients[3] = 2.0 * ((K * K) - 1.0) / a0;
+    coefficients[4] = (1.0 - (K / Q) + (K * K)) / a0;
+
+    f0 = 38.13547087602444;
+    Q  = 0.5003270373238773;
+    K  = tan(M_PI * f0 / sampleRate);
+    a0 = 1.0 + (K / Q) + (K * K);
+
+    coefficients[5] =  1.0;
+    coefficients[6] = -2.0;
+    coefficients[7] =  1.0;
+    coefficients[8] = 2.0 * ((K * K) - 1.0) / a0;
+    coefficients[9] = (1.0 - (K / Q) + (K * K)) / a0;
+
+    return vDSP_biquad_CreateSetup(coefficients, 2);
+}
+
+
+static double sGetLoudness(double energy)
+{
+    return energy > 0 ? (-0.691 + (10.0 * log10(energy))) : -INFINITY;
+}
+
+
+static void sAddToHistogram(AutoGainHistogram *histogram, double energy)
+{
+    double loudness = sGetLoudness(energy);
+    if (loudness <= sAbsoluteGate) return;
+
+    size_t index = (size_t)((loudness - sAbsoluteGate) / sHistogramResolution);
+    if (index >= sHistogramBinCount) index = sHistogramBinCount - 1;
+
+    histogram->energies[index] += energy;
+    histogram->counts[index]++;
+}
+
+
+// Integrated loudness with both gates applied
+static double sGetIntegratedLoudness(const AutoGainHistogram *histogram)
+{
+    double energy = 0;
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < sHistogramBinCount; i++) {
+        energy += histogram->energies[i];
+        count  += histogram->counts[i];
+    }
+
+    if (count == 0) return -INFINITY;
+
+    double relativeGate = sGetLoudness(energy / count) + sRelativeGate;
+    double start = ceil((relativeGate - sAbsoluteGate) / sHistogramResolution);
+
+    energy = 0;
+    count  = 0;
+
+    for (size_t i = start > 0 ? (size_t)start : 0; i < sHistogramBinCount; i++) {
+        energy += histogram->energies[i];
+        count  += histogram->counts[i];
+    }
+
+    return count ? sGetLoudness(energy / count) : -INFINITY;
+}
+
+
+// Mean square of the most recent blockCount blocks of a channel
+static double sGetRecentEnergy(AutoGain *self, size_t channel, size_t blockCount)
+{
+    double sum = 0;
+
+    for (size_t i = 0; i < blockCount; i++) {
+        size_t index = (self->blockCount - 1 - i) % sShortTermBlockCount;
+        sum += self->blockEnergies[channel][index];
+    }
+
+    return sum / blockCount;
+}
+
+
+// Energy of a group, as played. A single measured channel is played on both outputs.
+static double sGetGroupEnergy(AutoGain *self, size_t groupIndex, size_t blockCount)
+{
+    if (groupIndex > 0) {
+        return sGetRecentEnergy(self, groupIndex - 1, blockCount);
+    } else if (self->channelCount == 1) {
+        return 2.0 * sGetRecentEnergy(self, 0, blockCount);
+    } else {
+        return sGetRecentEnergy(self, 0, blockCount) + sGetRecentEnergy(self, 1, blockCount);
+    }
+}
+
+
+static void sUpdateGain(AutoGain *self, AutoGainGroup *group, double targetLoudness)
+{
+    double loudness = sGetIntegratedLoudness(group->histogram);
+
+    double gain = group->gain;
+
+    if (isfinite(loudness)) {
+        double desiredGain = targetLoudness - loudness;
+        double peakGain    = self->peakLevel - (20.0 * log10(group->peak));
+
+        if (desiredGain > peakGain) desiredGain = peakGain;
+
+        // Reductions always move quickly
+        double maxRise = (self->settled ? sSteeringRate : sSettlingRate) * sBlockDuration;
+        double maxFall = sSettlingRate * sBlockDuration;
+
+        double delta = desiredGain - gain;
+
+        if (delta >  maxRise) delta =  maxRise;
+        if (delta < -maxFall) delta = -maxFall;
+
+        gain += delta;
+    }
+
+    // Ramp to the new gain over the next block
+    float linearGain = pow(10.0, gain / 20.0);
+
+    group->linearStep = (linearGain - group->linearGain) / self->blockFrameCount;
+    group->gain = gain;
+}
+
+
+static void sFinishBlock(AutoGain *self)
+{
+    size_t channelCount = self->channelCount;
+    size_t blockIndex = self->blockCount % sShortTermBlockCount;
+
+    for (size_t c = 0; c < channelCount; c++) {
+        self->blockEnergies[c][blockIndex] = self->blockSums[c] / self->blockFrameCount;
+        self->blockSums[c] = 0;
+    }
+
+    self->blockCount++;
+    self->blockFrameIndex = 0;
+
+    size_t groupCount = self->separate ? 3 : 1;
+
+    // Land exactly on the previous ramp's target
+    for (size_t g = 0; g < groupCount; g++) {
+        AutoGainGroup *group = &self->groups[g];
+        group->linearGain = pow(10.0, group->gain / 20.0);
+        group->linearStep = 0;
+    }
+
+    if (self->blockCount < sGatingBlockCount) return;
+
+    for (size_t g = 0; g < groupCount; g++) {
+        sAddToHistogram(self->groups[g].histogram, sGetGroupEnergy(self, g, sGatingBlockCount));
+    }
+
+    if (self->separate) {
+        // Each channel gets half of the target energy
+        double targetLoudness = self->targetLoudness - (10.0 * log10(2.0));
+
+        sUpdateGain(self, &self->groups[1], targetLoudness);
+        sUpdateGain(self, &self->groups[2], targetLoudness);
+
+    } else {
+        sUpdateGain(self, &self->groups[0], self->targetLoudness);
+    }
+
+    if (!self->settled && ++self->settlingBlocks >= sSettlingBlockCount) {
+        self->settled = true;
+    }
+}
+
+
+static void sMeasure(AutoGain *self, size_t channel, const float *input, size_t frameCount)
+{
+    float *scratch = self->scratch;
+
+    vDSP_biquad(self->kWeighting, self->delays[channel], input, 1, scratch, 1, frameCount);
+
+    float sum;
+    vDSP_svesq(scratch, 1, &sum, frameCount);
+    self->blockSums[channel] += sum;
+
+    float peak;
+    vDSP_maxmgv(input, 1, &peak, frameCount);
+
+    // Group 0 holds the peak of both channels
+    if (peak > self->groups[0].peak) self->groups[0].peak = peak;
+
+    if (self->separate) {
+        AutoGainGroup *group = &self->groups[channel + 1];
+        if (peak > group->peak) group->peak = peak;
+    }
+}
+
+
+static void sApply(AutoGainGroup *group, float *buffer, size_t frameCount)
+{
+    if (group->linearStep == 0) {
+        vDSP_vsmul(buffer, 1, &group->linearGain, buffer, 1, frameCount);
+    } else {
+        vDSP_vrampmul(buffer, 1, &group->linearGain, &group->linearStep, buffer, 1, frameCount);
+    }
+}
+
+
+#pragma mark - Public Functions
+
+AutoGain *AutoGainCreate(
+    double sampleRate,
+    size_t channelCount,
+    double targetLoudness,
+    double peakLevel,
+    bool separate
+) {
+    if (channelCount < 1 || channelCount > 2) return NULL;
+
+    AutoGain *self = calloc(1, sizeof(AutoGain));
+
+    self->channelCount   = channelCount;
+    self->separate       = separate && (channelCount == 2);
+    self->targetLoudness = targetLoudness;
+    self->peakLevel      = peakLevel;
+
+    self->kWeighting      = sCreateKWeightingSetup(sampleRate);
+    self->blockFrameCount = (size_t)lround(sampleRate * sBlockDuration);
+
+    size_t groupCount = self->separate ? 3 : 1;
+
+    for (size_t g = 0; g < groupCount; g++) {
+        AutoGainGroup *group = &self->groups[g];
+
+        group->histogram = calloc(1, sizeof(AutoGainHistogram));
+
+        // Start as if the input were at 0 LUFS, so that the gain only rises while settling
+        group->gain = targetLoudness;
+        group->linearGain = pow(10.0, group->gain / 20.0);
+    }
+
+    return self;
+}
+
+
+void AutoGainFree(AutoGain *self)
+{
+    if (!self) return;
+
+    vDSP_biquad_DestroySetup(self->kWeighting);
+
+    for (size_t g = 0; g < 3; g++) {
+        free(self->groups[g].histogram);
+    }
+
+    free(self);
+}
+
+
+void AutoGainSetSettledGain(AutoGain *self, float leftGain, float rightGain)
+{
+    if (leftGain <= 0 || rightGain <= 0) return;
+
+    if (self->separate) {
+        self->groups[1].gain = 20.0 * log10(leftGain);
+        self->groups[2].gain = 20.0 * log10(rightGain);
+    } else {
+        self->groups[0].gain = 20.0 * log10(leftGain);
+    }
+
+    for (size_t g = 0; g < 3; g++) {
+        AutoGainGroup *group = &self->groups[g];
+        group->linearGain = pow(10.0, group->gain / 20.0);
+        group->linearStep = 0;
+    }
+
+    self->settled = true;
+}
+
+
+void AutoGainProcess(AutoGain *self, float *left, float *right, size_t frameCount)
+{
+    AutoGainGroup *leftGroup  = &self->groups[self->separate ? 1 : 0];
+    AutoGainGroup *rightGroup = &self->groups[self->separate ? 2 : 0];
+
+    size_t offset = 0;
+
+    while (frameCount > 0) {
+        size_t framesToProcess = frameCount;
+        framesToProcess = MIN(framesToProcess, sMaxFramesToProcess);
+        framesToProcess = MIN(framesToProcess, self->blockFrameCount - self->blockFrameIndex);
+
+        sMeasure(self, 0, left + offset, framesToProcess);
+        if (right) sMeasure(self, 1, right + offset, framesToProcess);
+
+        if (right && rightGroup == leftGroup) {
+            // Both channels share a ramp, so the start value must not advance twice
+            float linearGain = leftGroup->linearGain;
+
+            sApply(leftGroup, left + offset, framesToProcess);
+            leftGroup->linearGain = linearGain;
+            sApply(leftGroup, right + offset, framesToProcess);
+
+        } else {
+            sApply(leftGroup, left + offset, framesToProcess);
+            if (right) sApply(rightGroup, right + offset, framesToProcess);
+        }
+
+        self->blockFrameIndex += framesToProcess;
+
+        if (self->blockFrameIndex == self->blockFrameCount) {
+            sFinishBlock(self);
+        }
+
+        offset     += framesToProcess;
+        frameCount -= framesToProcess;
+    }
+}
+
+
+bool AutoGainGetGain(AutoGain *self, float *outLeft, float *outRight)
+{
+    AutoGainGroup *leftGroup  = &self->groups[self->separate ? 1 : 0];
+    AutoGainGroup *rightGroup = &self->groups[self->separate ? 2 : 0];
+
+    *outLeft  = pow(10.0, leftGroup->gain  / 20.0);
+    *outRight = pow(10.0, rightGroup->gain / 20.0);
+
+    return self->settled;
+}
+
+
+double AutoGainGetIntegratedLoudness(AutoGain *self)
+{
+    return sGetIntegratedLoudness(self->groups[0].histogram);
+}
+
+
+double AutoGainGetShortTermLoudness(AutoGain *self)
+{
+    if (self->blockCount < sShortTermBlockCount) return -INFINITY;
+    return sGetLoudness(sGetGroupEnergy(self, 0, sShortTermBlockCount));
+}
@@ -0,0 +1,57 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _AUTO_GAIN_H_
+#define _AUTO_GAIN_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+/*
+    Streaming loudness normalization.
+
+    Measures the incoming audio with an ITU-R BS.1770 loudness meter
+    (K-weighting, 400ms gating blocks with 75% overlap, absolute gate at
+    -70 LUFS, relative gate at -10 LU) and steers a gain towards the target
+    integrated loudness. The gain never exceeds the level which would put
+    the largest observed sample above peakLevel (in dBFS).
+
+    The gain starts low and moves quickly while the measurement settles
+    (a few seconds), then slowly. Changes are applied as per-sample ramps
+    at 100ms block boundaries, so they are never audible as steps.
+
+    With a channelCount of 1, the input is measured as if it were played
+    on both channels. With separate set, each channel of a stereo input is
+    normalized on its own to half of the target loudness, so that both
+    together reach the target.
+
+    AutoGainProcess() does not allocate or lock.
+*/
+
+typedef struct AutoGain AutoGain;
+
+extern AutoGain *AutoGainCreate(
+    double sampleRate,
+    size_t channelCount,
+    double targetLoudness,
+    double peakLevel,
+    bool separate
+);
+
+extern void AutoGainFree(AutoGain *self);
+
+// Starts from a previously settled gain (linear), skipping the initial search
+extern void AutoGainSetSettledGain(AutoGain *self, float leftGain, float rightGain);
+
+// Measures left and right, then applies the gain in place. right must be NULL
+// when channelCount is 1.
+extern void AutoGainProcess(AutoGain *self, float *left, float *right, size_t frameCount);
+
+// Returns the current linear gain. Returns true once the gain has settled.
+extern bool AutoGainGetGain(AutoGain *self, float *outLeft, float *outRight);
+
+// Loudness of the input (before gain), in LUFS. -INFINITY until measured.
+extern double AutoGainGetIntegratedLoudness(AutoGain *self);
+extern double AutoGainGetShortTermLoudness(AutoGain *self);
+
+#endif
@@ -0,0 +1,129 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+@import Foundation;
+
+@class Preset;
+
+
+/*
+    Measures the cost of long-duration playback.
+
+    Each preset is rendered in real time: one buffer per period, with the
+    thread sleeping until the next deadline, as a device callback would.
+    For each preset and buffer size, the benchmark records the CPU time of
+    the rendering thread, and the process's CPU time, wakeups, and energy
+    from proc_pid_rusage(), and counts buffers which finished after their
+    deadline. An idle run (pacing without rendering) is
+    included as a baseline.
+
+    Results are scaled to one hour of audio so that runs of different
+    durations, and builds with different engines, can be compared.
+
+    The batch suite renders each preset as several programs, once program
+    by program and once as a NoisyProgramBatch. Before timing, it renders
+    both paths in step and reports their peak difference.
+
+    The streams suite renders each preset as many independent streams on a
+    StreamServer, read by simulated devices, and reports the worker render
+    time along with deadline misses and underruns for each stream count.
+
+    The device suite renders each preset on an OutputDevice with a null sink
+    instead of the paced loop, and also reports the jitter and maximum of
+    the render thread's wakeup latency.
+
+    The export suite writes one file per processor for each preset with an
+    ExportQueue, first one job at a time and then all at once, and reports
+    the seconds of audio written per second. Buffer sizes do not apply.
+
+    The biquads suite times vDSP_biquad() against BiquadCascade for each
+    section count up to --sections, with coefficients from +[Biquad
+    fillCoefficients:...], after comparing their output on the same noise.
+    Use it to place NoisyBiquadsNodeCascadeMinimumSectionCount.
+
+    The modulation suite instead renders a bank of peaking sections swept
+    by a 0.5 Hz sine, three ways: unmodulated, with control-rate
+    modulators, and recomputing every coefficient on every frame. The
+    control-rate row reports its peak and RMS difference from the
+    per-sample path over one sweep of the same noise.
+
+    Run from Terminal:
+
+        Noisy.app/Contents/MacOS/Noisy --benchmark [options]
+
+        --duration <seconds>     Per preset and buffer size (default 60)
+        --buffer-sizes <list>    Comma-separated, in frames (default 512)
+        --sample-rate <hz>       (default 48000)
+        --channels <1|2>         (default 2)
+        --preset <identifier>    May be repeated (default all presets)
+        --csv <path>             Also write the results as CSV
+        --suite <name>           presets, batch, streams, device, export, biquads, or modulation (default presets)
+        --lanes <n>              Programs per preset for the batch suite (default 8)
+        --streams <list>         Comma-separated stream counts for the streams suite (default 1,8,32,128)
+        --priority <n>           SCHED_FIFO priority for the device suite (default 0, the default policy)
+        --sections <n>           Biquad sections for the biquads and modulation suites (default 16)
+*/
+
+@interface BenchmarkResult : NSObject
+
+@property (nonatomic, readonly) NSString *presetName;     // nil for the idle baseline
+@property (nonatomic, readonly) size_t bufferFrameCount;
+@property (nonatomic, readonly) NSTimeInterval audioDuration;
+
+@property (nonatomic, readonly) NSTimeInterval threadCPUTime;
+@property (nonatomic, readonly) NSTimeInterval processCPUTime;
+@property (nonatomic, readonly) uint64_t wakeupCount;
+@property (nonatomic, readonly) double energy;             // In joules, or NAN if unavailable
+@property (nonatomic, readonly) uint64_t deadlineMissCount; // Buffers finished after their deadline
+@property (nonatomic, readonly) uint64_t underrunCount;     // Streams suite only
+@property (nonatomic, readonly) double wakeJitter;         // Device suite only, in seconds, or NAN
+@property (nonatomic, readonly) double maxWakeLatency;     // Device suite only, in seconds, or NAN
+@property (nonatomic, readonly) double difference;         // Peak difference from the reference path in dB, or NAN
+@property (nonatomic, readonly) double rmsDifference;      // Modulation suite only, in dB relative to the reference's RMS, or NAN
+@property (nonatomic, readonly) double throughput;         // Export suite only, seconds of audio per second, or NAN
+
+@property (nonatomic, readonly) NSError *error;
+
+// Derived values
+@property (nonatomic, readonly) double cpuSecondsPerHour;  // Of the rendering thread
+@property (nonatomic, readonly) double processCPUSecondsPerHour;
+@property (nonatomic, readonly) double wakeupsPerSecond;
+@property (nonatomic, readonly) double joulesPerHour;
+@property (nonatomic, readonly) double load;               // Rendering time / audio time
+
+@end
+
+
+@interface Benchmark : NSObject
+
+- (instancetype) initWithPresets:(NSArray<Preset *> *)presets;
+
+@property (nonatomic, readonly) NSArray<Preset *> *presets;
+
+@property (nonatomic) NSTimeInterval duration;
+@property (nonatomic, copy) NSArray<NSNumber *> *bufferFrameCounts;
+@property (nonatomic) double sampleRate;
+@property (nonatomic) NSInteger channelCount;
+@property (nonatomic) NSInteger sectionCount;              // Biquads and modulation suites only
+@property (nonatomic) NSInteger laneCount;                 // Batch suite only
+@property (nonatomic, copy) NSArray<NSNumber *> *streamCounts; // Streams suite only
+@property (nonatomic) NSInteger devicePriority;            // Device suite only
+
+// Blocks the calling thread, which must be the main thread, for the
+// duration of every run
+- (NSArray<BenchmarkResult *> *) run;
+- (NSArray<BenchmarkResult *> *) runBatch;
+- (NSArray<BenchmarkResult *> *) runStreams;
+- (NSArray<BenchmarkResult *> *) runDevice;
+- (NSArray<BenchmarkResult *> *) runExport;
+- (NSArray<BenchmarkResult *> *) runBiquads;
+- (NSArray<BenchmarkResult *> *) runModulation;
+
++ (NSString *) tableWithResults:(NSArray<BenchmarkResult *> *)results;
++ (NSString *) CSVWithResults:(NSArray<BenchmarkResult *> *)results;
+
+@end
+
+
+// Entry point for --benchmark. Returns the process exit status.
+extern int BenchmarkMain(int argc, const char *argv[]);
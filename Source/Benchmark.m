@@ -0,0 +1,1234 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#import "Benchmark.h"
+#import "Biquad.h"
+#import "BiquadCascade.h"
+#import "ExportQueue.h"
+#import "FloatingPoint.h"
+#import "NoisyNode.h"
+#import "NoisyProgram.h"
+#import "OutputDevice.h"
+#import "Preset.h"
+#import "PresetManager.h"
+#import "StreamServer.h"
+
+@import Accelerate;
+
+#include <libproc.h>
+#include <mach/mach_time.h>
+
+
+typedef struct BenchmarkUsage {
+    uint64_t threadCPUTime;   // In nanoseconds
+    uint64_t processCPUTime;  // In nanoseconds
+    uint64_t wakeupCount;
+    uint64_t energy;          // In nanojoules
+} BenchmarkUsage;
+
+
+typedef void (^BenchmarkRenderBlock)(float *left, float *right, size_t frameCount);
+
+
+// Modulation suite: peaking sections swept by a sine, as a slow "breathing" filter bank
+static const double sModulationRate  = 0.5;  // In Hz
+static const double sModulationDepth = 1.0;  // In octaves
+
+// Device suite: the render callback for the idle baseline
+static void sRenderNothing(void *context, float *left, float *right, size_t frameCount) { }
+
+
+// Biquads suite: audio compared between vDSP_biquad() and the cascade before timing
+static const NSTimeInterval sBiquadsCompareDuration = 2.0;
+
+// Export suite: chunk size used by ExportJob, reported as the buffer size
+static const NSTimeInterval sExportChunkDuration = 1.0;
+
+// Streams suite: blocks of lead time in each stream's ring
+static const size_t sStreamRingBlockCount = 4;
+
+// Batch suite: audio compared against the per-program path before timing. Batched filters
+// start with cleared state rather than the programs' primed state, so the comparison starts
+// once that difference has decayed.
+static const NSTimeInterval sBatchSettleDuration  = 0.5;
+static const NSTimeInterval sBatchCompareDuration = 2.0;
+
+
+static NSError *sMakeError(NSString *description)
+{
+    return [NSError errorWithDomain:@"NoisyErrorDomain" code:0 userInfo:@{
+        NSLocalizedDescriptionKey: description
+    }];
+}
+
+
+// Accumulates the peak of |a - b|, and the peak of |b| as the reference
+static void sAccumulateDifference(const float *a, const float *b, size_t count, float *inOutPeakDifference, float *inOutPeak)
+{
+    for (size_t i = 0; i < count; i++) {
+        *inOutPeakDifference = MAX(*inOutPeakDifference, fabsf(a[i] - b[i]));
+        *inOutPeak           = MAX(*inOutPeak, fabsf(b[i]));
+    }
+}
+
+
+// In dB relative to the reference's peak
+static double sGetDifference(float peakDifference, float peak)
+{
+    if (peakDifference == 0) return -INFINITY;
+    return 20.0 * log10(peakDifference / peak);
+}
+
+
+static mach_timebase_info_data_t sGetTimebase(void)
+{
+    static mach_timebase_info_data_t sTimebase;
+    if (!sTimebase.denom) mach_timebase_info(&sTimebase);
+
+    return sTimebase;
+}
+
+
+static uint64_t sMachToNanoseconds(uint64_t machTime)
+{
+    mach_timebase_info_data_t timebase = sGetTimebase();
+    return (machTime * timebase.numer) / timebase.denom;
+}
+
+
+static uint64_t sNanosecondsToMach(uint64_t nanoseconds)
+{
+    mach_timebase_info_data_t timebase = sGetTimebase();
+    return (nanoseconds * timebase.denom) / timebase.numer;
+}
+
+
+static void sGetUsage(BenchmarkUsage *outUsage)
+{
+    struct rusage_info_v4 info = { 0 };
+    proc_pid_rusage(getpid(), RUSAGE_INFO_V4, (rusage_info_t *)&info);
+
+    // ri_user_time and ri_system_time are in Mach absolute time units
+    outUsage->threadCPUTime  = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+    outUsage->processCPUTime = sMachToNanoseconds(info.ri_user_time + info.ri_system_time);
+    outUsage->wakeupCount    = info.ri_pkg_idle_wkups + info.ri_interrupt_wkups;
+    outUsage->energy         = info.ri_billed_energy;
+}
+
+
+@interface BenchmarkResult ()
+@property (nonatomic) NSString *presetName;
+@property (nonatomic) size_t bufferFrameCount;
+@property (nonatomic) NSTimeInterval audioDuration;
+@property (nonatomic) NSTimeInterval threadCPUTime;
+@property (nonatomic) NSTimeInterval processCPUTime;
+@property (nonatomic) uint64_t wakeupCount;
+@property (nonatomic) double energy;
+@property (nonatomic) double difference;
+@property (nonatomic) double rmsDifference;
+@property (nonatomic) double throughput;
+@property (nonatomic) uint64_t deadlineMissCount;
+@property (nonatomic) uint64_t underrunCount;
+@property (nonatomic) double wakeJitter;
+@property (nonatomic) double maxWakeLatency;
+@property (nonatomic) NSError *error;
+
+- (void) _setUsageWithStart:(BenchmarkUsage)start end:(BenchmarkUsage)end;
+@end
+
+
+@implementation BenchmarkResult
+
+- (instancetype) init
+{
+    if ((self = [super init])) {
+        _difference     = NAN;
+        _rmsDifference  = NAN;
+        _throughput     = NAN;
+        _wakeJitter     = NAN;
+        _maxWakeLatency = NAN;
+    }
+
+    return self;
+}
+
+
+- (void) _setUsageWithStart:(BenchmarkUsage)start end:(BenchmarkUsage)end
+{
+    _processCPUTime = (end.processCPUTime - start.processCPUTime) / (double)NSEC_PER_SEC;
+    _wakeupCount    = end.wakeupCount - start.wakeupCount;
+
+    // Billed energy is zero on hardware without energy counters
+    BOOL hasEnergy = (start.energy > 0 || end.energy > 0);
+    _energy = hasEnergy ? ((end.energy - start.energy) / 1e9) : NAN;
+}
+
+
+- (double) _perHour:(double)value
+{
+    return _audioDuration > 0 ? (value / _audioDuration) * 3600.0 : 0;
+}
+
+
+- (double) cpuSecondsPerHour        { return [self _perHour:_threadCPUTime];  }
+- (double) processCPUSecondsPerHour { return [self _perHour:_processCPUTime]; }
+- (double) joulesPerHour            { return [self _perHour:_energy];         }
+
+
+- (double) wakeupsPerSecond
+{
+    return _audioDuration > 0 ? _wakeupCount / _audioDuration : 0;
+}
+
+
+- (double) load
+{
+    return _audioDuration > 0 ? _threadCPUTime / _audioDuration : 0;
+}
+
+
+@end
+
+
+@implementation Benchmark
+
+- (instancetype) initWithPresets:(NSArray<Preset *> *)presets
+{
+    if ((self = [super init])) {
+        _presets = [presets copy];
+        _duration = 60;
+        _bufferFrameCounts = @[ @512 ];
+        _sampleRate = 48000;
+        _channelCount = 2;
+        _sectionCount = 16;
+        _laneCount = 8;
+        _streamCounts = @[ @1, @8, @32, @128 ];
+    }
+
+    return self;
+}
+
+
+#pragma mark - Private Methods
+
+// Renders (or, with a nil block, only waits) one buffer per period until duration has passed
+- (BenchmarkResult *) _runWithBufferFrameCount:(size_t)bufferFrameCount render:(BenchmarkRenderBlock)render
+{
+    size_t bufferCount = (size_t)llround((_duration * _sampleRate) / bufferFrameCount);
+
+    float *left  = calloc(bufferFrameCount, sizeof(float));
+    float *right = calloc(bufferFrameCount, sizeof(float));
+
+    uint64_t period = sNanosecondsToMach((uint64_t)llround((bufferFrameCount / _sampleRate) * NSEC_PER_SEC));
+
+    BenchmarkUsage start, end;
+    sGetUsage(&start);
+
+    uint64_t deadline = mach_absolute_time();
+    uint64_t deadlineMissCount = 0;
+
+    for (size_t i = 0; i < bufferCount; i++) {
+        if (render) {
+            FloatingPointState floatingPointState;
+            FloatingPointEnableFlushToZero(&floatingPointState);
+
+            render(left, right, bufferFrameCount);
+
+            FloatingPointRestore(&floatingPointState);
+        }
+
+        // If rendering fell behind, the next buffer starts immediately
+        deadline += period;
+        if (mach_absolute_time() > deadline) deadlineMissCount++;
+
+        mach_wait_until(deadline);
+    }
+
+    sGetUsage(&end);
+
+    free(left);
+    free(right);
+
+    BenchmarkResult *result = [[BenchmarkResult alloc] init];
+
+    [result setBufferFrameCount:bufferFrameCount];
+    [result setAudioDuration:(bufferCount * bufferFrameCount) / _sampleRate];
+    [result setThreadCPUTime:(end.threadCPUTime - start.threadCPUTime) / (double)NSEC_PER_SEC];
+    [result setDeadlineMissCount:deadlineMissCount];
+    [result _setUsageWithStart:start end:end];
+
+    return result;
+}
+
+
+// Renders the program (or, if NULL, nothing) on an OutputDevice with a null sink
+- (BenchmarkResult *) _runDeviceWithProgram:(NoisyProgram *)program bufferFrameCount:(size_t)bufferFrameCount
+{
+    OutputDeviceOptions options = {
+        .sink             = OutputDeviceSinkNull,
+        .sampleRate       = _sampleRate,
+        .periodFrameCount = bufferFrameCount,
+        .frameCount       = (uint64_t)llround(_duration * _sampleRate),
+        .priority         = (int)_devicePriority,
+        .cpu              = -1,
+        .lockMemory       = false
+    };
+
+    OutputDevice *device = program ?
+        OutputDeviceCreate(&options, (OutputDeviceRenderCallback)NoisyProgramProcess, program) :
+        OutputDeviceCreate(&options, sRenderNothing, NULL);
+
+    BenchmarkUsage start, end;
+    OutputDeviceStats stats;
+
+    sGetUsage(&start);
+    OutputDeviceStart(device);
+    OutputDeviceWait(device);
+    sGetUsage(&end);
+
+    OutputDeviceGetStats(device, &stats);
+    OutputDeviceFree(device);
+
+    BenchmarkResult *result = [[BenchmarkResult alloc] init];
+
+    [result setBufferFrameCount:bufferFrameCount];
+    [result setAudioDuration:options.frameCount / _sampleRate];
+    [result setThreadCPUTime:stats.cpuTime];
+    [result setDeadlineMissCount:stats.deadlineMisses];
+    [result setWakeJitter:stats.wakeJitter];
+    [result setMaxWakeLatency:stats.maxWakeLatency];
+    [result _setUsageWithStart:start end:end];
+
+    if (_devicePriority > 0 && !stats.realTime) {
+        [result setError:sMakeError(@"SCHED_FIFO was not granted")];
+    }
+
+    return result;
+}
+
+
+// Renders streamCount programs of the preset on a StreamServer, read by simulated devices
+- (BenchmarkResult *) _runStreamsWithPreset:(Preset *)preset streamCount:(size_t)streamCount bufferFrameCount:(size_t)bufferFrameCount
+{
+    StreamServer *server = StreamServerCreate(0, streamCount, bufferFrameCount, sStreamRingBlockCount, _sampleRate);
+    NoisyProgram **programs = calloc(streamCount, sizeof(NoisyProgram *));
+    NSError *error = nil;
+
+    for (size_t i = 0; i < streamCount && !error; i++) {
+        programs[i] = NoisyProgramCreate(preset, _channelCount, _sampleRate, nil, &error);
+        if (programs[i]) StreamServerAddStream(server, (StreamServerRenderCallback)NoisyProgramProcess, programs[i]);
+    }
+
+    BenchmarkResult *result = [[BenchmarkResult alloc] init];
+
+    [result setBufferFrameCount:bufferFrameCount];
+    [result setPresetName:[NSString stringWithFormat:@"%@ (%zu streams)", [preset name], streamCount]];
+
+    if (error) {
+        [result setError:error];
+
+    } else {
+        BenchmarkUsage start, end;
+        StreamServerStats stats;
+
+        sGetUsage(&start);
+        StreamServerRunLoadTest(server, _duration, &stats);
+        sGetUsage(&end);
+
+        // Render time is summed across workers, so the load may exceed 100%
+        [result setAudioDuration:(stats.blocksRendered * bufferFrameCount) / _sampleRate];
+        [result setThreadCPUTime:stats.busyTime];
+        [result setDeadlineMissCount:stats.deadlineMisses];
+        [result setUnderrunCount:stats.underruns];
+        [result _setUsageWithStart:start end:end];
+    }
+
+    StreamServerFree(server);
+
+    for (size_t i = 0; i < streamCount; i++) {
+        NoisyProgramFree(programs[i]);
+    }
+
+    free(programs);
+
+    return result;
+}
+
+
+- (BenchmarkResult *) _runProgram:(NoisyProgram *)program bufferFrameCount:(size_t)bufferFrameCount
+{
+    return [self _runWithBufferFrameCount:bufferFrameCount render:^(float *left, float *right, size_t frameCount) {
+        NoisyProgramProcess(program, left, right, frameCount);
+        NoisyProgramApplyAutoGain(program, left, right, frameCount);
+
+        if (NoisyProgramGetChannelCount(program) == 1) {
+            memcpy(right, left, sizeof(float) * frameCount);
+        }
+    }];
+}
+
+
+// { type, normalized frequency, Q, gain } per section, log-spaced from 100 Hz to 8 kHz
+- (double *) _makeDesignsWithSectionCount:(size_t)sectionCount
+{
+    double *designs = calloc(sectionCount * 4, sizeof(double));
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        double position = sectionCount > 1 ? (double)i / (sectionCount - 1) : 0;
+
+        designs[(i * 4) + 0] = BiquadTypePeaking;
+        designs[(i * 4) + 1] = (100.0 * pow(80.0, position)) / _sampleRate;
+        designs[(i * 4) + 2] = 2.0;
+        designs[(i * 4) + 3] = (i % 2) ? -6.0 : 6.0;
+    }
+
+    return designs;
+}
+
+
+- (BenchmarkResult *) _runBiquadsNode:(NoisyBiquadsNode *)biquadsNode bufferFrameCount:(size_t)bufferFrameCount
+{
+    NoisyGeneratorNode *generator = NoisyGeneratorNodeCreate(NoisyGeneratorTypeUniform, 0, 0);
+
+    BenchmarkResult *result = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *left, float *right, size_t frameCount) {
+        NoisyGeneratorNodeProcess(generator, left, frameCount);
+        NoisyBiquadsNodeProcess(biquadsNode, left, frameCount);
+    }];
+
+    NoisyGeneratorNodeFree(generator);
+
+    return result;
+}
+
+
+// Times vDSP_biquad() and BiquadCascade with the same coefficients, filled by +[Biquad fillCoefficients:...]
+- (NSArray<BenchmarkResult *> *) _runBiquadsWithSectionCount:(size_t)sectionCount bufferFrameCount:(size_t)bufferFrameCount
+{
+    double *designs = [self _makeDesignsWithSectionCount:sectionCount];
+    NSMutableArray *biquads = [NSMutableArray array];
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        const double *design = &designs[i * 4];
+
+        [biquads addObject:[[Biquad alloc] initWithType: (BiquadType)design[0]
+                                              frequency: design[1] * _sampleRate
+                                                      Q: design[2]
+                                                   gain: design[3]]];
+    }
+
+    free(designs);
+
+    double *coefficients = calloc(sectionCount * 5, sizeof(double));
+    [Biquad fillCoefficients:coefficients biquadArray:biquads sampleRate:_sampleRate];
+
+    vDSP_biquad_Setup setup = vDSP_biquad_CreateSetup(coefficients, sectionCount);
+    float *delay = calloc((2 * sectionCount) + 2, sizeof(float));
+    BiquadCascade *cascade = BiquadCascadeCreate(coefficients, sectionCount, 1);
+
+    // Compare the two paths on the same noise, in buffer-sized calls
+    size_t compareFrameCount = (size_t)(sBiquadsCompareDuration * _sampleRate);
+    float *expected = calloc(compareFrameCount, sizeof(float));
+    float *actual   = calloc(compareFrameCount, sizeof(float));
+
+    NoisyGeneratorNode *generator = NoisyGeneratorNodeCreate(NoisyGeneratorTypeUniform, 0, 0);
+    NoisyGeneratorNodeProcess(generator, expected, compareFrameCount);
+    memcpy(actual, expected, compareFrameCount * sizeof(float));
+
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+
+    for (size_t offset = 0; offset < compareFrameCount; offset += bufferFrameCount) {
+        size_t frameCount = MIN(bufferFrameCount, compareFrameCount - offset);
+
+        vDSP_biquad(setup, delay, expected + offset, 1, expected + offset, 1, frameCount);
+        BiquadCascadeProcess(cascade, actual + offset, NULL, frameCount);
+    }
+
+    FloatingPointRestore(&floatingPointState);
+
+    float peakDifference = 0;
+    float peak = 0;
+    sAccumulateDifference(actual, expected, compareFrameCount, &peakDifference, &peak);
+
+    free(expected);
+    free(actual);
+
+    BenchmarkResult *vDSPResult = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *left, float *right, size_t frameCount) {
+        NoisyGeneratorNodeProcess(generator, left, frameCount);
+        vDSP_biquad(setup, delay, left, 1, left, 1, frameCount);
+    }];
+
+    BenchmarkResult *cascadeResult = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *left, float *right, size_t frameCount) {
+        NoisyGeneratorNodeProcess(generator, left, frameCount);
+        BiquadCascadeProcess(cascade, left, NULL, frameCount);
+    }];
+
+    [vDSPResult    setPresetName:[NSString stringWithFormat:@"vDSP_biquad (%zu sections)", sectionCount]];
+    [cascadeResult setPresetName:[NSString stringWithFormat:@"BiquadCascade (%zu sections)", sectionCount]];
+    [cascadeResult setDifference:sGetDifference(peakDifference, peak)];
+
+    NoisyGeneratorNodeFree(generator);
+    BiquadCascadeFree(cascade);
+    vDSP_biquad_DestroySetup(setup);
+    free(delay);
+    free(coefficients);
+
+    return @[ vDSPResult, cascadeResult ];
+}
+
+
+// What the control-rate path replaces: every coefficient recomputed for every frame
+static void sProcessPerSample(
+    BiquadCascade *cascade,
+    double *coefficients,
+    const double *designs,
+    size_t sectionCount,
+    double phaseStep,
+    double *inOutPhase,
+    float *buffer,
+    size_t frameCount
+) {
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        double octaves = sin(2.0 * M_PI * *inOutPhase) * sModulationDepth;
+        *inOutPhase = fmod(*inOutPhase + phaseStep, 1.0);
+
+        for (size_t i = 0; i < sectionCount; i++) {
+            const double *design = &designs[i * 4];
+            double frequency = fmin(design[1] * exp2(octaves), 0.49);
+
+            BiquadGetCoefficients((BiquadType)design[0], frequency, design[2], design[3], &coefficients[i * 5]);
+        }
+
+        BiquadCascadeSetCoefficients(cascade, coefficients, 0);
+        BiquadCascadeProcess(cascade, &buffer[frame], NULL, 1);
+    }
+}
+
+
+- (BiquadCascade *) _makePerSampleCascadeWithDesigns:(const double *)designs coefficients:(double *)coefficients
+{
+    size_t sectionCount = (size_t)_sectionCount;
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        const double *design = &designs[i * 4];
+        BiquadGetCoefficients((BiquadType)design[0], design[1], design[2], design[3], &coefficients[i * 5]);
+    }
+
+    return BiquadCascadeCreate(coefficients, sectionCount, 1);
+}
+
+
+- (NoisyBiquadsNode *) _makeModulatedNodeWithDesigns:(const double *)designs
+{
+    size_t sectionCount = (size_t)_sectionCount;
+    double controlRate = _sampleRate / NoisyModulationBlockFrameCount;
+
+    NoisyBiquadsNode *node = NoisyBiquadsNodeCreateWithDesigns(designs, sectionCount);
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        Modulator *modulator = ModulatorCreate(ModulatorShapeSine, sModulationRate / controlRate, 0, 0);
+        NoisyNodeAddModulator(node, modulator, NoisyModulationParameterFrequency, i, sModulationDepth);
+    }
+
+    return node;
+}
+
+
+- (BenchmarkResult *) _runPerSampleWithDesigns:(const double *)designs bufferFrameCount:(size_t)bufferFrameCount
+{
+    size_t sectionCount = (size_t)_sectionCount;
+    double phaseStep = sModulationRate / _sampleRate;
+
+    double *coefficients = calloc(sectionCount * 5, sizeof(double));
+    BiquadCascade *cascade = [self _makePerSampleCascadeWithDesigns:designs coefficients:coefficients];
+    NoisyGeneratorNode *generator = NoisyGeneratorNodeCreate(NoisyGeneratorTypeUniform, 0, 0);
+
+    __block double phase = 0;
+
+    BenchmarkResult *result = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *left, float *right, size_t frameCount) {
+        NoisyGeneratorNodeProcess(generator, left, frameCount);
+        sProcessPerSample(cascade, coefficients, designs, sectionCount, phaseStep, &phase, left, frameCount);
+    }];
+
+    NoisyGeneratorNodeFree(generator);
+    BiquadCascadeFree(cascade);
+    free(coefficients);
+
+    return result;
+}
+
+
+// Renders one full sweep of the same noise through the control-rate and per-sample paths,
+// in buffer-sized calls, and sets the peak and RMS differences of the former
+- (void) _compareModulationWithDesigns:(const double *)designs bufferFrameCount:(size_t)bufferFrameCount result:(BenchmarkResult *)result
+{
+    size_t sectionCount = (size_t)_sectionCount;
+    size_t frameCount = (size_t)ceil(_sampleRate / sModulationRate);
+
+    float *expected = calloc(frameCount, sizeof(float));
+    float *actual   = calloc(frameCount, sizeof(float));
+
+    NoisyGeneratorNode *generator = NoisyGeneratorNodeCreate(NoisyGeneratorTypeUniform, 0, 0);
+    NoisyGeneratorNodeProcess(generator, expected, frameCount);
+    NoisyGeneratorNodeFree(generator);
+
+    memcpy(actual, expected, frameCount * sizeof(float));
+
+    double *coefficients = calloc(sectionCount * 5, sizeof(double));
+    BiquadCascade *cascade = [self _makePerSampleCascadeWithDesigns:designs coefficients:coefficients];
+    NoisyBiquadsNode *node = [self _makeModulatedNodeWithDesigns:designs];
+
+    double phaseStep = sModulationRate / _sampleRate;
+    double phase = 0;
+
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+
+    for (size_t offset = 0; offset < frameCount; offset += bufferFrameCount) {
+        size_t count = MIN(bufferFrameCount, frameCount - offset);
+
+        sProcessPerSample(cascade, coefficients, designs, sectionCount, phaseStep, &phase, expected + offset, count);
+        NoisyBiquadsNodeProcess(node, actual + offset, count);
+    }
+
+    FloatingPointRestore(&floatingPointState);
+
+    float peakDifference = 0;
+    float peak = 0;
+    sAccumulateDifference(actual, expected, frameCount, &peakDifference, &peak);
+
+    double differencePower = 0;
+    double power = 0;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        double difference = (double)actual[i] - expected[i];
+
+        differencePower += difference * difference;
+        power           += (double)expected[i] * expected[i];
+    }
+
+    [result setDifference:sGetDifference(peakDifference, peak)];
+    [result setRmsDifference:differencePower > 0 ? 10.0 * log10(differencePower / power) : -INFINITY];
+
+    NoisyBiquadsNodeFree(node);
+    BiquadCascadeFree(cascade);
+    free(coefficients);
+    free(expected);
+    free(actual);
+}
+
+
+// Renders the batch and its source programs in step, the programs as the per-program
+// path would (process, then scale by auto gain), and returns the peak difference in dB
+- (double) _compareBatch:(NoisyProgramBatch *)batch programs:(NoisyProgram **)programs bufferFrameCount:(size_t)bufferFrameCount
+{
+    size_t laneCount = (size_t)_laneCount;
+    size_t settleBufferCount = (size_t)ceil((sBatchSettleDuration * _sampleRate) / bufferFrameCount);
+    size_t bufferCount = settleBufferCount + (size_t)ceil((sBatchCompareDuration * _sampleRate) / bufferFrameCount);
+
+    float **batchLeft  = calloc(laneCount, sizeof(float *));
+    float **batchRight = calloc(laneCount, sizeof(float *));
+
+    for (size_t i = 0; i < laneCount; i++) {
+        batchLeft[i]  = calloc(bufferFrameCount, sizeof(float));
+        batchRight[i] = calloc(bufferFrameCount, sizeof(float));
+    }
+
+    float *left  = calloc(bufferFrameCount, sizeof(float));
+    float *right = calloc(bufferFrameCount, sizeof(float));
+
+    float peakDifference = 0;
+    float peak = 0;
+
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+
+    for (size_t b = 0; b < bufferCount; b++) {
+        NoisyProgramBatchProcess(batch, batchLeft, batchRight, bufferFrameCount);
+
+        for (size_t i = 0; i < laneCount; i++) {
+            NoisyProgram *program = programs[i];
+
+            float leftGain, rightGain;
+            NoisyProgramGetAutoGain(program, &leftGain, &rightGain);
+
+            NoisyProgramProcess(program, left, right, bufferFrameCount);
+
+            if (NoisyProgramGetChannelCount(program) == 1) {
+                memcpy(right, left, sizeof(float) * bufferFrameCount);
+                rightGain = leftGain;
+            }
+
+            vDSP_vsmul(left,  1, &leftGain,  left,  1, bufferFrameCount);
+            vDSP_vsmul(right, 1, &rightGain, right, 1, bufferFrameCount);
+
+            if (b < settleBufferCount) continue;
+
+            sAccumulateDifference(batchLeft[i],  left,  bufferFrameCount, &peakDifference, &peak);
+            sAccumulateDifference(batchRight[i], right, bufferFrameCount, &peakDifference, &peak);
+        }
+    }
+
+    FloatingPointRestore(&floatingPointState);
+
+    for (size_t i = 0; i < laneCount; i++) {
+        free(batchLeft[i]);
+        free(batchRight[i]);
+    }
+
+    free(batchLeft);
+    free(batchRight);
+    free(left);
+    free(right);
+
+    return sGetDifference(peakDifference, peak);
+}
+
+
+- (NSArray<BenchmarkResult *> *) _runBatchWithPreset:(Preset *)preset bufferFrameCount:(size_t)bufferFrameCount
+{
+    size_t laneCount = (size_t)_laneCount;
+    NoisyProgram **programs = calloc(laneCount, sizeof(NoisyProgram *));
+    NSError *error = nil;
+
+    for (size_t i = 0; i < laneCount && !error; i++) {
+        programs[i] = NoisyProgramCreate(preset, _channelCount, _sampleRate, nil, &error);
+    }
+
+    NoisyProgramBatch *batch = error ? NULL : NoisyProgramBatchCreate(programs, laneCount);
+    if (!error && !batch) error = sMakeError(@"Cannot be batched");
+
+    NSArray *results;
+
+    if (error) {
+        BenchmarkResult *result = [[BenchmarkResult alloc] init];
+
+        [result setBufferFrameCount:bufferFrameCount];
+        [result setError:error];
+        [result setPresetName:[preset name]];
+
+        results = @[ result ];
+
+    } else {
+        for (size_t i = 0; i < laneCount; i++) {
+            NoisyProgramBatchSetPlaying(batch, i, YES, 2);
+        }
+
+        // The batch copied the programs' states, so both paths continue from the same point
+        double difference = [self _compareBatch:batch programs:programs bufferFrameCount:bufferFrameCount];
+
+        float *left  = calloc(bufferFrameCount, sizeof(float));
+        float *right = calloc(bufferFrameCount, sizeof(float));
+
+        BenchmarkResult *serialResult = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *unusedLeft, float *unusedRight, size_t frameCount) {
+            for (size_t i = 0; i < laneCount; i++) {
+                float leftGain, rightGain;
+                NoisyProgramGetAutoGain(programs[i], &leftGain, &rightGain);
+
+                NoisyProgramProcess(programs[i], left, right, frameCount);
+
+                vDSP_vsmul(left,  1, &leftGain,  left,  1, frameCount);
+                vDSP_vsmul(right, 1, &rightGain, right, 1, frameCount);
+            }
+        }];
+
+        float **batchLeft  = calloc(laneCount, sizeof(float *));
+        float **batchRight = calloc(laneCount, sizeof(float *));
+
+        for (size_t i = 0; i < laneCount; i++) {
+            batchLeft[i]  = calloc(bufferFrameCount, sizeof(float));
+            batchRight[i] = calloc(bufferFrameCount, sizeof(float));
+        }
+
+        BenchmarkResult *batchResult = [self _runWithBufferFrameCount:bufferFrameCount render:^(float *unusedLeft, float *unusedRight, size_t frameCount) {
+            NoisyProgramBatchProcess(batch, batchLeft, batchRight, frameCount);
+        }];
+
+        for (size_t i = 0; i < laneCount; i++) {
+            free(batchLeft[i]);
+            free(batchRight[i]);
+        }
+
+        free(batchLeft);
+        free(batchRight);
+        free(left);
+        free(right);
+
+        [serialResult setPresetName:[NSString stringWithFormat:@"%@ (x%zu)", [preset name], laneCount]];
+        [batchResult  setPresetName:[NSString stringWithFormat:@"%@ (x%zu, batched)", [preset name], laneCount]];
+        [batchResult  setDifference:difference];
+
+        results = @[ serialResult, batchResult ];
+    }
+
+    NoisyProgramBatchFree(batch);
+
+    for (size_t i = 0; i < laneCount; i++) {
+        NoisyProgramFree(programs[i]);
+    }
+
+    free(programs);
+
+    return results;
+}
+
+
+// Writes jobCount files of the preset with an ExportQueue, and waits for them on the main run loop
+- (BenchmarkResult *) _runExportWithPreset:(Preset *)preset jobCount:(NSInteger)jobCount concurrentJobCount:(NSInteger)concurrentJobCount
+{
+    NSString *directoryName = [NSString stringWithFormat:@"NoisyBenchmark-%@", [[NSUUID UUID] UUIDString]];
+    NSURL *directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:directoryName]];
+
+    [[NSFileManager defaultManager] createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:NULL];
+
+    NSMutableArray *jobs = [NSMutableArray array];
+
+    for (NSInteger i = 0; i < jobCount; i++) {
+        NSURL *fileURL = [directoryURL URLByAppendingPathComponent:[NSString stringWithFormat:@"%ld.wav", (long)i]];
+
+        [jobs addObject:[[ExportJob alloc] initWithPreset: preset
+                                                  fileURL: fileURL
+                                               sampleRate: _sampleRate
+                                             channelCount: _channelCount
+                                                 duration: _duration]];
+    }
+
+    ExportQueue *queue = [[ExportQueue alloc] initWithJobs:jobs];
+    [queue setMaximumConcurrentJobCount:concurrentJobCount];
+
+    BenchmarkUsage start, end;
+    sGetUsage(&start);
+
+    [queue start];
+
+    while ([queue isRunning]) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    }
+
+    sGetUsage(&end);
+
+    [[NSFileManager defaultManager] removeItemAtURL:directoryURL error:NULL];
+
+    BenchmarkResult *result = [[BenchmarkResult alloc] init];
+
+    // Rendering is spread over the queue's workers, so only process time applies
+    [result setPresetName:[NSString stringWithFormat:@"%@ (%ld of %ld at once)", [preset name], (long)concurrentJobCount, (long)jobCount]];
+    [result setBufferFrameCount:(size_t)llround(sExportChunkDuration * _sampleRate)];
+    [result setAudioDuration:jobCount * _duration];
+    [result setThreadCPUTime:NAN];
+    [result setThroughput:[queue throughput]];
+    [result _setUsageWithStart:start end:end];
+
+    for (ExportJob *job in jobs) {
+        if ([job error]) {
+            [result setError:[job error]];
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+#pragma mark - Public Methods
+
+- (NSArray<BenchmarkResult *> *) run
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        [results addObject:[self _runProgram:NULL bufferFrameCount:bufferFrameCount]];
+
+        for (Preset *preset in _presets) {
+            @autoreleasepool {
+                NSError *error = nil;
+                NoisyProgram *program = NoisyProgramCreate(preset, _channelCount, _sampleRate, nil, &error);
+
+                BenchmarkResult *result;
+
+                if (program) {
+                    result = [self _runProgram:program bufferFrameCount:bufferFrameCount];
+                    NoisyProgramFree(program);
+
+                } else {
+                    result = [[BenchmarkResult alloc] init];
+                    [result setBufferFrameCount:bufferFrameCount];
+                    [result setError:error];
+                }
+
+                [result setPresetName:[preset name]];
+                [results addObject:result];
+            }
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runBiquads
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        [results addObject:[self _runWithBufferFrameCount:bufferFrameCount render:nil]];
+
+        for (size_t sectionCount = 1; sectionCount <= (size_t)_sectionCount; sectionCount++) {
+            @autoreleasepool {
+                [results addObjectsFromArray:[self _runBiquadsWithSectionCount:sectionCount bufferFrameCount:bufferFrameCount]];
+            }
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runExport
+{
+    NSMutableArray *results = [NSMutableArray array];
+    NSInteger jobCount = [[NSProcessInfo processInfo] activeProcessorCount];
+
+    for (Preset *preset in _presets) {
+        @autoreleasepool {
+            [results addObject:[self _runExportWithPreset:preset jobCount:jobCount concurrentJobCount:1]];
+            [results addObject:[self _runExportWithPreset:preset jobCount:jobCount concurrentJobCount:jobCount]];
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runDevice
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        [results addObject:[self _runDeviceWithProgram:NULL bufferFrameCount:bufferFrameCount]];
+
+        for (Preset *preset in _presets) {
+            @autoreleasepool {
+                NSError *error = nil;
+                NoisyProgram *program = NoisyProgramCreate(preset, _channelCount, _sampleRate, nil, &error);
+
+                BenchmarkResult *result;
+
+                if (program) {
+                    result = [self _runDeviceWithProgram:program bufferFrameCount:bufferFrameCount];
+                    NoisyProgramFree(program);
+
+                } else {
+                    result = [[BenchmarkResult alloc] init];
+                    [result setBufferFrameCount:bufferFrameCount];
+                    [result setError:error];
+                }
+
+                [result setPresetName:[preset name]];
+                [results addObject:result];
+            }
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runStreams
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        for (Preset *preset in _presets) {
+            for (NSNumber *streamCountNumber in _streamCounts) {
+                size_t streamCount = [streamCountNumber unsignedIntegerValue];
+                if (streamCount == 0) continue;
+
+                @autoreleasepool {
+                    [results addObject:[self _runStreamsWithPreset:preset streamCount:streamCount bufferFrameCount:bufferFrameCount]];
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runBatch
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        [results addObject:[self _runWithBufferFrameCount:bufferFrameCount render:nil]];
+
+        for (Preset *preset in _presets) {
+            @autoreleasepool {
+                [results addObjectsFromArray:[self _runBatchWithPreset:preset bufferFrameCount:bufferFrameCount]];
+            }
+        }
+    }
+
+    return results;
+}
+
+
+- (NSArray<BenchmarkResult *> *) runModulation
+{
+    NSMutableArray *results = [NSMutableArray array];
+
+    size_t sectionCount = (size_t)_sectionCount;
+    double *designs = [self _makeDesignsWithSectionCount:sectionCount];
+
+    for (NSNumber *bufferFrameCountNumber in _bufferFrameCounts) {
+        size_t bufferFrameCount = [bufferFrameCountNumber unsignedIntegerValue];
+        if (bufferFrameCount == 0) continue;
+
+        [results addObject:[self _runWithBufferFrameCount:bufferFrameCount render:nil]];
+
+        @autoreleasepool {
+            NoisyBiquadsNode *staticNode = NoisyBiquadsNodeCreateWithDesigns(designs, sectionCount);
+            BenchmarkResult *staticResult = [self _runBiquadsNode:staticNode bufferFrameCount:bufferFrameCount];
+            NoisyBiquadsNodeFree(staticNode);
+
+            NoisyBiquadsNode *modulatedNode = [self _makeModulatedNodeWithDesigns:designs];
+            BenchmarkResult *modulatedResult = [self _runBiquadsNode:modulatedNode bufferFrameCount:bufferFrameCount];
+            NoisyBiquadsNodeFree(modulatedNode);
+
+            [self _compareModulationWithDesigns:designs bufferFrameCount:bufferFrameCount result:modulatedResult];
+
+            BenchmarkResult *perSampleResult = [self _runPerSampleWithDesigns:designs bufferFrameCount:bufferFrameCount];
+
+            [staticResult    setPresetName:@"Static biquads"];
+            [modulatedResult setPresetName:@"Control-rate modulation"];
+            [perSampleResult setPresetName:@"Per-sample recomputation"];
+
+            [results addObjectsFromArray:@[ staticResult, modulatedResult, perSampleResult ]];
+        }
+    }
+
+    free(designs);
+
+    return results;
+}
+
+
++ (NSString *) tableWithResults:(NSArray<BenchmarkResult *> *)results
+{
+    NSMutableString *table = [NSMutableString string];
+
+    [table appendFormat:@"%-32s %7s %11s %11s %8s %10s %10s %8s %9s %10s %11s %8s %8s %8s\n",
+        "Preset", "Buffer", "CPU s/h", "Proc s/h", "Load", "Wakeups/s", "Energy J/h", "Misses", "Underruns", "Jitter us", "Max wake us", "Diff dB", "RMS dB", "Speed x"];
+
+    for (BenchmarkResult *result in results) {
+        NSString *name = [result presetName] ?: @"(idle)";
+
+        if ([result error]) {
+            [table appendFormat:@"%-32s %7zu  %@\n",
+                [name UTF8String], [result bufferFrameCount], [[result error] localizedDescription]];
+            continue;
+        }
+
+        [table appendFormat:@"%-32s %7zu %11.2f %11.2f %7.2f%% %10.1f %10.1f %8llu %9llu %10.1f %11.1f %8.1f %8.1f %8.1f\n",
+            [name UTF8String],
+            [result bufferFrameCount],
+            [result cpuSecondsPerHour],
+            [result processCPUSecondsPerHour],
+            [result load] * 100.0,
+            [result wakeupsPerSecond],
+            [result joulesPerHour],
+            [result deadlineMissCount],
+            [result underrunCount],
+            [result wakeJitter] * 1e6,
+            [result maxWakeLatency] * 1e6,
+            [result difference],
+            [result rmsDifference],
+            [result throughput]
+        ];
+    }
+
+    return table;
+}
+
+
++ (NSString *) CSVWithResults:(NSArray<BenchmarkResult *> *)results
+{
+    NSMutableString *csv = [NSMutableString stringWithString:
+        @"preset,buffer_frames,audio_seconds,cpu_seconds_per_hour,process_cpu_seconds_per_hour,load,wakeups_per_second,joules_per_hour,deadline_misses,underruns,wake_jitter_us,max_wake_latency_us,difference_db,rms_difference_db,throughput,error\n"];
+
+    for (BenchmarkResult *result in results) {
+        NSString *name  = [[result presetName] ?: @"(idle)" stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""];
+        NSString *error = [[[result error] localizedDescription] ?: @"" stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""];
+
+        [csv appendFormat:@"\"%@\",%zu,%.3f,%.4f,%.4f,%.6f,%.2f,%.2f,%llu,%llu,%.2f,%.2f,%.2f,%.2f,%.2f,\"%@\"\n",
+            name,
+            [result bufferFrameCount],
+            [result audioDuration],
+            [result cpuSecondsPerHour],
+            [result processCPUSecondsPerHour],
+            [result load],
+            [result wakeupsPerSecond],
+            [result joulesPerHour],
+            [result deadlineMissCount],
+            [result underrunCount],
+            [result wakeJitter] * 1e6,
+            [result maxWakeLatency] * 1e6,
+            [result difference],
+            [result rmsDifference],
+            [result throughput],
+            error
+        ];
+    }
+
+    return csv;
+}
+
+
+@end
+
+
+#pragma mark - Command Line
+
+int BenchmarkMain(int argc, const char *argv[])
+{
+    NSTimeInterval duration = 60;
+    NSMutableArray *bufferFrameCounts = [NSMutableArray array];
+    double sampleRate = 48000;
+    NSInteger channelCount = 2;
+    NSMutableArray *identifiers = [NSMutableArray array];
+    NSString *csvPath = nil;
+    NSString *suite = @"presets";
+    NSInteger sectionCount = 16;
+    NSInteger laneCount = 8;
+    NSMutableArray *streamCounts = [NSMutableArray array];
+    NSInteger devicePriority = 0;
+
+    for (int i = 1; i < argc; i++) {
+        NSString *arg   = [NSString stringWithUTF8String:argv[i]];
+        NSString *value = (i + 1 < argc) ? [NSString stringWithUTF8String:argv[i + 1]] : nil;
+
+        if ([arg isEqualToString:@"--benchmark"]) continue;
+
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+
+        if ([arg isEqualToString:@"--duration"]) {
+            duration = [value doubleValue];
+        } else if ([arg isEqualToString:@"--buffer-sizes"]) {
+            for (NSString *component in [value componentsSeparatedByString:@","]) {
+                [bufferFrameCounts addObject:@([component integerValue])];
+            }
+        } else if ([arg isEqualToString:@"--sample-rate"]) {
+            sampleRate = [value doubleValue];
+        } else if ([arg isEqualToString:@"--channels"]) {
+            channelCount = [value integerValue];
+        } else if ([arg isEqualToString:@"--preset"]) {
+            [identifiers addObject:value];
+        } else if ([arg isEqualToString:@"--csv"]) {
+            csvPath = value;
+        } else if ([arg isEqualToString:@"--suite"]) {
+            suite = value;
+        } else if ([arg isEqualToString:@"--sections"]) {
+            sectionCount = [value integerValue];
+        } else if ([arg isEqualToString:@"--lanes"]) {
+            laneCount = [value integerValue];
+        } else if ([arg isEqualToString:@"--priority"]) {
+            devicePriority = [value integerValue];
+        } else if ([arg isEqualToString:@"--streams"]) {
+            for (NSString *component in [value componentsSeparatedByString:@","]) {
+                [streamCounts addObject:@([component integerValue])];
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (duration <= 0 || sampleRate <= 0 || channelCount < 1 || channelCount > 2) {
+        fprintf(stderr, "Invalid duration, sample rate, or channel count\n");
+        return 1;
+    }
+
+    NSArray *suites = @[ @"presets", @"batch", @"streams", @"device", @"export", @"biquads", @"modulation" ];
+
+    if (![suites containsObject:suite] || sectionCount < 1 || laneCount < 1) {
+        fprintf(stderr, "Invalid suite, section count, or lane count\n");
+        return 1;
+    }
+
+    NSMutableArray *presets = [NSMutableArray array];
+
+    for (Preset *preset in [[PresetManager sharedInstance] allPresets]) {
+        if ([identifiers count] == 0 || [identifiers containsObject:[preset identifier]]) {
+            [presets addObject:preset];
+        }
+    }
+
+    Benchmark *benchmark = [[Benchmark alloc] initWithPresets:presets];
+
+    [benchmark setDuration:duration];
+    [benchmark setSampleRate:sampleRate];
+    [benchmark setChannelCount:channelCount];
+    [benchmark setSectionCount:sectionCount];
+    [benchmark setLaneCount:laneCount];
+    [benchmark setDevicePriority:devicePriority];
+    if ([streamCounts count]) [benchmark setStreamCounts:streamCounts];
+    if ([bufferFrameCounts count]) [benchmark setBufferFrameCounts:bufferFrameCounts];
+
+    NSArray *results;
+
+    if ([suite isEqualToString:@"modulation"]) {
+        fprintf(stderr, "Benchmarking modulation of %ld sections for %g seconds each...\n", (long)sectionCount, duration);
+        results = [benchmark runModulation];
+    } else if ([suite isEqualToString:@"biquads"]) {
+        fprintf(stderr, "Benchmarking 1 to %ld biquad sections for %g seconds each...\n", (long)sectionCount, duration);
+        results = [benchmark runBiquads];
+    } else if ([suite isEqualToString:@"export"]) {
+        fprintf(stderr, "Benchmarking export of %ld presets, %g seconds per file...\n", (long)[presets count], duration);
+        results = [benchmark runExport];
+    } else if ([suite isEqualToString:@"device"]) {
+        fprintf(stderr, "Benchmarking %ld presets on the output device for %g seconds each...\n", (long)[presets count], duration);
+        results = [benchmark runDevice];
+    } else if ([suite isEqualToString:@"streams"]) {
+        fprintf(stderr, "Benchmarking %ld presets on the stream server for %g seconds each...\n", (long)[presets count], duration);
+        results = [benchmark runStreams];
+    } else if ([suite isEqualToString:@"batch"]) {
+        fprintf(stderr, "Benchmarking %ld presets with %ld lanes for %g seconds each...\n", (long)[presets count], (long)laneCount, duration);
+        results = [benchmark runBatch];
+    } else {
+        fprintf(stderr, "Benchmarking %ld presets for %g seconds each...\n", (long)[presets count], duration);
+        results = [benchmark run];
+    }
+
+    fputs([[Benchmark tableWithResults:results] UTF8String], stdout);
+
+    if (csvPath) {
+        NSError *error = nil;
+
+        if (![[Benchmark CSVWithResults:results] writeToFile:csvPath atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+            fprintf(stderr, "Could not write %s: %s\n", [csvPath UTF8String], [[error localizedDescription] UTF8String]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -3,15 +3,7 @@
 
 @import Foundation;
 
-typedef NS_ENUM(NSInteger, BiquadType) {
-    BiquadTypePeaking,
-    BiquadTypeLowpass,
-    BiquadTypeHighpass,
-    BiquadTypeBandpass,
-    BiquadTypeNotch,
-    BiquadTypeLowshelf,
-    BiquadTypeHighshelf
-};
+#include "BiquadCoefficients.h"
 
 @interface Biquad : NSObject
 
@@ -0,0 +1,378 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "BiquadCascade.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+typedef float   BiquadVector __attribute__((vector_size(16)));
+typedef int32_t BiquadMask   __attribute__((vector_size(16)));
+
+static const size_t sLaneCount = 4;
+
+// Coefficients are updated this often while ramping
+static const size_t sRampBlockFrameCount = 32;
+
+// Sections with a pole radius above this keep double-precision state
+static const double sDoublePrecisionRadius = 0.998;
+
+
+typedef struct BiquadLaneGroup {
+    BiquadVector b0, b1, b2, a1, a2;
+    BiquadVector s1, s2;
+
+    // Index of the section in each lane pair (stereo) or lane (mono), or -1 for pass-through
+    ssize_t sectionIndices[4];
+} BiquadLaneGroup;
+
+
+typedef struct BiquadDoubleSection {
+    size_t sectionIndex;
+    double b0, b1, b2, a1, a2;
+    double s1[2], s2[2];
+} BiquadDoubleSection;
+
+
+typedef struct BiquadCascade {
+    size_t sectionCount;
+    size_t channelCount;
+
+    double *coefficients;
+    double *coefficientSteps;
+    double *targetCoefficients;
+    size_t rampUpdatesRemaining;
+
+    BiquadDoubleSection *doubleSections;
+    size_t doubleSectionCount;
+
+    BiquadLaneGroup *laneGroups;
+    size_t laneGroupCount;
+} BiquadCascade;
+
+
+#pragma mark - Private Functions
+
+static double sGetPoleRadius(const double *c)
+{
+    double a1 = c[3], a2 = c[4];
+    double discriminant = (a1 * a1) - (4.0 * a2);
+
+    if (discriminant < 0) {
+        return sqrt(a2);
+    }
+
+    double root = sqrt(discriminant);
+    return fmax(fabs((-a1 + root) * 0.5), fabs((-a1 - root) * 0.5));
+}
+
+
+static void sLoadCoefficients(BiquadCascade *self)
+{
+    for (size_t i = 0; i < self->doubleSectionCount; i++) {
+        BiquadDoubleSection *section = &self->doubleSections[i];
+        const double *c = &self->coefficients[section->sectionIndex * 5];
+
+        section->b0 = c[0];
+        section->b1 = c[1];
+        section->b2 = c[2];
+        section->a1 = c[3];
+        section->a2 = c[4];
+    }
+
+    for (size_t g = 0; g < self->laneGroupCount; g++) {
+        BiquadLaneGroup *group = &self->laneGroups[g];
+
+        for (size_t k = 0; k < sLaneCount; k++) {
+            ssize_t sectionIndex = group->sectionIndices[k / self->channelCount];
+
+            if (sectionIndex < 0) {
+                group->b0[k] = 1.0f;
+                group->b1[k] = group->b2[k] = group->a1[k] = group->a2[k] = 0.0f;
+
+            } else {
+                const double *c = &self->coefficients[sectionIndex * 5];
+
+                group->b0[k] = c[0];
+                group->b1[k] = c[1];
+                group->b2[k] = c[2];
+                group->a1[k] = c[3];
+                group->a2[k] = c[4];
+            }
+        }
+    }
+}
+
+
+static void sProcessDoubleSection(BiquadDoubleSection *section, size_t channel, float *buffer, size_t frameCount)
+{
+    const double b0 = section->b0, b1 = section->b1, b2 = section->b2;
+    const double a1 = section->a1, a2 = section->a2;
+
+    double s1 = section->s1[channel];
+    double s2 = section->s2[channel];
+
+    for (size_t i = 0; i < frameCount; i++) {
+        double x = buffer[i];
+        double y = (b0 * x) + s1;
+
+        s1 = (b1 * x) - (a1 * y) + s2;
+        s2 = (b2 * x) - (a2 * y);
+
+        buffer[i] = y;
+    }
+
+    section->s1[channel] = s1;
+    section->s2[channel] = s2;
+}
+
+
+/*
+    Lanes hold { section 0, section 1, ... } for mono and
+    { left 0, right 0, left 1, right 1 } for stereo. At step t, the
+    lanes of section j process frame t - j, so the pipeline needs
+    (sectionsPerGroup - 1) extra steps to fill and drain. During those
+    steps, lanes without a valid frame keep their state.
+*/
+static inline __attribute__((always_inline)) BiquadMask sGetValidMask(size_t step, size_t frameCount, size_t channelCount)
+{
+    BiquadMask mask = { 0 };
+
+    for (size_t k = 0; k < sLaneCount; k++) {
+        size_t j = k / channelCount;
+        mask[k] = (step >= j && (step - j) < frameCount) ? -1 : 0;
+    }
+
+    return mask;
+}
+
+
+static inline __attribute__((always_inline)) void sProcessLaneGroup(
+    BiquadLaneGroup *group,
+    float *left,
+    float *right,
+    size_t frameCount,
+    size_t channelCount
+) {
+    const size_t latency = (sLaneCount / channelCount) - 1;
+    const size_t outputLane = sLaneCount - channelCount;
+
+    const BiquadVector b0 = group->b0, b1 = group->b1, b2 = group->b2;
+    const BiquadVector a1 = group->a1, a2 = group->a2;
+
+    BiquadVector s1 = group->s1;
+    BiquadVector s2 = group->s2;
+    BiquadVector y  = { 0 };
+
+    #define STEP(T, MASKED) { \
+        size_t step = (T); \
+        BiquadVector x; \
+        if (channelCount == 1) { \
+            x = (BiquadVector){ (step < frameCount) ? left[step] : 0.0f, y[0], y[1], y[2] }; \
+        } else { \
+            x = (BiquadVector){ (step < frameCount) ? left[step] : 0.0f, (step < frameCount) ? right[step] : 0.0f, y[0], y[1] }; \
+        } \
+        y = (b0 * x) + s1; \
+        BiquadVector n1 = (b1 * x) - (a1 * y) + s2; \
+        BiquadVector n2 = (b2 * x) - (a2 * y); \
+        if (MASKED) { \
+            BiquadMask mask = sGetValidMask(step, frameCount, channelCount); \
+            s1 = (BiquadVector)(((BiquadMask)n1 & mask) | ((BiquadMask)s1 & ~mask)); \
+            s2 = (BiquadVector)(((BiquadMask)n2 & mask) | ((BiquadMask)s2 & ~mask)); \
+        } else { \
+            s1 = n1; \
+            s2 = n2; \
+        } \
+        if (step >= latency) { \
+            left[step - latency] = y[outputLane]; \
+            if (channelCount == 2) right[step - latency] = y[outputLane + 1]; \
+        } \
+    }
+
+    size_t drainStart = (frameCount > latency) ? frameCount : latency;
+
+    for (size_t t = 0;          t < latency;                 t++) STEP(t, true);
+    for (size_t t = latency;    t < frameCount;              t++) STEP(t, false);
+    for (size_t t = drainStart; t < frameCount + latency;    t++) STEP(t, true);
+
+    #undef STEP
+
+    group->s1 = s1;
+    group->s2 = s2;
+}
+
+
+static void sProcessLaneGroupMono(BiquadLaneGroup *group, float *buffer, size_t frameCount)
+{
+    sProcessLaneGroup(group, buffer, NULL, frameCount, 1);
+}
+
+
+static void sProcessLaneGroupStereo(BiquadLaneGroup *group, float *left, float *right, size_t frameCount)
+{
+    sProcessLaneGroup(group, left, right, frameCount, 2);
+}
+
+
+static void sProcess(BiquadCascade *self, float *left, float *right, size_t frameCount)
+{
+    for (size_t i = 0; i < self->doubleSectionCount; i++) {
+        sProcessDoubleSection(&self->doubleSections[i], 0, left, frameCount);
+        if (right) sProcessDoubleSection(&self->doubleSections[i], 1, right, frameCount);
+    }
+
+    for (size_t g = 0; g < self->laneGroupCount; g++) {
+        if (right) {
+            sProcessLaneGroupStereo(&self->laneGroups[g], left, right, frameCount);
+        } else {
+            sProcessLaneGroupMono(&self->laneGroups[g], left, frameCount);
+        }
+    }
+}
+
+
+#pragma mark - Public Functions
+
+BiquadCascade *BiquadCascadeCreate(const double *coefficients, size_t sectionCount, size_t channelCount)
+{
+    if (channelCount < 1 || channelCount > 2) return NULL;
+
+    BiquadCascade *self = calloc(1, sizeof(BiquadCascade));
+
+    self->sectionCount = sectionCount;
+    self->channelCount = channelCount;
+
+    size_t coefficientCount = sectionCount * 5;
+
+    self->coefficients       = calloc(coefficientCount + 1, sizeof(double));
+    self->coefficientSteps   = calloc(coefficientCount + 1, sizeof(double));
+    self->targetCoefficients = calloc(coefficientCount + 1, sizeof(double));
+
+    if (sectionCount > 0) {
+        memcpy(self->coefficients, coefficients, coefficientCount * sizeof(double));
+    }
+
+    // Split sections into double-precision sections and lane groups
+    size_t sectionsPerGroup = sLaneCount / channelCount;
+    size_t floatSectionCount = 0;
+
+    self->doubleSections = calloc(sectionCount + 1, sizeof(BiquadDoubleSection));
+    self->laneGroups     = calloc((sectionCount / sectionsPerGroup) + 1, sizeof(BiquadLaneGroup));
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        if (sGetPoleRadius(&coefficients[i * 5]) > sDoublePrecisionRadius) {
+            self->doubleSections[self->doubleSectionCount++].sectionIndex = i;
+
+        } else {
+            size_t g = floatSectionCount / sectionsPerGroup;
+            size_t j = floatSectionCount % sectionsPerGroup;
+
+            if (j == 0) {
+                for (size_t k = 0; k < sLaneCount; k++) {
+                    self->laneGroups[g].sectionIndices[k] = -1;
+                }
+
+                self->laneGroupCount++;
+            }
+
+            self->laneGroups[g].sectionIndices[j] = i;
+            floatSectionCount++;
+        }
+    }
+
+    sLoadCoefficients(self);
+
+    return self;
+}
+
+
+void BiquadCascadeFree(BiquadCascade *self)
+{
+    if (!self) return;
+
+    free(self->coefficients);
+    free(self->coefficientSteps);
+    free(self->targetCoefficients);
+    free(self->doubleSections);
+    free(self->laneGroups);
+
+    free(self);
+}
+
+
+void BiquadCascadeSetCoefficients(BiquadCascade *self, const double *coefficients, size_t rampFrameCount)
+{
+    size_t coefficientCount = self->sectionCount * 5;
+    size_t updateCount = (rampFrameCount + sRampBlockFrameCount - 1) / sRampBlockFrameCount;
+
+    if (coefficientCount == 0) return;
+
+    memcpy(self->targetCoefficients, coefficients, coefficientCount * sizeof(double));
+
+    if (updateCount == 0) {
+        memcpy(self->coefficients, coefficients, coefficientCount * sizeof(double));
+        self->rampUpdatesRemaining = 0;
+        sLoadCoefficients(self);
+        return;
+    }
+
+    for (size_t i = 0; i < coefficientCount; i++) {
+        self->coefficientSteps[i] = (coefficients[i] - self->coefficients[i]) / updateCount;
+    }
+
+    self->rampUpdatesRemaining = updateCount;
+}
+
+
+void BiquadCascadeReset(BiquadCascade *self)
+{
+    for (size_t i = 0; i < self->doubleSectionCount; i++) {
+        BiquadDoubleSection *section = &self->doubleSections[i];
+        section->s1[0] = section->s1[1] = 0;
+        section->s2[0] = section->s2[1] = 0;
+    }
+
+    for (size_t g = 0; g < self->laneGroupCount; g++) {
+        self->laneGroups[g].s1 = (BiquadVector){ 0 };
+        self->laneGroups[g].s2 = (BiquadVector){ 0 };
+    }
+}
+
+
+size_t BiquadCascadeGetSectionCount(BiquadCascade *self)
+{
+    return self->sectionCount;
+}
+
+
+void BiquadCascadeProcess(BiquadCascade *self, float *left, float *right, size_t frameCount)
+{
+    if (self->sectionCount == 0) return;
+    if (self->channelCount == 1) right = NULL;
+
+    while (self->rampUpdatesRemaining > 0 && frameCount > 0) {
+        size_t coefficientCount = self->sectionCount * 5;
+        size_t blockFrameCount = frameCount < sRampBlockFrameCount ? frameCount : sRampBlockFrameCount;
+
+        if (--self->rampUpdatesRemaining == 0) {
+            memcpy(self->coefficients, self->targetCoefficients, coefficientCount * sizeof(double));
+        } else {
+            for (size_t i = 0; i < coefficientCount; i++) {
+                self->coefficients[i] += self->coefficientSteps[i];
+            }
+        }
+
+        sLoadCoefficients(self);
+        sProcess(self, left, right, blockFrameCount);
+
+        left  += blockFrameCount;
+        right  = right ? right + blockFrameCount : NULL;
+        frameCount -= blockFrameCount;
+    }
+
+    if (frameCount > 0) {
+        sProcess(self, left, right, frameCount);
+    }
+}
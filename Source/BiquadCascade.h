@@ -0,0 +1,50 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _BIQUAD_CASCADE_H_
+#define _BIQUAD_CASCADE_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+/*
+    Cascade of biquad sections in transposed direct form II.
+
+    Coefficients use the vDSP_biquad() layout, five per section:
+    { b0, b1, b2, a1, a2 }, as filled by +[Biquad fillCoefficients:...].
+
+    Sections with poles close to the unit circle (low frequencies at high
+    sample rates) keep double-precision state. The others are processed
+    four lanes at a time: with one channel, each lane runs a section and
+    the lanes are pipelined (lane k works on the sample that lane k - 1
+    finished in the previous step). With two channels, each lane pair runs
+    one section on the left and right channels. The pipeline is filled and
+    drained within each call, so there is no added latency.
+
+    The cascade is treated as linear and time-invariant, so sections may
+    run in a different order than given.
+
+    BiquadCascadeProcess() does not allocate or lock.
+*/
+
+typedef struct BiquadCascade BiquadCascade;
+
+extern BiquadCascade *BiquadCascadeCreate(const double *coefficients, size_t sectionCount, size_t channelCount);
+
+extern void BiquadCascadeFree(BiquadCascade *self);
+
+/*
+    Moves towards new coefficients over rampFrameCount frames. The
+    coefficients are interpolated linearly, updating every 32 frames.
+    Pass 0 to switch immediately.
+*/
+extern void BiquadCascadeSetCoefficients(BiquadCascade *self, const double *coefficients, size_t rampFrameCount);
+
+extern void BiquadCascadeReset(BiquadCascade *self);
+
+extern size_t BiquadCascadeGetSectionCount(BiquadCascade *self);
+
+// right must be NULL when channelCount is 1
+extern void BiquadCascadeProcess(BiquadCascade *self, float *left, float *right, size_t frameCount);
+
+#endif
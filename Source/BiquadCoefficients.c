@@ -0,0 +1,93 @@
+// (c) 2019-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "BiquadCoefficients.h"
+
+#include <math.h>
+
+
+void BiquadGetCoefficients(BiquadType type, double frequency, double Q, double gain, double *outCoefficients)
+{
+    double b0 = 0;
+    double b1 = 0;
+    double b2 = 0;
+    double a0 = 0;
+    double a1 = 0;
+    double a2 = 0;
+
+    double A      = pow(10, gain / 40.0);
+    double w0     = 2 * M_PI * frequency;
+    double sin_w0 = sin(w0);
+    double cos_w0 = cos(w0);
+    double alpha  = sin_w0 / (2 * Q);
+
+    if (type == BiquadTypeLowpass) {
+        b0 =  (1.0 - cos_w0) / 2.0;
+        b1 =   1.0 - cos_w0;
+        b2 =  (1.0 - cos_w0) / 2.0;
+        a0 =   1.0 + alpha;
+        a1 =  -2.0 * cos_w0;
+        a2 =   1.0 - alpha;
+
+    } else if (type == BiquadTypeHighpass) {
+        b0 =  (1.0 + cos_w0) / 2.0;
+        b1 = -(1.0 + cos_w0);
+        b2 =  (1.0 + cos_w0) / 2.0;
+        a0 =   1.0 + alpha;
+        a1 =  -2.0 * cos_w0;
+        a2 =   1.0 - alpha;
+
+    } else if (type == BiquadTypeBandpass) {
+        b0 =   alpha;
+        b1 =   0.0;
+        b2 =  -alpha;
+        a0 =   1.0 + alpha;
+        a1 =  -2.0 * cos_w0;
+        a2 =   1.0 - alpha;
+
+    } else if (type == BiquadTypeNotch) {
+        b0 =   1.0;
+        b1 =  -2.0 * cos_w0;
+        b2 =   1.0;
+        a0 =   1.0 + alpha;
+        a1 =  -2.0 * cos_w0;
+        a2 =   1.0 - alpha;
+
+    } else if (type == BiquadTypeLowshelf || type == BiquadTypeHighshelf) {
+        double Aplus1      = A + 1.0;
+        double Aminus1     = A - 1.0;
+        double Aplus1_cos  = Aplus1  * cos_w0;
+        double Aminus1_cos = Aminus1 * cos_w0;
+        double beta_sin    = sqrt(A) * M_SQRT2 * sin_w0;
+
+        if (type == BiquadTypeLowshelf) {
+            b0 =        A * ( Aplus1  - Aminus1_cos + beta_sin );
+            b1 =  2.0 * A * ( Aminus1 - Aplus1_cos             );
+            b2 =        A * ( Aplus1  - Aminus1_cos - beta_sin );
+            a0 =            ( Aplus1  + Aminus1_cos + beta_sin );
+            a1 = -2.0     * ( Aminus1 + Aplus1_cos             );
+            a2 =            ( Aplus1  + Aminus1_cos - beta_sin );
+        } else {
+            b0 =        A * ( Aplus1  + Aminus1_cos + beta_sin );
+            b1 = -2.0 * A * ( Aminus1 + Aplus1_cos             );
+            b2 =        A * ( Aplus1  + Aminus1_cos - beta_sin );
+            a0 =            ( Aplus1  - Aminus1_cos + beta_sin );
+            a1 =  2.0     * ( Aminus1 - Aplus1_cos             );
+            a2 =            ( Aplus1  - Aminus1_cos - beta_sin );
+        }
+
+    } else if (type == BiquadTypePeaking) {
+        b0 =   1.0 + alpha * A;
+        b1 =  -2.0 * cos_w0;
+        b2 =   1.0 - alpha * A;
+        a0 =   1.0 + alpha / A;
+        a1 =  -2.0 * cos_w0;
+        a2 =   1.0 - alpha / A;
+    }
+
+    outCoefficients[0] = b0 / a0;
+    outCoefficients[1] = b1 / a0;
+    outCoefficients[2] = b2 / a0;
+    outCoefficients[3] = a1 / a0;
+    outCoefficients[4] = a2 / a0;
+}
@@ -0,0 +1,30 @@
+// (c) 2019-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _BIQUAD_COEFFICIENTS_H_
+#define _BIQUAD_COEFFICIENTS_H_
+
+#include <sys/types.h>
+
+typedef enum BiquadType {
+    BiquadTypePeaking,
+    BiquadTypeLowpass,
+    BiquadTypeHighpass,
+    BiquadTypeBandpass,
+    BiquadTypeNotch,
+    BiquadTypeLowshelf,
+    BiquadTypeHighshelf
+} BiquadType;
+
+/*
+    Implements the standard "Cookbook formulae" from Audio-EQ-Cookbook.txt
+    by Robert Bristow-Johnson.
+
+    frequency is normalized (frequency / sampleRate) and gain is in dB.
+    Writes five coefficients in the vDSP_biquad() layout: { b0, b1, b2, a1, a2 }.
+
+    Does not allocate, so it may be called from the render thread.
+*/
+extern void BiquadGetCoefficients(BiquadType type, double frequency, double Q, double gain, double *outCoefficients);
+
+#endif
@@ -0,0 +1,121 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+@import Foundation;
+
+typedef struct NoisyNodeList NoisyNodeList;
+
+
+/*
+    A CompiledPreset is the validated, sample-rate independent form of a preset,
+    produced once per preset revision by ProgramBuilder. It lives in a single
+    contiguous buffer so it can be written to disk and mapped back in.
+
+    Layout: a CompiledPresetHeader, followed by the name (UTF-8), the node records,
+    the modulator records, the value pool (doubles), the sample pool (floats), the
+    dependency records, and the dependency paths (UTF-8). Each region starts on an
+    8-byte boundary.
+
+    Dependencies are the files that the preset reads, such as impulse responses,
+    along with their size and modification date when they were read.
+
+    Node records are stored in pre-order. A list record is followed by its `count`
+    nodes, and a split record is followed by its `count` branch lists. The head list
+    comes first. Stereo presets then have a left list and a right list.
+
+    Modulator records refer to their target by the index of its node record.
+*/
+
+// Lists nest through split nodes. Deeper presets are rejected when built and when read.
+enum { CompiledPresetMaximumListDepth = 32 };
+
+typedef NS_ENUM(uint32_t, CompiledNodeType) {
+    CompiledNodeTypeList,
+    CompiledNodeTypeBiquads,     // count: sections, values: { type, frequency, Q, gain } per section
+    CompiledNodeTypeConvolve,    // count: samples, values: { sample rate }
+    CompiledNodeTypeDCBlock,
+    CompiledNodeTypeDecorrelate, // values: { duration in ms, density }
+    CompiledNodeTypeGain,        // values: { gain in dB }
+    CompiledNodeTypeGenerator,   // subtype: NoisyGeneratorType, values: { density }
+    CompiledNodeTypeOnePole,     // subtype: 1 if highpass, values: { frequency }
+    CompiledNodeTypePinking,     // subtype: NoisyPinkingType
+    CompiledNodeTypeSpectral,    // count: points, values: { frequency, gain } per point, sorted
+    CompiledNodeTypeSplit,       // count: branches
+    CompiledNodeTypeZero
+};
+
+
+typedef struct CompiledNode {
+    uint32_t type;
+    uint32_t subtype;
+    uint32_t count;
+    uint32_t valueIndex;
+    uint32_t sampleIndex;
+    uint32_t reserved;
+} CompiledNode;
+
+
+typedef struct CompiledModulator {
+    uint32_t nodeIndex;
+    uint32_t shape;     // ModulatorShape
+    uint32_t parameter; // NoisyModulationParameter
+    uint32_t section;   // Of a Biquads node, otherwise 0
+    double rate;        // In Hz
+    double depth;       // In dB for gains, in octaves for frequencies and Q
+    double phase;       // 0 to 1
+} CompiledModulator;
+
+
+@interface CompiledPreset : NSObject
+
+- (instancetype) initWithName: (NSString *) name
+                        nodes: (const CompiledNode *) nodes
+                    nodeCount: (size_t) nodeCount
+                       values: (const double *) values
+                   valueCount: (size_t) valueCount
+                      samples: (const float *) samples
+                  sampleCount: (size_t) sampleCount
+                   modulators: (const CompiledModulator *) modulators
+               modulatorCount: (size_t) modulatorCount
+                 dependencies: (NSDictionary<NSString *, NSDictionary<NSFileAttributeKey, id> *> *) dependencies
+                     isStereo: (BOOL) isStereo
+                autoGainLevel: (double) autoGainLevel
+             autoGainLoudness: (double) autoGainLoudness
+           isAutoGainSeparate: (BOOL) isAutoGainSeparate;
+
+// Maps the file if possible. Returns nil if it is missing, from another format
+// version, not derived from a source file with the given modification date, or
+// if any of its dependencies has changed size or modification date.
+- (instancetype) initWithContentsOfURL: (NSURL *) fileURL
+              sourceModificationDate: (NSDate *) sourceModificationDate;
+
+- (BOOL) writeToURL: (NSURL *) fileURL
+    sourceModificationDate: (NSDate *) sourceModificationDate
+                     error: (NSError **) outError;
+
+/*
+    Creates node lists for a program. Sample-rate dependent work (filter
+    coefficients, impulse resampling, density checks) happens here.
+    A mono preset with channelCount > 1 gets two independent copies of its
+    node list as the left and right lists.
+*/
+- (BOOL) makeHeadNodeList: (NoisyNodeList **) outHeadNodeList
+             leftNodeList: (NoisyNodeList **) outLeftNodeList
+            rightNodeList: (NoisyNodeList **) outRightNodeList
+             channelCount: (size_t) channelCount
+               sampleRate: (double) sampleRate
+                    error: (NSError **) outError;
+
+@property (nonatomic, readonly) NSString *name;
+@property (nonatomic, readonly, getter=isStereo) BOOL stereo;
+
+@property (nonatomic, readonly) double autoGainLevel;    // Peak ceiling, in dBFS
+@property (nonatomic, readonly) double autoGainLoudness; // Target, in LUFS
+@property (nonatomic, readonly, getter=isAutoGainSeparate) BOOL autoGainSeparate;
+
+// The settled auto gain of the most recent program, so that the next program
+// starts at the right level. Snapshots written afterwards include it.
+- (void) setComputedAutoGainLeft:(float)left right:(float)right;
+- (BOOL) getComputedAutoGainLeft:(float *)outLeft right:(float *)outRight;
+
+@end
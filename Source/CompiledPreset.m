@@ -0,0 +1,823 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#import "CompiledPreset.h"
+
+#import "BiquadCoefficients.h"
+#import "NoisyNode.h"
+#import "ProgramBuilder.h"
+
+@import AVFAudio;
+@import Accelerate;
+
+
+// Bump when the layout or the meaning of any record changes
+static const uint32_t sMagic   = 0x4359534E; // "NSYC"
+static const uint32_t sVersion = 4;
+
+typedef struct CompiledPresetHeader {
+    uint32_t magic;
+    uint32_t version;
+
+    double sourceModificationDate;
+
+    double   autoGainLevel;
+    double   autoGainLoudness;
+    uint32_t isAutoGainSeparate;
+    uint32_t isStereo;
+
+    uint32_t hasComputedAutoGain;
+    float    computedLeftAutoGain;
+    float    computedRightAutoGain;
+
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t nodeOffset;
+    uint32_t nodeCount;
+    uint32_t modulatorOffset;
+    uint32_t modulatorCount;
+    uint32_t valueOffset;
+    uint32_t valueCount;
+    uint32_t sampleOffset;
+    uint32_t sampleCount;
+    uint32_t dependencyOffset;
+    uint32_t dependencyCount;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+} CompiledPresetHeader;
+
+
+typedef struct CompiledDependency {
+    double   modificationDate;
+    uint64_t fileSize;
+    uint32_t pathIndex; // Into the dependency paths, in bytes
+    uint32_t pathLength;
+} CompiledDependency;
+
+
+static size_t sAlign(size_t offset)
+{
+    return (offset + 7) & ~(size_t)7;
+}
+
+
+static BOOL sIsDependencyCurrent(NSString *path, const CompiledDependency *dependency)
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:NULL];
+    if (!attributes) return NO;
+
+    return [attributes fileSize] == dependency->fileSize &&
+           [[attributes fileModificationDate] timeIntervalSinceReferenceDate] == dependency->modificationDate;
+}
+
+
+static float *sCreateResampledImpulse(
+    const float *impulse,
+    size_t impulseLength,
+    double inSampleRate,
+    double outSampleRate,
+    size_t *outLength,
+    NSError **outError
+) {
+    AVAudioFormat *inFormat  = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:inSampleRate  channels:1];
+    AVAudioFormat *outFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:outSampleRate channels:1];
+
+    AVAudioPCMBuffer *inBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:inFormat frameCapacity:(AVAudioFrameCount)impulseLength];
+    memcpy([inBuffer floatChannelData][0], impulse, impulseLength * sizeof(float));
+    [inBuffer setFrameLength:(AVAudioFrameCount)impulseLength];
+
+    AVAudioConverter *converter = [[AVAudioConverter alloc] initFromFormat:inFormat toFormat:outFormat];
+    [converter setSampleRateConverterQuality:AVAudioQualityMax];
+
+    AVAudioFrameCount outFrameCount = (AVAudioFrameCount)ceil(impulseLength * (outSampleRate / inSampleRate)) + 1024;
+    AVAudioPCMBuffer *outBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:outFormat frameCapacity:outFrameCount];
+
+    __block BOOL didProvideInput = NO;
+    NSError *error = nil;
+
+    [converter convertToBuffer:outBuffer error:&error withInputFromBlock:^(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+        if (didProvideInput) {
+            *outStatus = AVAudioConverterInputStatus_EndOfStream;
+            return (AVAudioBuffer *)nil;
+        }
+
+        didProvideInput = YES;
+        *outStatus = AVAudioConverterInputStatus_HaveData;
+        return (AVAudioBuffer *)inBuffer;
+    }];
+
+    if (error) {
+        if (outError) *outError = error;
+        return NULL;
+    }
+
+    size_t length = [outBuffer frameLength];
+    float *result = malloc(length * sizeof(float));
+
+    memcpy(result, [outBuffer floatChannelData][0], length * sizeof(float));
+
+    *outLength = length;
+    return result;
+}
+
+
+#pragma mark - Reader
+
+/*
+    Walks the node records of a CompiledPreset and creates nodes for a
+    specific sample rate. Every record and pool access is bounds-checked, as
+    the records may come from a snapshot on disk.
+*/
+@interface CompiledPresetReader : NSObject
+@end
+
+
+@implementation CompiledPresetReader {
+    const CompiledNode *_nodes;
+    size_t _nodeCount;
+    size_t _nodeIndex;
+
+    const CompiledModulator *_modulators;
+    size_t _modulatorCount;
+
+    // Shared by both copies of a mono preset, so that they modulate together
+    uint64_t _modulatorSeed;
+
+    const double *_values;
+    size_t _valueCount;
+
+    const float *_samples;
+    size_t _sampleCount;
+
+    double _sampleRate;
+
+    // Of the list being read, see CompiledPresetMaximumListDepth
+    size_t _listDepth;
+
+    NSError *_error;
+}
+
+
+- (instancetype) initWithHeader: (const CompiledPresetHeader *) header
+                     sampleRate: (double) sampleRate
+{
+    if ((self = [super init])) {
+        const uint8_t *bytes = (const uint8_t *)header;
+
+        _nodes       = (const CompiledNode *)(bytes + header->nodeOffset);
+        _nodeCount   = header->nodeCount;
+        _modulators     = (const CompiledModulator *)(bytes + header->modulatorOffset);
+        _modulatorCount = header->modulatorCount;
+        _values      = (const double *)(bytes + header->valueOffset);
+        _valueCount  = header->valueCount;
+        _samples     = (const float *)(bytes + header->sampleOffset);
+        _sampleCount = header->sampleCount;
+
+        _sampleRate  = sampleRate;
+
+        _modulatorSeed = [self _nextRandomSeed];
+    }
+
+    return self;
+}
+
+
+- (void) _raiseError:(NSString *)format, ... NS_FORMAT_FUNCTION(1,2)
+{
+    va_list v;
+    va_start(v, format);
+
+    if (!_error) {
+        NSString *errorString = [[NSString alloc] initWithFormat:format arguments:v];
+
+        _error = [NSError errorWithDomain:ProgramBuilderErrorDomain code:-1001 userInfo:@{
+            NSLocalizedDescriptionKey: errorString
+        }];
+    }
+
+    va_end(v);
+}
+
+
+- (const CompiledNode *) _nextNode
+{
+    if (_nodeIndex >= _nodeCount) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NULL;
+    }
+
+    return &_nodes[_nodeIndex++];
+}
+
+
+// Every child of a list or split takes at least one record, so larger counts are damaged
+- (BOOL) _checkChildCount:(size_t)count
+{
+    if (count > (_nodeCount - _nodeIndex)) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NO;
+    }
+
+    return YES;
+}
+
+
+- (const double *) _valuesForNode:(const CompiledNode *)node count:(size_t)count
+{
+    if (node->valueIndex > _valueCount || count > (_valueCount - node->valueIndex)) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NULL;
+    }
+
+    return _values + node->valueIndex;
+}
+
+
+// Enums are stored as integers (or doubles, for biquad types), so check them before casting
+- (BOOL) _checkEnumValue:(double)value maximum:(uint32_t)maximum
+{
+    if (!(value >= 0 && value <= maximum) || value != floor(value)) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NO;
+    }
+
+    return YES;
+}
+
+
+- (uint64_t) _nextRandomSeed
+{
+    return arc4random();
+}
+
+
+- (BOOL) _checkDensity:(double)density
+{
+    if (density > _sampleRate) {
+        [self _raiseError:@"Density of %g must be no more than the sample rate (%g)", density, _sampleRate];
+        return NO;
+    }
+
+    return YES;
+}
+
+
+- (NoisyNodeRef) _makeBiquadsNode:(const CompiledNode *)node
+{
+    const double *values = [self _valuesForNode:node count:(4 * (size_t)node->count)];
+    if (!values) return NULL;
+
+    for (size_t i = 0; i < node->count; i++) {
+        if (![self _checkEnumValue:values[(4 * i)] maximum:BiquadTypeHighshelf]) return NULL;
+    }
+
+    // Keep the designs, with normalized frequencies, so that sections may be modulated
+    double *designs = malloc(4 * node->count * sizeof(double));
+
+    for (size_t i = 0; i < node->count; i++) {
+        designs[(4 * i)]     = values[(4 * i)];
+        designs[(4 * i) + 1] = values[(4 * i) + 1] / _sampleRate;
+        designs[(4 * i) + 2] = values[(4 * i) + 2];
+        designs[(4 * i) + 3] = values[(4 * i) + 3];
+    }
+
+    NoisyBiquadsNode *result = NoisyBiquadsNodeCreateWithDesigns(designs, node->count);
+
+    free(designs);
+
+    return result;
+}
+
+
+- (NoisyNodeRef) _makeConvolveNode:(const CompiledNode *)node
+{
+    const double *values = [self _valuesForNode:node count:1];
+    if (!values) return NULL;
+
+    if (node->count == 0 || node->sampleIndex > _sampleCount || node->count > (_sampleCount - node->sampleIndex)) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NULL;
+    }
+
+    const float *impulse = _samples + node->sampleIndex;
+    size_t impulseLength = node->count;
+    double impulseSampleRate = values[0];
+
+    float *resampled = NULL;
+
+    if (impulseSampleRate != _sampleRate) {
+        NSError *error = nil;
+        resampled = sCreateResampledImpulse(impulse, impulseLength, impulseSampleRate, _sampleRate, &impulseLength, &error);
+
+        if (!resampled) {
+            [self _raiseError:@"Could not resample impulse response: %@", [error localizedDescription]];
+            return NULL;
+        }
+
+        impulse = resampled;
+    }
+
+    // 256-frame head partitions set the latency. The tail runs on a worker thread.
+    NoisyConvolveNode *result = NoisyConvolveNodeCreate(impulse, impulseLength, 256, 4096, YES);
+
+    free(resampled);
+
+    return result;
+}
+
+
+- (NoisyNodeRef) _makeDecorrelateNode:(const CompiledNode *)node
+{
+    const double *values = [self _valuesForNode:node count:2];
+    if (!values || ![self _checkDensity:values[1]]) return NULL;
+
+    size_t length = (size_t)round((values[0] / 1000.0) * _sampleRate);
+
+    return NoisyDecorrelateNodeCreate(length, values[1] / _sampleRate, [self _nextRandomSeed]);
+}
+
+
+- (NoisyNodeRef) _makeGeneratorNode:(const CompiledNode *)node
+{
+    const double *values = [self _valuesForNode:node count:1];
+    if (!values || ![self _checkDensity:values[0]]) return NULL;
+    if (![self _checkEnumValue:node->subtype maximum:NoisyGeneratorTypeVelvet]) return NULL;
+
+    NoisyGeneratorType generatorType = (NoisyGeneratorType)node->subtype;
+
+    return NoisyGeneratorNodeCreate(generatorType, values[0] / _sampleRate, [self _nextRandomSeed]);
+}
+
+
+- (NoisyNodeRef) _makeSpectralNode:(const CompiledNode *)node
+{
+    size_t pointCount = node->count;
+
+    const double *values = [self _valuesForNode:node count:(2 * pointCount)];
+    if (!values) return NULL;
+
+    double *frequencies = malloc(pointCount * sizeof(double));
+    double *gains       = malloc(pointCount * sizeof(double));
+
+    for (size_t i = 0; i < pointCount; i++) {
+        frequencies[i] = values[(2 * i)] / _sampleRate;
+        gains[i]       = values[(2 * i) + 1];
+    }
+
+    // Use a 2048-point FFT at 44.1/48kHz, doubling with the sample rate to keep the bin spacing
+    size_t log2FFTSize = 11;
+    while (log2FFTSize < 16 && (_sampleRate / (1 << log2FFTSize)) > 24.0) {
+        log2FFTSize++;
+    }
+
+    NoisySpectralNode *result = NoisySpectralNodeCreate(frequencies, gains, pointCount, log2FFTSize);
+
+    free(frequencies);
+    free(gains);
+
+    return result;
+}
+
+
+- (NoisyNodeRef) _makeSplitNode:(const CompiledNode *)node
+{
+    if (![self _checkChildCount:node->count]) return NULL;
+
+    NoisySplitNode *splitNode = NoisySplitNodeCreate(node->count);
+
+    for (size_t i = 0; i < node->count; i++) {
+        NoisyNodeList *nodeList = [self makeNodeList];
+        if (!nodeList) break;
+
+        NoisySplitNodeAppendNodeList(splitNode, nodeList);
+    }
+
+    if (_error) {
+        NoisyNodeFree(splitNode);
+        return NULL;
+    }
+
+    return splitNode;
+}
+
+
+// Modulators step once per control block, so rates are normalized to it
+- (BOOL) _addModulatorsToNode:(NoisyNodeRef)result nodeIndex:(size_t)nodeIndex
+{
+    double controlRate = _sampleRate / NoisyModulationBlockFrameCount;
+
+    for (size_t i = 0; i < _modulatorCount; i++) {
+        const CompiledModulator *m = &_modulators[i];
+        if (m->nodeIndex != nodeIndex) continue;
+
+        if (m->shape > ModulatorShapeRandom || m->parameter > NoisyModulationParameterQ) {
+            [self _raiseError:@"Compiled preset is damaged"];
+            return NO;
+        }
+
+        Modulator *modulator = ModulatorCreate(m->shape, m->rate / controlRate, m->phase, _modulatorSeed + i);
+
+        if (!NoisyNodeAddModulator(result, modulator, m->parameter, m->section, m->depth)) {
+            [self _raiseError:@"Compiled preset is damaged"];
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+
+- (NoisyNodeRef) _makeNode
+{
+    size_t nodeIndex = _nodeIndex;
+
+    const CompiledNode *node = [self _nextNode];
+    if (!node) return NULL;
+
+    NoisyNodeRef result = [self _makeNodeWithRecord:node];
+    if (!result || _modulatorCount == 0) return result;
+
+    if (![self _addModulatorsToNode:result nodeIndex:nodeIndex]) {
+        NoisyNodeFree(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+- (NoisyNodeRef) _makeNodeWithRecord:(const CompiledNode *)node
+{
+    CompiledNodeType type = node->type;
+    const double *values;
+
+    if (type == CompiledNodeTypeBiquads) {
+        return [self _makeBiquadsNode:node];
+
+    } else if (type == CompiledNodeTypeConvolve) {
+        return [self _makeConvolveNode:node];
+
+    } else if (type == CompiledNodeTypeDCBlock) {
+        return NoisyDCBlockNodeCreate();
+
+    } else if (type == CompiledNodeTypeDecorrelate) {
+        return [self _makeDecorrelateNode:node];
+
+    } else if (type == CompiledNodeTypeGain) {
+        values = [self _valuesForNode:node count:1];
+        return values ? NoisyGainNodeCreate(values[0]) : NULL;
+
+    } else if (type == CompiledNodeTypeGenerator) {
+        return [self _makeGeneratorNode:node];
+
+    } else if (type == CompiledNodeTypeOnePole) {
+        values = [self _valuesForNode:node count:1];
+        return values ? NoisyOnePoleNodeCreate(values[0] / _sampleRate, node->subtype != 0) : NULL;
+
+    } else if (type == CompiledNodeTypePinking) {
+        if (![self _checkEnumValue:node->subtype maximum:NoisyPinkingTypeVoss]) return NULL;
+        return NoisyPinkingNodeCreate((NoisyPinkingType)node->subtype, [self _nextRandomSeed]);
+
+    } else if (type == CompiledNodeTypeSpectral) {
+        return [self _makeSpectralNode:node];
+
+    } else if (type == CompiledNodeTypeSplit) {
+        return [self _makeSplitNode:node];
+
+    } else if (type == CompiledNodeTypeZero) {
+        return NoisyZeroNodeCreate();
+    }
+
+    [self _raiseError:@"Compiled preset is damaged"];
+    return NULL;
+}
+
+
+- (NoisyNodeList *) _makeNodeList
+{
+    const CompiledNode *listNode = [self _nextNode];
+    if (!listNode) return NULL;
+
+    if (listNode->type != CompiledNodeTypeList || ![self _checkChildCount:listNode->count]) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NULL;
+    }
+
+    NoisyNodeList *nodeList = NoisyNodeListCreate(listNode->count);
+
+    for (size_t i = 0; i < listNode->count; i++) {
+        NoisyNodeRef node = [self _makeNode];
+        if (!node) break;
+
+        NoisyNodeListAppend(nodeList, node);
+    }
+
+    if (_error) {
+        NoisyNodeListFree(nodeList);
+        return NULL;
+    }
+
+    return nodeList;
+}
+
+
+// Split nodes recurse into here, so a damaged preset could otherwise exhaust the stack
+- (NoisyNodeList *) makeNodeList
+{
+    if (_listDepth >= CompiledPresetMaximumListDepth) {
+        [self _raiseError:@"Compiled preset is damaged"];
+        return NULL;
+    }
+
+    _listDepth++;
+    NoisyNodeList *nodeList = [self _makeNodeList];
+    _listDepth--;
+
+    return nodeList;
+}
+
+
+- (void) rewind
+{
+    _nodeIndex = 0;
+}
+
+
+- (NSError *) error
+{
+    return _error;
+}
+
+@end
+
+
+#pragma mark - CompiledPreset
+
+@implementation CompiledPreset {
+    NSData *_data;
+
+    BOOL  _hasComputedAutoGain;
+    float _computedLeftAutoGain;
+    float _computedRightAutoGain;
+}
+
+
+- (instancetype) initWithName: (NSString *) name
+                        nodes: (const CompiledNode *) nodes
+                    nodeCount: (size_t) nodeCount
+                       values: (const double *) values
+                   valueCount: (size_t) valueCount
+                      samples: (const float *) samples
+                  sampleCount: (size_t) sampleCount
+                   modulators: (const CompiledModulator *) modulators
+               modulatorCount: (size_t) modulatorCount
+                 dependencies: (NSDictionary<NSString *, NSDictionary<NSFileAttributeKey, id> *> *) dependencies
+                     isStereo: (BOOL) isStereo
+                autoGainLevel: (double) autoGainLevel
+             autoGainLoudness: (double) autoGainLoudness
+           isAutoGainSeparate: (BOOL) isAutoGainSeparate
+{
+    if ((self = [super init])) {
+        NSData *nameData = [name dataUsingEncoding:NSUTF8StringEncoding];
+
+        size_t dependencyCount = [dependencies count];
+        CompiledDependency *dependencyRecords = calloc(MAX(dependencyCount, 1), sizeof(CompiledDependency));
+        NSMutableData *pathData = [NSMutableData data];
+
+        __block size_t dependencyIndex = 0;
+
+        [dependencies enumerateKeysAndObjectsUsingBlock:^(NSString *path, NSDictionary *attributes, BOOL *stop) {
+            NSData *data = [path dataUsingEncoding:NSUTF8StringEncoding];
+
+            dependencyRecords[dependencyIndex++] = (CompiledDependency){
+                [[attributes fileModificationDate] timeIntervalSinceReferenceDate],
+                [attributes fileSize],
+                (uint32_t)[pathData length],
+                (uint32_t)[data length]
+            };
+
+            [pathData appendData:data];
+        }];
+
+        size_t nameOffset       = sAlign(sizeof(CompiledPresetHeader));
+        size_t nodeOffset       = sAlign(nameOffset       + [nameData length]);
+        size_t modulatorOffset  = sAlign(nodeOffset       + (nodeCount       * sizeof(CompiledNode)));
+        size_t valueOffset      = sAlign(modulatorOffset  + (modulatorCount  * sizeof(CompiledModulator)));
+        size_t sampleOffset     = sAlign(valueOffset      + (valueCount      * sizeof(double)));
+        size_t dependencyOffset = sAlign(sampleOffset     + (sampleCount     * sizeof(float)));
+        size_t pathOffset       = sAlign(dependencyOffset + (dependencyCount * sizeof(CompiledDependency)));
+        size_t length           = pathOffset + [pathData length];
+
+        if (length > UINT32_MAX) {
+            free(dependencyRecords);
+            return nil;
+        }
+
+        NSMutableData *data = [NSMutableData dataWithLength:length];
+        uint8_t *bytes = [data mutableBytes];
+
+        CompiledPresetHeader *header = (CompiledPresetHeader *)bytes;
+
+        header->magic   = sMagic;
+        header->version = sVersion;
+
+        header->autoGainLevel      = autoGainLevel;
+        header->autoGainLoudness   = autoGainLoudness;
+        header->isAutoGainSeparate = isAutoGainSeparate;
+        header->isStereo           = isStereo;
+
+        header->nameOffset      = (uint32_t)nameOffset;
+        header->nameLength      = (uint32_t)[nameData length];
+        header->nodeOffset      = (uint32_t)nodeOffset;
+        header->nodeCount       = (uint32_t)nodeCount;
+        header->modulatorOffset = (uint32_t)modulatorOffset;
+        header->modulatorCount  = (uint32_t)modulatorCount;
+        header->valueOffset     = (uint32_t)valueOffset;
+        header->valueCount      = (uint32_t)valueCount;
+        header->sampleOffset    = (uint32_t)sampleOffset;
+        header->sampleCount     = (uint32_t)sampleCount;
+
+        header->dependencyOffset = (uint32_t)dependencyOffset;
+        header->dependencyCount  = (uint32_t)dependencyCount;
+        header->pathOffset       = (uint32_t)pathOffset;
+        header->pathLength       = (uint32_t)[pathData length];
+
+        if (nameData)       memcpy(bytes + nameOffset,      [nameData bytes], [nameData length]);
+        if (nodeCount)      memcpy(bytes + nodeOffset,      nodes,      nodeCount      * sizeof(CompiledNode));
+        if (modulatorCount) memcpy(bytes + modulatorOffset, modulators, modulatorCount * sizeof(CompiledModulator));
+        if (valueCount)     memcpy(bytes + valueOffset,     values,     valueCount     * sizeof(double));
+        if (sampleCount)    memcpy(bytes + sampleOffset,    samples,    sampleCount    * sizeof(float));
+
+        if (dependencyCount)   memcpy(bytes + dependencyOffset, dependencyRecords, dependencyCount * sizeof(CompiledDependency));
+        if ([pathData length]) memcpy(bytes + pathOffset,       [pathData bytes],  [pathData length]);
+
+        free(dependencyRecords);
+
+        _data = data;
+        _name = name;
+
+        _stereo           = isStereo;
+        _autoGainLevel    = autoGainLevel;
+        _autoGainLoudness = autoGainLoudness;
+        _autoGainSeparate = isAutoGainSeparate;
+    }
+
+    return self;
+}
+
+
+- (instancetype) initWithContentsOfURL: (NSURL *) fileURL
+              sourceModificationDate: (NSDate *) sourceModificationDate
+{
+    if ((self = [super init])) {
+        NSData *data = [NSData dataWithContentsOfURL:fileURL options:NSDataReadingMappedIfSafe error:NULL];
+        if ([data length] < sizeof(CompiledPresetHeader)) return nil;
+
+        const CompiledPresetHeader *header = [data bytes];
+        uint64_t length = [data length];
+
+        if (header->magic != sMagic || header->version != sVersion) return nil;
+        if (header->sourceModificationDate != [sourceModificationDate timeIntervalSinceReferenceDate]) return nil;
+
+        __auto_type isInBounds = ^(uint64_t offset, uint64_t size) {
+            return (offset % 8) == 0 && offset <= length && size <= (length - offset);
+        };
+
+        if (
+            !isInBounds(header->nameOffset,      header->nameLength) ||
+            !isInBounds(header->nodeOffset,      (uint64_t)header->nodeCount      * sizeof(CompiledNode)) ||
+            !isInBounds(header->modulatorOffset, (uint64_t)header->modulatorCount * sizeof(CompiledModulator)) ||
+            !isInBounds(header->valueOffset,     (uint64_t)header->valueCount     * sizeof(double)) ||
+            !isInBounds(header->sampleOffset,    (uint64_t)header->sampleCount    * sizeof(float)) ||
+            !isInBounds(header->dependencyOffset, (uint64_t)header->dependencyCount * sizeof(CompiledDependency)) ||
+            !isInBounds(header->pathOffset,       header->pathLength)
+        ) {
+            return nil;
+        }
+
+        // An edited impulse response leaves the JSON untouched, so check each file that was read
+        const CompiledDependency *dependencies = (const CompiledDependency *)((const uint8_t *)[data bytes] + header->dependencyOffset);
+        const uint8_t *paths = (const uint8_t *)[data bytes] + header->pathOffset;
+
+        for (size_t i = 0; i < header->dependencyCount; i++) {
+            const CompiledDependency *dependency = &dependencies[i];
+
+            if (dependency->pathIndex > header->pathLength || dependency->pathLength > (header->pathLength - dependency->pathIndex)) {
+                return nil;
+            }
+
+            NSString *path = [[NSString alloc] initWithBytes: paths + dependency->pathIndex
+                                                      length: dependency->pathLength
+                                                    encoding: NSUTF8StringEncoding];
+
+            if (!path || !sIsDependencyCurrent(path, dependency)) return nil;
+        }
+
+        _data = data;
+
+        _name = [[NSString alloc] initWithBytes: (const uint8_t *)[data bytes] + header->nameOffset
+                                         length: header->nameLength
+                                       encoding: NSUTF8StringEncoding];
+
+        _stereo           = header->isStereo != 0;
+        _autoGainLevel    = header->autoGainLevel;
+        _autoGainLoudness = header->autoGainLoudness;
+        _autoGainSeparate = header->isAutoGainSeparate != 0;
+
+        _hasComputedAutoGain   = header->hasComputedAutoGain != 0;
+        _computedLeftAutoGain  = header->computedLeftAutoGain;
+        _computedRightAutoGain = header->computedRightAutoGain;
+    }
+
+    return self;
+}
+
+
+- (BOOL) writeToURL: (NSURL *) fileURL
+    sourceModificationDate: (NSDate *) sourceModificationDate
+                     error: (NSError **) outError
+{
+    NSMutableData *data = [_data mutableCopy];
+    CompiledPresetHeader *header = [data mutableBytes];
+
+    header->sourceModificationDate = [sourceModificationDate timeIntervalSinceReferenceDate];
+
+    @synchronized (self) {
+        header->hasComputedAutoGain   = _hasComputedAutoGain;
+        header->computedLeftAutoGain  = _computedLeftAutoGain;
+        header->computedRightAutoGain = _computedRightAutoGain;
+    }
+
+    return [data writeToURL:fileURL options:NSDataWritingAtomic error:outError];
+}
+
+
+- (BOOL) makeHeadNodeList: (NoisyNodeList **) outHeadNodeList
+             leftNodeList: (NoisyNodeList **) outLeftNodeList
+            rightNodeList: (NoisyNodeList **) outRightNodeList
+             channelCount: (size_t) channelCount
+               sampleRate: (double) sampleRate
+                    error: (NSError **) outError
+{
+    CompiledPresetReader *reader = [[CompiledPresetReader alloc] initWithHeader: [_data bytes]
+                                                                     sampleRate: sampleRate];
+
+    NoisyNodeList *headNodeList  = [reader makeNodeList];
+    NoisyNodeList *leftNodeList  = NULL;
+    NoisyNodeList *rightNodeList = NULL;
+
+    if (_stereo) {
+        leftNodeList  = [reader makeNodeList];
+        rightNodeList = [reader makeNodeList];
+
+    } else if (channelCount > 1) {
+        // Read the head list again for an independent right channel
+        [reader rewind];
+
+        leftNodeList  = headNodeList;
+        rightNodeList = [reader makeNodeList];
+        headNodeList  = NULL;
+    }
+
+    if ([reader error]) {
+        NoisyNodeFree(headNodeList);
+        NoisyNodeFree(leftNodeList);
+        NoisyNodeFree(rightNodeList);
+
+        if (outError) *outError = [reader error];
+        return NO;
+    }
+
+    *outHeadNodeList  = headNodeList;
+    *outLeftNodeList  = leftNodeList;
+    *outRightNodeList = rightNodeList;
+
+    return YES;
+}
+
+
+// Set on the snapshot queue, and read by programs being built on other queues
+- (void) setComputedAutoGainLeft:(float)left right:(float)right
+{
+    @synchronized (self) {
+        _hasComputedAutoGain   = YES;
+        _computedLeftAutoGain  = left;
+        _computedRightAutoGain = right;
+    }
+}
+
+
+- (BOOL) getComputedAutoGainLeft:(float *)outLeft right:(float *)outRight
+{
+    @synchronized (self) {
+        if (!_hasComputedAutoGain) return NO;
+
+        *outLeft  = _computedLeftAutoGain;
+        *outRight = _computedRightAutoGain;
+    }
+
+    return YES;
+}
+
+
+@end
@@ -0,0 +1,448 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "Convolver.h"
+#include "FFT.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <dispatch/dispatch.h>
+#include <Accelerate/Accelerate.h>
+
+
+#pragma mark - Stage
+
+/*
+    Uniformly-partitioned overlap-save convolution (UPOLS).
+
+    The impulse response is split into partitionCount partitions of blockSize samples,
+    each zero-padded and transformed with an FFT of twice the block size. Input spectra
+    are kept in a frequency-domain delay line (FDL) so each block needs one forward FFT,
+    partitionCount complex multiply-accumulates, and one inverse FFT.
+*/
+typedef struct Stage {
+    FFT *fft;
+    size_t blockSize;
+    size_t binCount;
+    size_t partitionCount;
+
+    float *filterStorage;
+    float *delayLineStorage;
+    DSPSplitComplex *filters;
+    DSPSplitComplex *delayLine;
+    size_t delayLineIndex;
+
+    DSPSplitComplex accumulator;
+    float *history;
+    float *scratch;
+} Stage;
+
+
+static size_t sGetLog2(size_t n)
+{
+    size_t result = 0;
+    while (((size_t)1 << result) < n) result++;
+    return result;
+}
+
+
+static Stage *sStageCreate(const float *impulse, size_t impulseLength, size_t blockSize)
+{
+    Stage *self = calloc(1, sizeof(Stage));
+
+    size_t fftSize        = blockSize * 2;
+    size_t binCount       = blockSize;
+    size_t partitionCount = (impulseLength + blockSize - 1) / blockSize;
+
+    self->fft            = FFTCreate(sGetLog2(fftSize));
+    self->blockSize      = blockSize;
+    self->binCount       = binCount;
+    self->partitionCount = partitionCount;
+
+    self->filterStorage    = calloc(partitionCount * binCount * 2, sizeof(float));
+    self->delayLineStorage = calloc(partitionCount * binCount * 2, sizeof(float));
+    self->filters          = calloc(partitionCount, sizeof(DSPSplitComplex));
+    self->delayLine        = calloc(partitionCount, sizeof(DSPSplitComplex));
+
+    for (size_t p = 0; p < partitionCount; p++) {
+        float *filter = self->filterStorage    + (p * binCount * 2);
+        float *delay  = self->delayLineStorage + (p * binCount * 2);
+
+        self->filters[p]   = (DSPSplitComplex){ filter, filter + binCount };
+        self->delayLine[p] = (DSPSplitComplex){ delay,  delay  + binCount };
+    }
+
+    self->accumulator.realp = calloc(binCount, sizeof(float));
+    self->accumulator.imagp = calloc(binCount, sizeof(float));
+    self->history = calloc(fftSize, sizeof(float));
+    self->scratch = calloc(fftSize, sizeof(float));
+
+    // Fold the forward (x2 for the input, x2 for the filter) and inverse (xN) scaling into the filters
+    float scale = 1.0 / (4.0 * fftSize);
+
+    for (size_t p = 0; p < partitionCount; p++) {
+        size_t offset = p * blockSize;
+        size_t length = MIN(blockSize, impulseLength - offset);
+
+        memset(self->scratch, 0, fftSize * sizeof(float));
+        memcpy(self->scratch, impulse + offset, length * sizeof(float));
+
+        FFTForward(self->fft, self->scratch, &self->filters[p]);
+
+        vDSP_vsmul(self->filters[p].realp, 1, &scale, self->filters[p].realp, 1, binCount);
+        vDSP_vsmul(self->filters[p].imagp, 1, &scale, self->filters[p].imagp, 1, binCount);
+    }
+
+    return self;
+}
+
+
+static void sStageFree(Stage *self)
+{
+    if (!self) return;
+
+    FFTFree(self->fft);
+
+    free(self->filterStorage);
+    free(self->delayLineStorage);
+    free(self->filters);
+    free(self->delayLine);
+    free(self->accumulator.realp);
+    free(self->accumulator.imagp);
+    free(self->history);
+    free(self->scratch);
+
+    free(self);
+}
+
+
+// Convolves one block of blockSize input samples into blockSize output samples
+static void sStageProcess(Stage *self, const float *input, float *output)
+{
+    size_t blockSize      = self->blockSize;
+    size_t binCount       = self->binCount;
+    size_t partitionCount = self->partitionCount;
+
+    memmove(self->history, self->history + blockSize, blockSize * sizeof(float));
+    memcpy(self->history + blockSize, input, blockSize * sizeof(float));
+
+    size_t index = self->delayLineIndex;
+    FFTForward(self->fft, self->history, &self->delayLine[index]);
+
+    DSPSplitComplex *accumulator = &self->accumulator;
+    vDSP_vclr(accumulator->realp, 1, binCount);
+    vDSP_vclr(accumulator->imagp, 1, binCount);
+
+    // The packed DC and Nyquist terms are purely real and must not be mixed by the complex multiply
+    float dc = 0;
+    float nyquist = 0;
+
+    for (size_t p = 0; p < partitionCount; p++) {
+        const DSPSplitComplex *x = &self->delayLine[(index + partitionCount - p) % partitionCount];
+        const DSPSplitComplex *h = &self->filters[p];
+
+        dc      += x->realp[0] * h->realp[0];
+        nyquist += x->imagp[0] * h->imagp[0];
+
+        vDSP_zvma(x, 1, h, 1, accumulator, 1, accumulator, 1, binCount);
+    }
+
+    accumulator->realp[0] = dc;
+    accumulator->imagp[0] = nyquist;
+
+    self->delayLineIndex = (index + 1) % partitionCount;
+
+    FFTInverse(self->fft, accumulator, self->scratch);
+    memcpy(output, self->scratch + blockSize, blockSize * sizeof(float));
+}
+
+
+#pragma mark - Convolver
+
+typedef struct Convolver {
+    size_t headBlockSize;
+    size_t tailBlockSize;
+
+    Stage *head;
+    Stage *tail;
+
+    float *inputBlock;
+    float *outputBlock;
+    size_t blockIndex;
+    uint64_t headBlockCount;
+
+    float *tailInput;
+    size_t tailInputIndex;
+    uint64_t tailBlockCount;
+
+    // Double-buffered tail jobs, see ConvolverCreate(). Slots hold (tail block index + 1), or 0.
+    float *jobInputs[2];
+    float *jobOutputs[2];
+    _Atomic(uint64_t) jobsPosted[2];
+    _Atomic(uint64_t) jobsCompleted[2];
+    _Atomic(size_t) stallCount;
+
+    // Set by ConvolverSetRealTime()
+    bool realTime;
+
+    bool useWorkerThread;
+    pthread_t thread;
+    dispatch_semaphore_t semaphore;
+    _Atomic(bool) quit;
+} Convolver;
+
+
+// Runs the oldest pending job. Jobs are posted in order, but a real-time caller may drop one.
+static void sRunTailJob(Convolver *self)
+{
+    uint64_t posted[2];
+    bool pending[2];
+
+    for (size_t i = 0; i < 2; i++) {
+        posted[i]  = atomic_load_explicit(&self->jobsPosted[i], memory_order_acquire);
+        pending[i] = posted[i] != atomic_load_explicit(&self->jobsCompleted[i], memory_order_relaxed);
+    }
+
+    size_t slot;
+
+    if (pending[0] && pending[1]) {
+        slot = (posted[0] < posted[1]) ? 0 : 1;
+    } else if (pending[0] || pending[1]) {
+        slot = pending[0] ? 0 : 1;
+    } else {
+        return;
+    }
+
+    sStageProcess(self->tail, self->jobInputs[slot], self->jobOutputs[slot]);
+
+    atomic_store_explicit(&self->jobsCompleted[slot], posted[slot], memory_order_release);
+}
+
+
+static void *sWorkerMain(void *context)
+{
+    Convolver *self = context;
+
+    while (1) {
+        dispatch_semaphore_wait(self->semaphore, DISPATCH_TIME_FOREVER);
+        if (atomic_load(&self->quit)) break;
+
+        sRunTailJob(self);
+    }
+
+    return NULL;
+}
+
+
+/*
+    Timeline, in output sample indices (before the headBlockSize latency):
+
+    - Tail job k receives input samples [k * T, (k + 1) * T) and is posted when
+      the last of those samples arrives.
+    - The tail impulse starts at 2 * T, so job k produces output samples
+      [(k + 2) * T, (k + 3) * T), which are first needed one full tail block
+      after the job was posted.
+    - Job k + 2 reuses the slots of job k. It is posted only after the last head
+      block that reads job k's output.
+
+    In real-time mode, a head block whose tail job is late goes without its tail
+    contribution. If job k is still running when job k + 2 is ready, job k + 2 is
+    dropped so that the worker can catch up.
+*/
+Convolver *ConvolverCreate(
+    const float *impulse,
+    size_t impulseLength,
+    size_t headBlockSize,
+    size_t tailBlockSize,
+    bool useWorkerThread
+) {
+    if (headBlockSize == 0 || (headBlockSize & (headBlockSize - 1))) return NULL;
+    if (tailBlockSize < headBlockSize || (tailBlockSize % headBlockSize)) return NULL;
+    if (impulseLength == 0) return NULL;
+
+    Convolver *self = calloc(1, sizeof(Convolver));
+
+    size_t headLength = MIN(impulseLength, 2 * tailBlockSize);
+
+    self->headBlockSize = headBlockSize;
+    self->tailBlockSize = tailBlockSize;
+    self->head = sStageCreate(impulse, headLength, headBlockSize);
+
+    self->inputBlock  = calloc(headBlockSize, sizeof(float));
+    self->outputBlock = calloc(headBlockSize, sizeof(float));
+
+    if (impulseLength > headLength) {
+        self->tail = sStageCreate(impulse + headLength, impulseLength - headLength, tailBlockSize);
+
+        self->tailInput = calloc(tailBlockSize, sizeof(float));
+
+        for (size_t i = 0; i < 2; i++) {
+            self->jobInputs[i]  = calloc(tailBlockSize, sizeof(float));
+            self->jobOutputs[i] = calloc(tailBlockSize, sizeof(float));
+        }
+
+        if (useWorkerThread) {
+            self->useWorkerThread = true;
+            self->semaphore = dispatch_semaphore_create(0);
+
+            // Each job has a full tail block before it is needed, which is too long and too
+            // variable for a time constraint policy, but it must not queue behind UI work
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_set_qos_class_np(&attr, QOS_CLASS_USER_INTERACTIVE, 0);
+
+            pthread_create(&self->thread, &attr, sWorkerMain, self);
+            pthread_attr_destroy(&attr);
+        }
+    }
+
+    return self;
+}
+
+
+void ConvolverFree(Convolver *self)
+{
+    if (!self) return;
+
+    if (self->useWorkerThread) {
+        atomic_store(&self->quit, true);
+        dispatch_semaphore_signal(self->semaphore);
+        pthread_join(self->thread, NULL);
+        dispatch_release(self->semaphore);
+    }
+
+    sStageFree(self->head);
+    sStageFree(self->tail);
+
+    free(self->inputBlock);
+    free(self->outputBlock);
+    free(self->tailInput);
+
+    for (size_t i = 0; i < 2; i++) {
+        free(self->jobInputs[i]);
+        free(self->jobOutputs[i]);
+    }
+
+    free(self);
+}
+
+
+static void sProcessBlock(Convolver *self)
+{
+    size_t headBlockSize = self->headBlockSize;
+    size_t tailBlockSize = self->tailBlockSize;
+
+    sStageProcess(self->head, self->inputBlock, self->outputBlock);
+
+    if (!self->tail) return;
+
+    // Add the tail contribution for this block
+    uint64_t outputStart = self->headBlockCount * headBlockSize;
+
+    if (outputStart >= (2 * tailBlockSize)) {
+        uint64_t job = (outputStart / tailBlockSize) - 2;
+        size_t slot = job % 2;
+
+        bool isPosted = atomic_load_explicit(&self->jobsPosted[slot], memory_order_relaxed) == (job + 1);
+        bool isReady  = isPosted && atomic_load_explicit(&self->jobsCompleted[slot], memory_order_acquire) == (job + 1);
+
+        if (!isReady) {
+            atomic_fetch_add_explicit(&self->stallCount, 1, memory_order_relaxed);
+
+            // Priming and exporting wait for the worker. A real-time caller never does.
+            if (isPosted && !self->realTime) {
+                while (atomic_load_explicit(&self->jobsCompleted[slot], memory_order_acquire) != (job + 1)) {
+                    sched_yield();
+                }
+
+                isReady = true;
+            }
+        }
+
+        if (isReady) {
+            float *tailOutput = self->jobOutputs[slot] + (outputStart - ((job + 2) * tailBlockSize));
+            vDSP_vadd(self->outputBlock, 1, tailOutput, 1, self->outputBlock, 1, headBlockSize);
+        }
+    }
+
+    // Accumulate input for the next tail job
+    memcpy(self->tailInput + self->tailInputIndex, self->inputBlock, headBlockSize * sizeof(float));
+    self->tailInputIndex += headBlockSize;
+
+    if (self->tailInputIndex == tailBlockSize) {
+        uint64_t job = self->tailBlockCount++;
+        size_t slot = job % 2;
+
+        self->tailInputIndex = 0;
+
+        // The worker is still running job - 2. Drop this job rather than overwrite its input.
+        if (
+            atomic_load_explicit(&self->jobsCompleted[slot], memory_order_acquire) !=
+            atomic_load_explicit(&self->jobsPosted[slot],    memory_order_relaxed)
+        ) {
+            return;
+        }
+
+        memcpy(self->jobInputs[slot], self->tailInput, tailBlockSize * sizeof(float));
+        atomic_store_explicit(&self->jobsPosted[slot], job + 1, memory_order_release);
+
+        if (self->useWorkerThread) {
+            dispatch_semaphore_signal(self->semaphore);
+        } else {
+            sRunTailJob(self);
+        }
+    }
+}
+
+
+void ConvolverProcess(Convolver *self, float *buffer, size_t frameCount)
+{
+    size_t headBlockSize = self->headBlockSize;
+
+    while (frameCount > 0) {
+        size_t blockIndex = self->blockIndex;
+        size_t framesToProcess = MIN(frameCount, headBlockSize - blockIndex);
+
+        // Exchange input samples for output samples from the previous block
+        for (size_t i = 0; i < framesToProcess; i++) {
+            float input = buffer[i];
+            buffer[i] = self->outputBlock[blockIndex + i];
+            self->inputBlock[blockIndex + i] = input;
+        }
+
+        blockIndex += framesToProcess;
+
+        if (blockIndex == headBlockSize) {
+            sProcessBlock(self);
+            self->headBlockCount++;
+            blockIndex = 0;
+        }
+
+        self->blockIndex = blockIndex;
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+    }
+}
+
+
+size_t ConvolverGetLatency(Convolver *self)
+{
+    return self->headBlockSize;
+}
+
+
+void ConvolverSetRealTime(Convolver *self, bool realTime)
+{
+    self->realTime = realTime;
+}
+
+
+size_t ConvolverGetStallCount(Convolver *self)
+{
+    return atomic_load_explicit(&self->stallCount, memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _CONVOLVER_H_
+#define _CONVOLVER_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+/*
+    Partitioned FFT convolution for long impulse responses.
+
+    The first (2 * tailBlockSize) samples of the impulse response are convolved with
+    uniform partitions of headBlockSize, which sets the latency. The remainder is convolved
+    with uniform partitions of tailBlockSize. Each tail block is started as soon as its input
+    is complete and is not needed until one full tail block later, so it may run on a
+    worker thread, at QOS_CLASS_USER_INTERACTIVE.
+
+    ConvolverProcess() does not allocate. If a worker thread falls behind, the stall is
+    counted and the caller waits for it. In real-time mode, the caller never waits: the
+    late tail block is left out of the output instead.
+*/
+typedef struct Convolver Convolver;
+
+extern Convolver *ConvolverCreate(
+    const float *impulse,
+    size_t impulseLength,
+    size_t headBlockSize,
+    size_t tailBlockSize,
+    bool useWorkerThread
+);
+
+extern void ConvolverFree(Convolver *self);
+
+// Processes in-place. Output is delayed by headBlockSize frames.
+extern void ConvolverProcess(Convolver *self, float *buffer, size_t frameCount);
+
+// Must not be called while processing. Off by default, so that priming and exports are exact.
+extern void ConvolverSetRealTime(Convolver *self, bool realTime);
+
+extern size_t ConvolverGetLatency(Convolver *self);
+extern size_t ConvolverGetStallCount(Convolver *self);
+
+#endif
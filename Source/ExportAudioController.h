@@ -9,4 +9,7 @@
 
 - (void) presentSavePanelForPreset:(Preset *)preset;
 
+// Exports each preset into a chosen folder, rendering several at once
+- (void) presentOpenPanelForPresets:(NSArray<Preset *> *)presets;
+
 @end
@@ -2,14 +2,11 @@
 // MIT License (or) 1-clause BSD License
 
 #import "ExportAudioController.h"
-#import "NoisyProgram.h"
+#import "ExportQueue.h"
 
 #import "Preset.h"
-#import "StereoField.h"
 
 @import UniformTypeIdentifiers;
-@import AVFAudio;
-@import AudioToolbox.AudioFile;
 
 @interface ExportAudioController ()
 @property (nonatomic) NSString *duration;
@@ -17,7 +14,10 @@
 @property (nonatomic) NSInteger channelCount;
 @end
 
-@implementation ExportAudioController
+
+@implementation ExportAudioController {
+    ExportQueue *_exportQueue;
+}
 
 - (NSNibName) nibName
 {
@@ -25,66 +25,49 @@
 }
 
 
-- (void) _exportAudioWithPreset:(Preset *)preset toFileURL:(NSURL *)fileURL
+- (void) _runExportQueue:(ExportQueue *)exportQueue
 {
-    NSLog(@"Export %@ %ld %ld, fileURL: %@", _duration, _sampleRate, _channelCount, fileURL);
-    
-    NSError *error = nil;
-    
-    double sampleRate = _sampleRate;
-    NSInteger framesRemaining = [_duration doubleValue] * sampleRate;
-    AVAudioFrameCount frameCapacity = (AVAudioFrameCount)(sampleRate * 10);
-    AVAudioChannelCount channelCount = (AVAudioChannelCount)_channelCount;
-
-    NSDictionary *settings = @{
-        AVAudioFileTypeKey: @(kAudioFileWAVEType),
-        AVFormatIDKey: @(kAudioFormatLinearPCM),
-        AVSampleRateKey: @(_sampleRate),
-        AVNumberOfChannelsKey: @(_channelCount),
-        AVEncoderBitDepthHintKey: @(16)
-    };
-    
-    AVAudioFile *audioFile = [[AVAudioFile alloc] initForWriting:fileURL settings:settings error:&error];
-
-    AVAudioFormat *bufferFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:_sampleRate channels:channelCount];
-    AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:bufferFormat frameCapacity:frameCapacity];
-
-    if (!error) {
-        NoisyProgram *program = NoisyProgramCreate(preset, channelCount, sampleRate, &error);
-
-        float *left  = channelCount > 0 ? [buffer floatChannelData][0] : NULL;
-        float *right = channelCount > 1 ? [buffer floatChannelData][1] : NULL;
-
-        while (!error && framesRemaining > 0) {
-            AVAudioFrameCount frameLength = (AVAudioFrameCount)MIN(framesRemaining, frameCapacity);
-            
-            NoisyProgramProcess(program, left, right, frameLength);
-            
-            float leftAutoGain, rightAutoGain;
-            NoisyProgramGetAutoGain(program, &leftAutoGain, &rightAutoGain);
-            ApplyStereoFieldVolumeAndBalance(leftAutoGain, rightAutoGain, 0.0, left, right, frameLength);
-
-            [buffer setFrameLength:frameLength];
-            [audioFile writeFromBuffer:buffer error:&error];
-            
-            framesRemaining -= frameLength;
+    _exportQueue = exportQueue;
+
+    [exportQueue setCompletionHandler:^(ExportQueue *queue) {
+        for (ExportJob *job in [queue jobs]) {
+            NSError *error = [job error];
+
+            if (error && !([[error domain] isEqualToString:NSCocoaErrorDomain] && [error code] == NSUserCancelledError)) {
+                [[NSAlert alertWithError:error] runModal];
+                break;
+            }
         }
 
-        NoisyProgramFree(program);
-    }
+        self->_exportQueue = nil;
+    }];
 
-    if (error) {
-        [[NSAlert alertWithError:error] runModal];
-    }
+    [exportQueue start];
 }
 
 
-- (void) presentSavePanelForPreset:(Preset *)preset
+- (ExportJob *) _makeJobWithPreset:(Preset *)preset fileURL:(NSURL *)fileURL
+{
+    return [[ExportJob alloc] initWithPreset: preset
+                                     fileURL: fileURL
+                                  sampleRate: _sampleRate
+                                channelCount: _channelCount
+                                    duration: [_duration doubleValue]];
+}
+
+
+- (void) _setupDefaults
 {
     [self setDuration:@"300"];
     [self setSampleRate:44100];
     [self setChannelCount:2];
-    
+}
+
+
+- (void) presentSavePanelForPreset:(Preset *)preset
+{
+    [self _setupDefaults];
+
     NSSavePanel *savePanel = [NSSavePanel savePanel];
 
     [savePanel setTitle:NSLocalizedString(@"EXPORT_AUDIO_TITLE", @"Save panel title: 'Export Audio'")];
@@ -97,11 +80,60 @@
 
     [savePanel beginWithCompletionHandler:^(NSInteger result) {
         if (result == NSModalResponseOK) {
-            [self _exportAudioWithPreset:preset toFileURL:[savePanel URL]];
+            NSLog(@"Export %@ %ld %ld, fileURL: %@", self->_duration, self->_sampleRate, self->_channelCount, [savePanel URL]);
+
+            ExportJob *job = [self _makeJobWithPreset:preset fileURL:[savePanel URL]];
+            [self _runExportQueue:[[ExportQueue alloc] initWithJobs:@[ job ]]];
+
             [savePanel setAccessoryView:nil];
         }
     }];
+}
+
+
+- (void) presentOpenPanelForPresets:(NSArray<Preset *> *)presets
+{
+    [self _setupDefaults];
 
+    NSOpenPanel *openPanel = [NSOpenPanel openPanel];
+
+    [openPanel setTitle:NSLocalizedString(@"EXPORT_ALL_AUDIO_TITLE", @"Open panel title: 'Export All Presets'")];
+    [openPanel setPrompt:NSLocalizedString(@"EXPORT_ALL_AUDIO_PROMPT", @"Open panel button: 'Export'")];
+
+    [openPanel setCanChooseFiles:NO];
+    [openPanel setCanChooseDirectories:YES];
+    [openPanel setCanCreateDirectories:YES];
+    [openPanel setAccessoryView:[self view]];
+    [openPanel setAccessoryViewDisclosed:YES];
+
+    [openPanel beginWithCompletionHandler:^(NSInteger result) {
+        if (result == NSModalResponseOK) {
+            NSURL *directoryURL = [openPanel URL];
+            NSMutableArray *jobs = [NSMutableArray array];
+            NSMutableSet *usedNames = [NSMutableSet set];
+
+            // "/" would add a path component, and ":" shows as "/" in the Finder
+            NSCharacterSet *separators = [NSCharacterSet characterSetWithCharactersInString:@"/:"];
+
+            for (Preset *preset in presets) {
+                NSString *baseName = [[[preset name] componentsSeparatedByCharactersInSet:separators] componentsJoinedByString:@"-"];
+                NSString *name = baseName;
+
+                // Presets may share a name. Volumes are usually case-insensitive.
+                for (NSInteger i = 2; [usedNames containsObject:[name lowercaseString]]; i++) {
+                    name = [NSString stringWithFormat:@"%@ %ld", baseName, (long)i];
+                }
+
+                [usedNames addObject:[name lowercaseString]];
+
+                NSURL *fileURL = [[directoryURL URLByAppendingPathComponent:name] URLByAppendingPathExtension:@"wav"];
+                [jobs addObject:[self _makeJobWithPreset:preset fileURL:fileURL]];
+            }
+
+            [self _runExportQueue:[[ExportQueue alloc] initWithJobs:jobs]];
+            [openPanel setAccessoryView:nil];
+        }
+    }];
 }
 
 @end
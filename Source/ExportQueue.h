@@ -0,0 +1,69 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+@import Foundation;
+
+@class Preset;
+
+
+/*
+    Renders presets to 16-bit WAV files on a bounded pool of worker threads.
+
+    Programs are built on the worker threads. When a job finishes, its
+    program is kept and handed to the next job with the same preset, sample
+    rate, and channel count, which skips both the build and the auto gain
+    settling period. Jobs which can reuse a program are started first.
+
+    Files of failed or cancelled jobs are removed.
+*/
+
+@interface ExportJob : NSObject
+
+- (instancetype) initWithPreset: (Preset *) preset
+                        fileURL: (NSURL *) fileURL
+                     sampleRate: (double) sampleRate
+                   channelCount: (NSInteger) channelCount
+                       duration: (NSTimeInterval) duration;
+
+@property (nonatomic, readonly) Preset *preset;
+@property (nonatomic, readonly) NSURL *fileURL;
+@property (nonatomic, readonly) double sampleRate;
+@property (nonatomic, readonly) NSInteger channelCount;
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+// Safe to read while the job is running
+@property (nonatomic, readonly) double progress;
+
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+@property (nonatomic, readonly) NSError *error;
+
+@end
+
+
+@interface ExportQueue : NSObject
+
+- (instancetype) initWithJobs:(NSArray<ExportJob *> *)jobs;
+
+@property (nonatomic, readonly) NSArray<ExportJob *> *jobs;
+
+// Defaults to the number of active processors
+@property (nonatomic) NSInteger maximumConcurrentJobCount;
+
+// Called on the main thread a few times per second while running
+@property (nonatomic, copy) void (^progressHandler)(ExportQueue *queue);
+
+// Called on the main thread once all jobs have finished or were cancelled
+@property (nonatomic, copy) void (^completionHandler)(ExportQueue *queue);
+
+- (void) start;
+- (void) cancel;
+
+@property (nonatomic, readonly, getter=isRunning) BOOL running;
+
+@property (nonatomic, readonly) double progress;           // Of all jobs, weighted by length
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+// Seconds of audio written per second of elapsed time, across all jobs
+@property (nonatomic, readonly) double throughput;
+
+@end
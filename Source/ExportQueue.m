@@ -0,0 +1,395 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#import "ExportQueue.h"
+#import "NoisyProgram.h"
+#import "WavWriter.h"
+
+#include <stdatomic.h>
+
+static const NSTimeInterval sProgressInterval = 0.25;
+
+// Upper bound on the auto gain settling period, in chunks
+static const size_t sMaxSettleChunkCount = 10;
+
+
+static NSError *sMakePOSIXError(void)
+{
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+}
+
+
+static NSError *sMakeCancelledError(void)
+{
+    return [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+}
+
+
+@interface ExportJob ()
+@property (nonatomic, getter=isFinished) BOOL finished;
+@property (nonatomic) NSError *error;
+
+- (NSString *) _programKey;
+- (uint64_t) _frameCount;
+- (uint64_t) _framesWritten;
+- (NSError *) _renderWithProgram:(NoisyProgram *)program cancelled:(_Atomic(bool) *)cancelled;
+@end
+
+
+@implementation ExportJob {
+    uint64_t _frameCount;
+    _Atomic(uint64_t) _framesWritten;
+}
+
+
+- (instancetype) initWithPreset: (Preset *) preset
+                        fileURL: (NSURL *) fileURL
+                     sampleRate: (double) sampleRate
+                   channelCount: (NSInteger) channelCount
+                       duration: (NSTimeInterval) duration
+{
+    if ((self = [super init])) {
+        _preset = preset;
+        _fileURL = fileURL;
+        _sampleRate = sampleRate;
+        _channelCount = channelCount;
+        _duration = duration;
+
+        _frameCount = (uint64_t)llround(MAX(duration, 0) * sampleRate);
+    }
+
+    return self;
+}
+
+
+#pragma mark - Private Methods
+
+// Jobs with equal keys can share a program
+- (NSString *) _programKey
+{
+    return [NSString stringWithFormat:@"%p %g %ld", _preset, _sampleRate, (long)_channelCount];
+}
+
+
+- (uint64_t) _frameCount
+{
+    return _frameCount;
+}
+
+
+- (uint64_t) _framesWritten
+{
+    return atomic_load_explicit(&_framesWritten, memory_order_relaxed);
+}
+
+
+// Called on a worker thread
+- (NSError *) _renderWithProgram:(NoisyProgram *)program cancelled:(_Atomic(bool) *)cancelled
+{
+    const char *path = [_fileURL fileSystemRepresentation];
+
+    WavWriter *writer = WavWriterCreate(path, _sampleRate, _channelCount, WavWriterFormatInt16, true);
+    if (!writer) return sMakePOSIXError();
+
+    // One second per chunk. NoisyProgramProcess() always renders both channels.
+    size_t chunkFrameCount = (size_t)_sampleRate;
+
+    float *left  = malloc(sizeof(float) * chunkFrameCount);
+    float *right = malloc(sizeof(float) * chunkFrameCount);
+
+    NSError *error = nil;
+
+    // Let auto gain settle first, so that the file starts at its final level.
+    // Reused programs have already settled.
+    size_t settleChunksRemaining = sMaxSettleChunkCount;
+
+    float leftAutoGain, rightAutoGain;
+    while (!NoisyProgramGetAutoGain(program, &leftAutoGain, &rightAutoGain) && settleChunksRemaining > 0) {
+        if (atomic_load_explicit(cancelled, memory_order_relaxed)) break;
+
+        NoisyProgramProcess(program, left, right, chunkFrameCount);
+        NoisyProgramApplyAutoGain(program, left, right, chunkFrameCount);
+
+        settleChunksRemaining--;
+    }
+
+    uint64_t framesRemaining = _frameCount;
+
+    while (!error && framesRemaining > 0) {
+        if (atomic_load_explicit(cancelled, memory_order_relaxed)) {
+            error = sMakeCancelledError();
+            break;
+        }
+
+        size_t frameCount = (size_t)MIN(framesRemaining, (uint64_t)chunkFrameCount);
+
+        NoisyProgramProcess(program, left, right, frameCount);
+        NoisyProgramApplyAutoGain(program, left, right, frameCount);
+
+        if (!WavWriterWrite(writer, left, right, frameCount)) {
+            error = sMakePOSIXError();
+        }
+
+        framesRemaining -= frameCount;
+        atomic_fetch_add_explicit(&_framesWritten, frameCount, memory_order_relaxed);
+    }
+
+    if (!WavWriterClose(writer) && !error) {
+        error = sMakePOSIXError();
+    }
+
+    free(left);
+    free(right);
+
+    if (error) unlink(path);
+
+    return error;
+}
+
+
+#pragma mark - Accessors
+
+- (double) progress
+{
+    if (_frameCount == 0) return _finished ? 1.0 : 0.0;
+    return (double)[self _framesWritten] / (double)_frameCount;
+}
+
+
+@end
+
+
+@implementation ExportQueue {
+    NSMutableArray<ExportJob *> *_pendingJobs;
+    NSInteger _activeJobCount;
+
+    // Programs of finished jobs, by -[ExportJob _programKey]
+    NSMutableDictionary<NSString *, NSMutableArray<NSValue *> *> *_idlePrograms;
+
+    NSTimer *_progressTimer;
+    _Atomic(bool) _cancelled;
+
+    NSTimeInterval _startTime;
+    NSTimeInterval _stopTime;
+}
+
+
+- (instancetype) initWithJobs:(NSArray<ExportJob *> *)jobs
+{
+    if ((self = [super init])) {
+        _jobs = [jobs copy];
+        _maximumConcurrentJobCount = [[NSProcessInfo processInfo] activeProcessorCount];
+        _idlePrograms = [NSMutableDictionary dictionary];
+    }
+
+    return self;
+}
+
+
+- (void) dealloc
+{
+    [self _freeIdlePrograms];
+}
+
+
+#pragma mark - Private Methods
+
+- (void) _freeIdlePrograms
+{
+    for (NSArray<NSValue *> *programs in [_idlePrograms allValues]) {
+        for (NSValue *value in programs) {
+            NoisyProgramFree([value pointerValue]);
+        }
+    }
+
+    [_idlePrograms removeAllObjects];
+}
+
+
+// Prefers a job which can reuse an idle program
+- (ExportJob *) _dequeueJob
+{
+    ExportJob *result = [_pendingJobs firstObject];
+
+    for (ExportJob *job in _pendingJobs) {
+        if ([_idlePrograms[[job _programKey]] count] > 0) {
+            result = job;
+            break;
+        }
+    }
+
+    [_pendingJobs removeObject:result];
+
+    return result;
+}
+
+
+- (void) _startJobs
+{
+    NSInteger maximumConcurrentJobCount = MAX(_maximumConcurrentJobCount, 1);
+
+    while (_activeJobCount < maximumConcurrentJobCount && [_pendingJobs count] > 0) {
+        ExportJob *job = [self _dequeueJob];
+        NSString *key = [job _programKey];
+
+        NSMutableArray<NSValue *> *idlePrograms = _idlePrograms[key];
+        NoisyProgram *idleProgram = NULL;
+
+        if ([idlePrograms count] > 0) {
+            idleProgram = [[idlePrograms lastObject] pointerValue];
+            [idlePrograms removeLastObject];
+        }
+
+        _activeJobCount++;
+
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            NoisyProgram *program = idleProgram;
+            NSError *error = nil;
+
+            // Build on the worker, so that the main thread never waits on a preset
+            if (!program) {
+                program = NoisyProgramCreate([job preset], [job channelCount], [job sampleRate], ^{
+                    return (BOOL)atomic_load_explicit(&self->_cancelled, memory_order_relaxed);
+                }, &error);
+            }
+
+            if (program) {
+                error = [job _renderWithProgram:program cancelled:&self->_cancelled];
+            }
+
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self _finishJob:job program:program error:error];
+            });
+        });
+    }
+
+    if (_activeJobCount == 0 && [_pendingJobs count] == 0) {
+        [self _finish];
+    }
+}
+
+
+- (void) _finishJob:(ExportJob *)job program:(NoisyProgram *)program error:(NSError *)error
+{
+    [job setError:error];
+    [job setFinished:YES];
+
+    NSString *key = [job _programKey];
+
+    // NULL if the build failed
+    if (program) {
+        if (!_idlePrograms[key]) {
+            _idlePrograms[key] = [NSMutableArray array];
+        }
+
+        [_idlePrograms[key] addObject:[NSValue valueWithPointer:program]];
+    }
+
+    _activeJobCount--;
+
+    if (atomic_load(&_cancelled)) {
+        for (ExportJob *pendingJob in _pendingJobs) {
+            [pendingJob setError:sMakeCancelledError()];
+            [pendingJob setFinished:YES];
+        }
+
+        [_pendingJobs removeAllObjects];
+    }
+
+    [self _startJobs];
+}
+
+
+- (void) _finish
+{
+    if (!_running) return;
+
+    _running = NO;
+    _stopTime = [[NSProcessInfo processInfo] systemUptime];
+
+    [_progressTimer invalidate];
+    _progressTimer = nil;
+
+    // Also records each program's settled auto gain
+    [self _freeIdlePrograms];
+
+    if (_progressHandler) _progressHandler(self);
+
+    // Break any retain cycles through the handlers
+    void (^completionHandler)(ExportQueue *) = _completionHandler;
+
+    _progressHandler = nil;
+    _completionHandler = nil;
+
+    if (completionHandler) completionHandler(self);
+}
+
+
+#pragma mark - Public Methods
+
+- (void) start
+{
+    if (_running || _pendingJobs) return;
+
+    _running = YES;
+    _startTime = [[NSProcessInfo processInfo] systemUptime];
+    _pendingJobs = [_jobs mutableCopy];
+
+    __weak id weakSelf = self;
+
+    _progressTimer = [NSTimer scheduledTimerWithTimeInterval:sProgressInterval repeats:YES block:^(NSTimer *timer) {
+        ExportQueue *strongSelf = weakSelf;
+        if (strongSelf && strongSelf->_progressHandler) strongSelf->_progressHandler(strongSelf);
+    }];
+
+    [self _startJobs];
+}
+
+
+- (void) cancel
+{
+    atomic_store(&_cancelled, true);
+}
+
+
+#pragma mark - Accessors
+
+- (double) progress
+{
+    double totalFrames = 0;
+    double framesWritten = 0;
+
+    for (ExportJob *job in _jobs) {
+        totalFrames   += [job _frameCount];
+        framesWritten += [job _framesWritten];
+    }
+
+    return totalFrames > 0 ? (framesWritten / totalFrames) : 0;
+}
+
+
+- (NSTimeInterval) elapsedTime
+{
+    if (!_startTime) return 0;
+
+    NSTimeInterval stopTime = _running ? [[NSProcessInfo processInfo] systemUptime] : _stopTime;
+    return stopTime - _startTime;
+}
+
+
+- (double) throughput
+{
+    NSTimeInterval elapsedTime = [self elapsedTime];
+    if (elapsedTime <= 0) return 0;
+
+    double audioDuration = 0;
+
+    for (ExportJob *job in _jobs) {
+        audioDuration += [job _framesWritten] / [job sampleRate];
+    }
+
+    return audioDuration / elapsedTime;
+}
+
+
+@end
@@ -0,0 +1,93 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "FFT.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+
+typedef struct FFT {
+    FFTSetup setup;
+    size_t log2Size;
+    size_t size;
+} FFT;
+
+
+/*
+    Creating an FFTSetup is expensive and the tables for a given size are immutable,
+    so setups are created once per size and kept for the lifetime of the process.
+*/
+static FFTSetup sGetCachedSetup(size_t log2Size)
+{
+    static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+    static FFTSetup sSetups[32];
+
+    if (log2Size >= 32) return NULL;
+
+    pthread_mutex_lock(&sMutex);
+
+    if (!sSetups[log2Size]) {
+        sSetups[log2Size] = vDSP_create_fftsetup(log2Size, kFFTRadix2);
+    }
+
+    FFTSetup result = sSetups[log2Size];
+
+    pthread_mutex_unlock(&sMutex);
+
+    return result;
+}
+
+
+FFT *FFTCreate(size_t log2Size)
+{
+    FFTSetup setup = sGetCachedSetup(log2Size);
+    if (!setup) return NULL;
+
+    FFT *self = calloc(1, sizeof(FFT));
+
+    self->setup    = setup;
+    self->log2Size = log2Size;
+    self->size     = (size_t)1 << log2Size;
+
+    return self;
+}
+
+
+void FFTFree(FFT *self)
+{
+    free(self);
+}
+
+
+size_t FFTGetSize(FFT *self)
+{
+    return self->size;
+}
+
+
+void FFTForward(FFT *self, const float *input, DSPSplitComplex *output)
+{
+    vDSP_ctoz((const DSPComplex *)input, 2, output, 1, self->size / 2);
+    vDSP_fft_zrip(self->setup, output, 1, self->log2Size, kFFTDirection_Forward);
+}
+
+
+void FFTInverse(FFT *self, DSPSplitComplex *input, float *output)
+{
+    vDSP_fft_zrip(self->setup, input, 1, self->log2Size, kFFTDirection_Inverse);
+    vDSP_ztoc(input, 1, (DSPComplex *)output, 2, self->size / 2);
+}
+
+
+void FFTMultiply(FFT *self, const DSPSplitComplex *a, const DSPSplitComplex *b, DSPSplitComplex *output)
+{
+    // DC and Nyquist are purely real and packed together in the first bin
+    float dc      = a->realp[0] * b->realp[0];
+    float nyquist = a->imagp[0] * b->imagp[0];
+
+    vDSP_zvmul(a, 1, b, 1, output, 1, self->size / 2, 1);
+
+    output->realp[0] = dc;
+    output->imagp[0] = nyquist;
+}
@@ -0,0 +1,32 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _FFT_H_
+#define _FFT_H_
+
+#include <sys/types.h>
+#include <Accelerate/Accelerate.h>
+
+/*
+    A real FFT of a fixed power-of-two size, wrapping vDSP_fft_zrip().
+
+    Spectra use vDSP's packed format: size / 2 complex bins, with the DC
+    term in realp[0] and the Nyquist term in imagp[0]. As with vDSP, the
+    forward transform is scaled by 2 and the inverse transform by size.
+
+    FFTSetup objects are cached per size and shared between all FFTs.
+*/
+typedef struct FFT FFT;
+
+extern FFT *FFTCreate(size_t log2Size);
+extern void FFTFree(FFT *self);
+
+extern size_t FFTGetSize(FFT *self);
+
+extern void FFTForward(FFT *self, const float *input, DSPSplitComplex *output);
+extern void FFTInverse(FFT *self, DSPSplitComplex *input, float *output);
+
+// output = a * b, handling the packed DC and Nyquist terms
+extern void FFTMultiply(FFT *self, const DSPSplitComplex *a, const DSPSplitComplex *b, DSPSplitComplex *output);
+
+#endif
@@ -0,0 +1,121 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "FloatingPoint.h"
+
+#include <fenv.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+
+#if defined(__aarch64__)
+
+// FPCR.FZ flushes both subnormal inputs and outputs.
+// FPSR.IDC is set when an input was flushed, FPSR.UFC when an output was.
+static const uint64_t sFlushToZeroMask = (1 << 24);
+static const uint64_t sDenormalFlagMask = (1 << 7) | (1 << 3);
+
+static uint64_t sGetControl(void)
+{
+    uint64_t fpcr;
+    __asm__ volatile ("mrs %0, fpcr" : "=r" (fpcr));
+    return fpcr;
+}
+
+
+static void sSetControl(uint64_t fpcr)
+{
+    __asm__ volatile ("msr fpcr, %0" : : "r" (fpcr));
+}
+
+
+static bool sTestAndClearFlags(void)
+{
+    uint64_t fpsr;
+    __asm__ volatile ("mrs %0, fpsr" : "=r" (fpsr));
+
+    if (fpsr & sDenormalFlagMask) {
+        fpsr &= ~sDenormalFlagMask;
+        __asm__ volatile ("msr fpsr, %0" : : "r" (fpsr));
+        return true;
+    }
+
+    return false;
+}
+
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+// MXCSR holds both the control bits (FTZ = bit 15, DAZ = bit 6)
+// and the sticky flags (DE = bit 1, UE = bit 4).
+static const uint64_t sFlushToZeroMask  = (1 << 15) | (1 << 6);
+static const uint64_t sDenormalFlagMask = (1 << 1)  | (1 << 4);
+
+static uint64_t sGetControl(void)
+{
+    return _mm_getcsr();
+}
+
+
+static void sSetControl(uint64_t mxcsr)
+{
+    _mm_setcsr((unsigned int)mxcsr);
+}
+
+
+static bool sTestAndClearFlags(void)
+{
+    unsigned int mxcsr = _mm_getcsr();
+
+    if (mxcsr & sDenormalFlagMask) {
+        _mm_setcsr(mxcsr & ~(unsigned int)sDenormalFlagMask);
+        return true;
+    }
+
+    return false;
+}
+
+
+#else
+
+static const uint64_t sFlushToZeroMask = 0;
+
+static uint64_t sGetControl(void)         { return 0; }
+static void sSetControl(uint64_t control) { }
+
+static bool sTestAndClearFlags(void)
+{
+    bool result = fetestexcept(FE_UNDERFLOW) != 0;
+    feclearexcept(FE_UNDERFLOW);
+    return result;
+}
+
+#endif
+
+
+void FloatingPointEnableFlushToZero(FloatingPointState *outState)
+{
+    uint64_t control = sGetControl();
+
+    outState->control = control;
+
+    if ((control & sFlushToZeroMask) != sFlushToZeroMask) {
+        sSetControl(control | sFlushToZeroMask);
+    }
+}
+
+
+void FloatingPointRestore(const FloatingPointState *state)
+{
+    if (sGetControl() != state->control) {
+        sSetControl(state->control);
+    }
+}
+
+
+bool FloatingPointTestAndClearDenormals(void)
+{
+    return sTestAndClearFlags();
+}
@@ -0,0 +1,34 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _FLOATING_POINT_H_
+#define _FLOATING_POINT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Per-thread floating-point environment helpers for render threads.
+
+    IIR tails (OnePole, DCBlock, RBJ, biquads) decay towards zero after a
+    zero node or a large negative gain. Once they reach the subnormal range,
+    every operation on them can take many times longer. Flush-to-zero (FTZ)
+    and denormals-are-zero (DAZ) avoid this by treating those values as 0.
+
+    FloatingPointTestAndClearDenormals() reports whether an operation since
+    the previous call produced or consumed a subnormal value. With FTZ/DAZ
+    enabled, this means that a value was flushed.
+*/
+
+typedef struct FloatingPointState {
+    uint64_t control;
+} FloatingPointState;
+
+// Enables FTZ/DAZ on the calling thread and saves the previous state into outState
+extern void FloatingPointEnableFlushToZero(FloatingPointState *outState);
+
+extern void FloatingPointRestore(const FloatingPointState *state);
+
+extern bool FloatingPointTestAndClearDenormals(void);
+
+#endif
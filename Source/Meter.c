@@ -0,0 +1,348 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "Meter.h"
+#include "FFT.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/param.h>
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <stdatomic.h>
+#include <dispatch/dispatch.h>
+
+
+static const size_t sLog2FFTSize    = 12;
+static const size_t sFFTSize        = 4096;
+static const size_t sHopFrameCount  = 2048;
+static const size_t sRingCapacity   = 32768; // Power of two, in frames
+
+
+typedef struct Meter {
+    double sampleRate;
+
+    float *leftRing;
+    float *rightRing;
+
+    // Only the render thread writes writeCount; only the analysis thread writes readCount
+    _Atomic(uint64_t) writeCount;
+    _Atomic(uint64_t) readCount;
+    _Atomic(uint64_t) droppedFrames;
+
+    // Analysis thread only
+    FFT *fft;
+    float *window;
+    float *history;   // The most recent sFFTSize frames of (L + R) / 2
+    float *windowed;
+    float *left;
+    float *right;
+    DSPSplitComplex spectrum;
+    float spectrumScale;
+    size_t bandStart[MeterBandCount];
+    size_t bandEnd[MeterBandCount];
+    float bandScale[MeterBandCount];
+    uint64_t framesAnalyzed;
+
+    // Odd while a slot is being written
+    MeterSnapshot snapshots[2];
+    _Atomic(uint64_t) sequences[2];
+    _Atomic(int) publishedSlot;
+
+    pthread_t thread;
+    dispatch_semaphore_t semaphore;
+    _Atomic(bool) quit;
+} Meter;
+
+
+#pragma mark - Ring
+
+static void sCopyIn(float *ring, uint64_t position, const float *source, size_t frameCount)
+{
+    size_t start = position & (sRingCapacity - 1);
+    size_t first = MIN(frameCount, sRingCapacity - start);
+
+    memcpy(ring + start, source, first * sizeof(float));
+    memcpy(ring, source + first, (frameCount - first) * sizeof(float));
+}
+
+
+static void sCopyOut(const float *ring, uint64_t position, float *destination, size_t frameCount)
+{
+    size_t start = position & (sRingCapacity - 1);
+    size_t first = MIN(frameCount, sRingCapacity - start);
+
+    memcpy(destination, ring + start, first * sizeof(float));
+    memcpy(destination + first, ring, (frameCount - first) * sizeof(float));
+}
+
+
+#pragma mark - Analysis
+
+static float sToDecibels(float power)
+{
+    return 10.0f * log10f(power);
+}
+
+
+static void sSetupBands(Meter *self)
+{
+    double binWidth = self->sampleRate / sFFTSize;
+    size_t binCount = sFFTSize / 2;
+
+    for (size_t b = 0; b < MeterBandCount; b++) {
+        double center = MeterGetBandFrequency(b);
+        double low    = center * pow(2.0, -1.0 / 6.0);
+        double high   = center * pow(2.0,  1.0 / 6.0);
+
+        size_t start = (size_t)ceil(low  / binWidth);
+        size_t end   = (size_t)ceil(high / binWidth);
+
+        start = MAX(start, 1);
+        end   = MIN(end, binCount);
+
+        self->bandScale[b] = 1.0f;
+
+        if (start >= binCount) {
+            // Above Nyquist
+            start = end = binCount;
+
+        } else if (start >= end) {
+            // Narrower than a bin: take the nearest bin's share of the band
+            start = MIN((size_t)lround(center / binWidth), binCount - 1);
+            end   = start + 1;
+
+            self->bandScale[b] = (float)((high - low) / binWidth);
+        }
+
+        self->bandStart[b] = start;
+        self->bandEnd[b]   = end;
+    }
+}
+
+
+static void sPublish(Meter *self, const MeterSnapshot *snapshot)
+{
+    int slot = 1 - atomic_load_explicit(&self->publishedSlot, memory_order_relaxed);
+    uint64_t sequence = atomic_load_explicit(&self->sequences[slot], memory_order_relaxed);
+
+    atomic_store_explicit(&self->sequences[slot], sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    self->snapshots[slot] = *snapshot;
+
+    atomic_store_explicit(&self->sequences[slot], sequence + 2, memory_order_release);
+    atomic_store_explicit(&self->publishedSlot, slot, memory_order_release);
+}
+
+
+static void sAnalyze(Meter *self, uint64_t sequence)
+{
+    MeterSnapshot snapshot = { 0 };
+
+    float *channels[2] = { self->left, self->right };
+
+    for (size_t c = 0; c < 2; c++) {
+        float peak, sumOfSquares;
+
+        vDSP_maxmgv(channels[c], 1, &peak, sHopFrameCount);
+        vDSP_svesq(channels[c], 1, &sumOfSquares, sHopFrameCount);
+
+        float peakDecibels = sToDecibels(peak * peak);
+        float rmsDecibels  = sToDecibels(sumOfSquares / sHopFrameCount);
+
+        snapshot.peak[c]        = peakDecibels;
+        snapshot.rms[c]         = rmsDecibels;
+        snapshot.crestFactor[c] = (peak > 0) ? (peakDecibels - rmsDecibels) : 0;
+    }
+
+    // Slide the history and append the mid signal
+    float *history = self->history;
+    float *newest  = history + (sFFTSize - sHopFrameCount);
+    float half = 0.5f;
+
+    memmove(history, history + sHopFrameCount, (sFFTSize - sHopFrameCount) * sizeof(float));
+    vDSP_vadd(self->left, 1, self->right, 1, newest, 1, sHopFrameCount);
+    vDSP_vsmul(newest, 1, &half, newest, 1, sHopFrameCount);
+
+    vDSP_vmul(history, 1, self->window, 1, self->windowed, 1, sFFTSize);
+    FFTForward(self->fft, self->windowed, &self->spectrum);
+
+    const float *realp = self->spectrum.realp;
+    const float *imagp = self->spectrum.imagp;
+
+    for (size_t b = 0; b < MeterBandCount; b++) {
+        float power = 0;
+
+        for (size_t i = self->bandStart[b]; i < self->bandEnd[b]; i++) {
+            power += (realp[i] * realp[i]) + (imagp[i] * imagp[i]);
+        }
+
+        bool empty = self->bandStart[b] >= self->bandEnd[b];
+        snapshot.bands[b] = empty ? -INFINITY : sToDecibels(power * self->spectrumScale * self->bandScale[b]);
+    }
+
+    self->framesAnalyzed += sHopFrameCount;
+
+    snapshot.sequence       = sequence;
+    snapshot.framesAnalyzed = self->framesAnalyzed;
+    snapshot.droppedFrames  = atomic_load_explicit(&self->droppedFrames, memory_order_relaxed);
+
+    sPublish(self, &snapshot);
+}
+
+
+static void *sAnalysisMain(void *context)
+{
+    Meter *self = context;
+    uint64_t sequence = 0;
+
+    // Wake about twice per window
+    int64_t timeout = (int64_t)((sHopFrameCount / self->sampleRate) * 0.5 * NSEC_PER_SEC);
+
+    while (!atomic_load(&self->quit)) {
+        while (!atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+            uint64_t readCount  = atomic_load_explicit(&self->readCount,  memory_order_relaxed);
+            uint64_t writeCount = atomic_load_explicit(&self->writeCount, memory_order_acquire);
+
+            if ((writeCount - readCount) < sHopFrameCount) break;
+
+            sCopyOut(self->leftRing,  readCount, self->left,  sHopFrameCount);
+            sCopyOut(self->rightRing, readCount, self->right, sHopFrameCount);
+
+            atomic_store_explicit(&self->readCount, readCount + sHopFrameCount, memory_order_release);
+
+            sAnalyze(self, ++sequence);
+        }
+
+        dispatch_semaphore_wait(self->semaphore, dispatch_time(DISPATCH_TIME_NOW, timeout));
+    }
+
+    return NULL;
+}
+
+
+#pragma mark - Public Functions
+
+Meter *MeterCreate(double sampleRate)
+{
+    if (sampleRate <= 0) return NULL;
+
+    Meter *self = calloc(1, sizeof(Meter));
+
+    self->sampleRate = sampleRate;
+
+    self->leftRing  = calloc(sRingCapacity, sizeof(float));
+    self->rightRing = calloc(sRingCapacity, sizeof(float));
+
+    self->fft      = FFTCreate(sLog2FFTSize);
+    self->window   = calloc(sFFTSize, sizeof(float));
+    self->history  = calloc(sFFTSize, sizeof(float));
+    self->windowed = calloc(sFFTSize, sizeof(float));
+    self->left     = calloc(sHopFrameCount, sizeof(float));
+    self->right    = calloc(sHopFrameCount, sizeof(float));
+
+    self->spectrum.realp = calloc(sFFTSize / 2, sizeof(float));
+    self->spectrum.imagp = calloc(sFFTSize / 2, sizeof(float));
+
+    // Periodic Hann window
+    double sumOfSquares = 0;
+
+    for (size_t i = 0; i < sFFTSize; i++) {
+        double w = 0.5 - (0.5 * cos((2.0 * M_PI * i) / sFFTSize));
+        self->window[i] = w;
+        sumOfSquares += w * w;
+    }
+
+    /*
+        By Parseval's theorem, the mean square of the windowed frame equals
+        twice the one-sided bin power divided by (N * sum(w^2)). vDSP scales
+        the forward transform by 2, which multiplies bin power by 4.
+    */
+    self->spectrumScale = 1.0 / (2.0 * sFFTSize * sumOfSquares);
+
+    sSetupBands(self);
+
+    self->semaphore = dispatch_semaphore_create(0);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_set_qos_class_np(&attr, QOS_CLASS_UTILITY, 0);
+
+    pthread_create(&self->thread, &attr, sAnalysisMain, self);
+    pthread_attr_destroy(&attr);
+
+    return self;
+}
+
+
+void MeterFree(Meter *self)
+{
+    if (!self) return;
+
+    atomic_store(&self->quit, true);
+    dispatch_semaphore_signal(self->semaphore);
+    pthread_join(self->thread, NULL);
+
+    dispatch_release(self->semaphore);
+
+    FFTFree(self->fft);
+
+    free(self->leftRing);
+    free(self->rightRing);
+    free(self->window);
+    free(self->history);
+    free(self->windowed);
+    free(self->left);
+    free(self->right);
+    free(self->spectrum.realp);
+    free(self->spectrum.imagp);
+
+    free(self);
+}
+
+
+double MeterGetBandFrequency(size_t index)
+{
+    // Base-two 1/3-octave centers, with band 17 at 1 kHz
+    return 1000.0 * pow(2.0, ((double)index - 17.0) / 3.0);
+}
+
+
+void MeterWrite(Meter *self, const float *left, const float *right, size_t frameCount)
+{
+    uint64_t writeCount = atomic_load_explicit(&self->writeCount, memory_order_relaxed);
+    uint64_t readCount  = atomic_load_explicit(&self->readCount,  memory_order_acquire);
+
+    if ((sRingCapacity - (size_t)(writeCount - readCount)) < frameCount) {
+        atomic_fetch_add_explicit(&self->droppedFrames, frameCount, memory_order_relaxed);
+        return;
+    }
+
+    sCopyIn(self->leftRing,  writeCount, left,  frameCount);
+    sCopyIn(self->rightRing, writeCount, right, frameCount);
+
+    atomic_store_explicit(&self->writeCount, writeCount + frameCount, memory_order_release);
+}
+
+
+bool MeterGetSnapshot(Meter *self, MeterSnapshot *outSnapshot)
+{
+    // The analysis thread alternates slots, so a retry is rare
+    for (size_t attempt = 0; attempt < 16; attempt++) {
+        int slot = atomic_load_explicit(&self->publishedSlot, memory_order_acquire);
+        uint64_t before = atomic_load_explicit(&self->sequences[slot], memory_order_acquire);
+
+        if (before & 1) continue;
+
+        memcpy(outSnapshot, &self->snapshots[slot], sizeof(MeterSnapshot));
+        atomic_thread_fence(memory_order_acquire);
+
+        uint64_t after = atomic_load_explicit(&self->sequences[slot], memory_order_relaxed);
+
+        if (before == after) return before > 0;
+    }
+
+    return false;
+}
@@ -0,0 +1,60 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _METER_H_
+#define _METER_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Level and spectrum metering for a stereo stream.
+
+    MeterWrite() is called from the render thread and only copies into a
+    lock-free single-producer, single-consumer ring. If the ring is full,
+    the frames are dropped and counted.
+
+    A low-priority analysis thread drains the ring in windows of 2048 frames.
+    For each window it measures peak, RMS, and crest factor per channel, then
+    takes a 4096-point FFT (Hann window, 50% overlap) of (L + R) / 2 and sums
+    it into 1/3-octave bands from 20 Hz to 20 kHz.
+
+    Results are published into two snapshot slots, each guarded by a
+    sequence count, so MeterGetSnapshot() can be called from any thread
+    without locking.
+*/
+
+enum { MeterBandCount = 31 };
+
+typedef struct MeterSnapshot {
+    uint64_t sequence;       // Increases with each published snapshot
+    uint64_t framesAnalyzed;
+    uint64_t droppedFrames;
+
+    // In dBFS (-INFINITY for silence). RMS is not sine-referenced,
+    // so a full-scale sine reads -3 dB.
+    float peak[2];
+    float rms[2];
+    float crestFactor[2];    // peak - rms, in dB
+
+    // Band power of (L + R) / 2 in dBFS, calibrated so that the bands sum to the
+    // mean square of the signal. -INFINITY for bands above the Nyquist frequency.
+    float bands[MeterBandCount];
+} MeterSnapshot;
+
+typedef struct Meter Meter;
+
+extern Meter *MeterCreate(double sampleRate);
+extern void MeterFree(Meter *self);
+
+// Center frequency of a 1/3-octave band, in Hz
+extern double MeterGetBandFrequency(size_t index);
+
+// Render thread. Does not allocate or lock.
+extern void MeterWrite(Meter *self, const float *left, const float *right, size_t frameCount);
+
+// Any thread. Returns false if no snapshot has been published yet.
+extern bool MeterGetSnapshot(Meter *self, MeterSnapshot *outSnapshot);
+
+#endif
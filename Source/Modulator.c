@@ -0,0 +1,103 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "Modulator.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+
+typedef struct Modulator {
+    ModulatorShape shape;
+    double rate;
+    double phase;
+
+    // ModulatorShapeRandom
+    uint64_t random;
+    double walk;
+    double stepSize;
+    double smoothed;
+    double smoothing;
+} Modulator;
+
+
+#pragma mark - Private Functions
+
+// splitmix64
+static uint64_t sGetNextRandom(Modulator *self)
+{
+    uint64_t z = (self->random += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+
+static double sStepRandom(Modulator *self)
+{
+    // Uniform from -1 to 1
+    double r = ((sGetNextRandom(self) >> 11) * 0x1.0p-52) - 1.0;
+
+    double walk = self->walk + (r * self->stepSize);
+
+    if (walk >  1.0) walk =  2.0 - walk;
+    if (walk < -1.0) walk = -2.0 - walk;
+
+    self->walk = walk;
+    self->smoothed += (walk - self->smoothed) * self->smoothing;
+
+    return self->smoothed;
+}
+
+
+#pragma mark - Public Functions
+
+Modulator *ModulatorCreate(ModulatorShape shape, double rate, double phase, uint64_t randomSeed)
+{
+    Modulator *self = calloc(1, sizeof(Modulator));
+
+    self->shape = shape;
+    self->rate  = fmax(rate, 0);
+    self->phase = phase - floor(phase);
+
+    self->random = randomSeed;
+
+    // A uniform step has a variance of stepSize² / 3, so that after 1 / rate
+    // steps, the walk has moved by about one (half its range).
+    self->stepSize = fmin(sqrt(3.0 * self->rate), 1.0);
+
+    // Cutoff of about twice the rate, which hides the individual steps
+    self->smoothing = 1.0 - exp(-2.0 * M_PI * fmin(2.0 * self->rate, 0.5));
+
+    return self;
+}
+
+
+void ModulatorFree(Modulator *self)
+{
+    free(self);
+}
+
+
+double ModulatorStep(Modulator *self)
+{
+    if (self->shape == ModulatorShapeRandom) {
+        return sStepRandom(self);
+    }
+
+    double phase = self->phase + self->rate;
+    phase -= floor(phase);
+    self->phase = phase;
+
+    if (self->shape == ModulatorShapeTriangle) {
+        // Zero and rising at phase 0, like sine
+        double shifted = phase + 0.75;
+        shifted -= floor(shifted);
+
+        return (4.0 * fabs(shifted - 0.5)) - 1.0;
+    }
+
+    return sin(2.0 * M_PI * phase);
+}
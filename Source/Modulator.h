@@ -0,0 +1,35 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _MODULATOR_H_
+#define _MODULATOR_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+    A control-rate signal from -1 to 1, advanced one step at a time.
+
+    ModulatorShapeSine and ModulatorShapeTriangle are LFOs which start at
+    phase (0 to 1, where 0 is zero and rising). ModulatorShapeRandom is a
+    random walk, reflected at -1 and 1, and smoothed by a one-pole lowpass.
+    It wanders across its range about rate times per step and ignores phase.
+
+    rate is normalized (cycles per step). ModulatorStep() does not allocate.
+*/
+
+typedef enum ModulatorShape {
+    ModulatorShapeSine,
+    ModulatorShapeTriangle,
+    ModulatorShapeRandom
+} ModulatorShape;
+
+typedef struct Modulator Modulator;
+
+extern Modulator *ModulatorCreate(ModulatorShape shape, double rate, double phase, uint64_t randomSeed);
+extern void ModulatorFree(Modulator *self);
+
+// Advances one step and returns the new value
+extern double ModulatorStep(Modulator *self);
+
+#endif
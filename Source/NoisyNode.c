@@ -2,22 +2,46 @@
 // MIT License (or) 1-clause BSD License
 
 #include "NoisyNode.h"
+#include "BiquadCascade.h"
+#include "BiquadCoefficients.h"
+#include "FFT.h"
+#include "Convolver.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <Accelerate/Accelerate.h>
+#include <simd/simd.h>
+
+
+typedef enum NoisyNodeKind {
+    NoisyBiquadsNodeKind,
+    NoisyConvolveNodeKind,
+    NoisyDCBlockNodeKind,
+    NoisyDecorrelateNodeKind,
+    NoisyGainNodeKind,
+    NoisyGeneratorNodeKind,
+    NoisyNodeListKind,
+    NoisyOnePoleNodeKind,
+    NoisyPinkingNodeKind,
+    NoisySpectralNodeKind,
+    NoisySplitNodeKind,
+    NoisyZeroNodeKind
+} NoisyNodeKind;
 
 
 typedef struct NoisyNodeVTable {
     void (*process)(void *self, float *buffer, size_t frameCount);
     void (*free)(void *self);
+    NoisyNodeKind kind;
 } NoisyNodeVTable;
 
 
 #define AllocSelf( __NODE__ ) \
     __NODE__ *self = calloc(1, sizeof( __NODE__ )); \
     self->vtable.process = (void *) __NODE__ ## Process; \
-    self->vtable.free    = (void *) __NODE__ ## Free;
+    self->vtable.free    = (void *) __NODE__ ## Free; \
+    self->vtable.kind    = __NODE__ ## Kind;
 
 
 static void sProcess(NoisyNodeRef self, float *buffer, size_t frameCount)
@@ -26,6 +50,12 @@ static void sProcess(NoisyNodeRef self, float *buffer, size_t frameCount)
 }
 
 
+static NoisyNodeKind sGetKind(NoisyNodeRef self)
+{
+    return ((NoisyNodeVTable *)self)->kind;
+}
+
+
 void NoisyNodeFree(NoisyNodeRef self)
 {
     if (self) {
@@ -34,47 +64,464 @@ void NoisyNodeFree(NoisyNodeRef self)
 }
 
 
+
+#pragma mark - Block Filter
+
+/*
+    Runs the recurrence
+    y[n] = b0 x[n] + b1 x[n-1] + ... + bN x[n-N] - a1 y[n-1] - ... - aN y[n-N]
+    (N <= 3) eight samples at a time.
+
+    A block of outputs is a linear function of its eight inputs and of the
+    2N state values (x[-1]...x[-N], y[-1]...y[-N]). The columns of that
+    function are found once by running the recurrence on unit impulses.
+    Each block is then 8 + 2N vector multiply-adds, and only the state
+    terms are loop-carried.
+
+    For N > 1, the state columns are large and nearly cancel, so the state
+    terms are accumulated in double precision. First-order state columns are
+    powers of the pole and are accurate in float.
+*/
+
+typedef struct NoisyBlockFilter {
+    size_t order;
+    float b[4];
+    float a[4];
+    float inputColumns[8][8];
+    double stateColumns[6][8];
+    float firstOrderStateColumns[2][8];
+} NoisyBlockFilter;
+
+
+static void sBlockFilterRun(
+    const double *b, const double *a, size_t order,
+    const double *input, const double *xState, const double *yState,
+    double *output
+) {
+    double x[4] = { 0, xState[0], xState[1], xState[2] };
+    double y[4] = { 0, yState[0], yState[1], yState[2] };
+
+    for (size_t i = 0; i < 8; i++) {
+        x[0] = input[i];
+        y[0] = b[0] * x[0];
+
+        for (size_t k = 1; k <= order; k++) {
+            y[0] += (b[k] * x[k]) - (a[k] * y[k]);
+        }
+
+        output[i] = y[0];
+
+        for (size_t k = 3; k > 0; k--) {
+            x[k] = x[k - 1];
+            y[k] = y[k - 1];
+        }
+    }
+}
+
+
+static void sBlockFilterInit(NoisyBlockFilter *self, const double *b, const double *a, size_t order)
+{
+    double zero[8] = { 0 };
+    double unit[8];
+    double output[8];
+
+    self->order = order;
+
+    for (size_t k = 0; k <= order; k++) {
+        self->b[k] = b[k];
+        self->a[k] = a[k];
+    }
+
+    for (size_t j = 0; j < 8; j++) {
+        memset(unit, 0, sizeof(unit));
+        unit[j] = 1;
+
+        sBlockFilterRun(b, a, order, unit, zero, zero, output);
+        for (size_t i = 0; i < 8; i++) self->inputColumns[j][i] = output[i];
+    }
+
+    for (size_t k = 0; k < order; k++) {
+        memset(unit, 0, sizeof(unit));
+        unit[k] = 1;
+
+        sBlockFilterRun(b, a, order, zero, unit, zero, output);
+        for (size_t i = 0; i < 8; i++) self->stateColumns[k][i] = output[i];
+
+        sBlockFilterRun(b, a, order, zero, zero, unit, output);
+        for (size_t i = 0; i < 8; i++) self->stateColumns[order + k][i] = output[i];
+    }
+
+    if (order == 1) {
+        for (size_t i = 0; i < 8; i++) {
+            self->firstOrderStateColumns[0][i] = self->stateColumns[0][i];
+            self->firstOrderStateColumns[1][i] = self->stateColumns[1][i];
+        }
+    }
+}
+
+
+// xState and yState hold x[n-1]...x[n-order] and y[n-1]...y[n-order]
+static void sBlockFilterProcess(const NoisyBlockFilter *self, float *buffer, size_t frameCount, float *xState, float *yState)
+{
+    size_t order = self->order;
+    size_t i = 0;
+
+    for ( ; (i + 8) <= frameCount; i += 8) {
+        simd_float8 input, output = { 0 }, column;
+        memcpy(&input, buffer + i, sizeof(input));
+
+        if (order == 1) {
+            memcpy(&column, self->firstOrderStateColumns[0], sizeof(column));
+            output += column * xState[0];
+
+            memcpy(&column, self->firstOrderStateColumns[1], sizeof(column));
+            output += column * yState[0];
+
+        } else {
+            simd_double8 stateOutput = { 0 }, stateColumn;
+
+            for (size_t k = 0; k < order; k++) {
+                memcpy(&stateColumn, self->stateColumns[k], sizeof(stateColumn));
+                stateOutput += stateColumn * (double)xState[k];
+
+                memcpy(&stateColumn, self->stateColumns[order + k], sizeof(stateColumn));
+                stateOutput += stateColumn * (double)yState[k];
+            }
+
+            output = __builtin_convertvector(stateOutput, simd_float8);
+        }
+
+        for (size_t j = 0; j < 8; j++) {
+            memcpy(&column, self->inputColumns[j], sizeof(column));
+            output += column * input[j];
+        }
+
+        memcpy(buffer + i, &output, sizeof(output));
+
+        for (size_t k = 0; k < order; k++) {
+            xState[k] = input[7 - k];
+            yState[k] = output[7 - k];
+        }
+    }
+
+    // Remaining frames use the recurrence directly
+    for ( ; i < frameCount; i++) {
+        float x0 = buffer[i];
+        float y0 = self->b[0] * x0;
+
+        for (size_t k = 0; k < order; k++) {
+            y0 += (self->b[k + 1] * xState[k]) - (self->a[k + 1] * yState[k]);
+        }
+
+        for (size_t k = order - 1; k > 0; k--) {
+            xState[k] = xState[k - 1];
+            yState[k] = yState[k - 1];
+        }
+
+        xState[0] = x0;
+        yState[0] = y0;
+
+        buffer[i] = y0;
+    }
+}
+
+
+#pragma mark - Modulation
+
+typedef struct NoisyModulationTarget {
+    Modulator *modulator;
+    NoisyModulationParameter parameter;
+    size_t section;
+    double depth;
+    double value; // Of the current control block, scaled by depth
+} NoisyModulationTarget;
+
+
+typedef struct NoisyModulation {
+    NoisyModulationTarget *targets; // Sorted by section
+    size_t count;
+    size_t framesRemaining;         // In the current control block
+} NoisyModulation;
+
+
+static void sModulationAppend(
+    NoisyModulation *self,
+    Modulator *modulator,
+    NoisyModulationParameter parameter,
+    size_t section,
+    double depth
+) {
+    self->targets = realloc(self->targets, (self->count + 1) * sizeof(NoisyModulationTarget));
+
+    size_t index = self->count;
+    while (index > 0 && self->targets[index - 1].section > section) {
+        self->targets[index] = self->targets[index - 1];
+        index--;
+    }
+
+    self->targets[index] = (NoisyModulationTarget){ modulator, parameter, section, depth, 0 };
+    self->count++;
+}
+
+
+static void sModulationFree(NoisyModulation *self)
+{
+    for (size_t i = 0; i < self->count; i++) {
+        ModulatorFree(self->targets[i].modulator);
+    }
+
+    free(self->targets);
+}
+
+
+static void sModulationStep(NoisyModulation *self)
+{
+    for (size_t i = 0; i < self->count; i++) {
+        NoisyModulationTarget *target = &self->targets[i];
+        target->value = ModulatorStep(target->modulator) * target->depth;
+    }
+
+    self->framesRemaining = NoisyModulationBlockFrameCount;
+}
+
+
+static double sModulationGetOffset(const NoisyModulation *self, NoisyModulationParameter parameter)
+{
+    double offset = 0;
+
+    for (size_t i = 0; i < self->count; i++) {
+        if (self->targets[i].parameter == parameter) {
+            offset += self->targets[i].value;
+        }
+    }
+
+    return offset;
+}
+
+
+// Keeps a modulated normalized frequency below Nyquist and above DC
+static double sClampFrequency(double frequency)
+{
+    return fmin(fmax(frequency, 1e-5), 0.49);
+}
+
+
+// Keeps a modulated gain, in dB, where coefficients and scalars stay finite
+static double sClampGain(double gain)
+{
+    return fmin(fmax(gain, -120.0), 120.0);
+}
+
+
 #pragma mark - Biquads
 
 typedef struct NoisyBiquadsNode {
     NoisyNodeVTable vtable;
+
+    // Exactly one of these is set, see NoisyBiquadsNodeCascadeMinimumSectionCount
     vDSP_biquad_Setup setup;
     float *delay;
+    BiquadCascade *cascade;
+
+    double *coefficients;
+    size_t sectionCount;
+
+    // Set by NoisyBiquadsNodeCreateWithDesigns(), for modulation
+    double *designs;
+    double *targetCoefficients;
+    NoisyModulation modulation;
 } NoisyBiquadsNode;
 
 
 NoisyBiquadsNode *NoisyBiquadsNodeCreate(const double *coefficients, size_t sectionCount)
 {
     AllocSelf(NoisyBiquadsNode);
-  
-    // Per vDSP_biquad() documentation:
-    // "The length of the array should be (2 * M) + 2, where M is the number of sections."
-    size_t delayCount = (2 * sectionCount) + 2;
-    
-    self->setup = sectionCount > 0 ? vDSP_biquad_CreateSetup(coefficients, sectionCount) : NULL;
-    self->delay = calloc(delayCount, sizeof(float));
+
+    if (sectionCount >= NoisyBiquadsNodeCascadeMinimumSectionCount) {
+        self->cascade = BiquadCascadeCreate(coefficients, sectionCount, 1);
+
+    } else if (sectionCount > 0) {
+        // Per vDSP_biquad() documentation:
+        // "The length of the array should be (2 * M) + 2, where M is the number of sections."
+        self->setup = vDSP_biquad_CreateSetup(coefficients, sectionCount);
+        self->delay = calloc((2 * sectionCount) + 2, sizeof(float));
+    }
+
+    // Keep a copy of the coefficients for NoisyBatchListCreate()
+    self->sectionCount = sectionCount;
+    self->coefficients = sectionCount > 0 ? malloc(5 * sectionCount * sizeof(double)) : NULL;
+    if (sectionCount > 0) memcpy(self->coefficients, coefficients, 5 * sectionCount * sizeof(double));
     
     return self;
 }
 
 
+NoisyBiquadsNode *NoisyBiquadsNodeCreateWithDesigns(const double *designs, size_t sectionCount)
+{
+    double *coefficients = calloc(5 * sectionCount, sizeof(double));
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        const double *d = &designs[4 * i];
+        BiquadGetCoefficients((BiquadType)d[0], d[1], d[2], d[3], &coefficients[5 * i]);
+    }
+
+    NoisyBiquadsNode *self = NoisyBiquadsNodeCreate(coefficients, sectionCount);
+
+    free(coefficients);
+
+    if (sectionCount > 0) {
+        self->designs = malloc(4 * sectionCount * sizeof(double));
+        memcpy(self->designs, designs, 4 * sectionCount * sizeof(double));
+
+        self->targetCoefficients = malloc(5 * sectionCount * sizeof(double));
+    }
+
+    return self;
+}
+
+
 void NoisyBiquadsNodeFree(NoisyBiquadsNode *self)
 {
     if (self->setup) {
         vDSP_biquad_DestroySetup(self->setup);
     }
-    
+
     free(self->delay);
+    BiquadCascadeFree(self->cascade);
+    free(self->coefficients);
+    free(self->designs);
+    free(self->targetCoefficients);
+    sModulationFree(&self->modulation);
     
     free(self);
 }
 
 
+// Modulation ramps coefficients, which vDSP_biquad() cannot do. Called before processing starts.
+static void sBiquadsNodeUseCascade(NoisyBiquadsNode *self)
+{
+    if (self->cascade) return;
+
+    vDSP_biquad_DestroySetup(self->setup);
+    free(self->delay);
+
+    self->setup = NULL;
+    self->delay = NULL;
+
+    self->cascade = BiquadCascadeCreate(self->coefficients, self->sectionCount, 1);
+}
+
+
+// Recomputes the coefficients of modulated sections and ramps to them over the next block
+static void sBiquadsNodeUpdate(NoisyBiquadsNode *self)
+{
+    NoisyModulation *modulation = &self->modulation;
+
+    sModulationStep(modulation);
+
+    memcpy(self->targetCoefficients, self->coefficients, 5 * self->sectionCount * sizeof(double));
+
+    for (size_t i = 0; i < modulation->count; ) {
+        size_t section = modulation->targets[i].section;
+        double offsets[3] = { 0 };
+
+        for ( ; i < modulation->count && modulation->targets[i].section == section; i++) {
+            offsets[modulation->targets[i].parameter] += modulation->targets[i].value;
+        }
+
+        const double *d = &self->designs[4 * section];
+
+        double frequency = sClampFrequency(d[1] * exp2(offsets[NoisyModulationParameterFrequency]));
+        double Q         = fmax(d[2] * exp2(offsets[NoisyModulationParameterQ]), 0.01);
+        double gain      = sClampGain(d[3] + offsets[NoisyModulationParameterGain]);
+
+        BiquadGetCoefficients((BiquadType)d[0], frequency, Q, gain, &self->targetCoefficients[5 * section]);
+    }
+
+    BiquadCascadeSetCoefficients(self->cascade, self->targetCoefficients, NoisyModulationBlockFrameCount);
+}
+
+
 void NoisyBiquadsNodeProcess(NoisyBiquadsNode *self, float *buffer, size_t frameCount)
 {
     if (self->setup) {
         vDSP_biquad(self->setup, self->delay, buffer, 1, buffer, 1, frameCount);
+        return;
+    }
+
+    if (!self->cascade) return;
+
+    NoisyModulation *modulation = &self->modulation;
+
+    if (!modulation->count) {
+        BiquadCascadeProcess(self->cascade, buffer, NULL, frameCount);
+        return;
+    }
+
+    while (frameCount > 0) {
+        if (!modulation->framesRemaining) sBiquadsNodeUpdate(self);
+
+        size_t framesToProcess = MIN(frameCount, modulation->framesRemaining);
+
+        BiquadCascadeProcess(self->cascade, buffer, NULL, framesToProcess);
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+        modulation->framesRemaining -= framesToProcess;
+    }
+}
+
+
+#pragma mark - Convolve
+
+typedef struct NoisyConvolveNode {
+    NoisyNodeVTable vtable;
+    Convolver *convolver;
+} NoisyConvolveNode;
+
+
+NoisyConvolveNode *NoisyConvolveNodeCreate(
+    const float *impulse,
+    size_t impulseLength,
+    size_t headBlockSize,
+    size_t tailBlockSize,
+    bool useWorkerThread
+) {
+    AllocSelf(NoisyConvolveNode);
+
+    self->convolver = ConvolverCreate(impulse, impulseLength, headBlockSize, tailBlockSize, useWorkerThread);
+
+    if (!self->convolver) {
+        free(self);
+        return NULL;
     }
+
+    return self;
+}
+
+
+void NoisyConvolveNodeFree(NoisyConvolveNode *self)
+{
+    ConvolverFree(self->convolver);
+    free(self);
+}
+
+
+void NoisyConvolveNodeProcess(NoisyConvolveNode *self, float *buffer, size_t frameCount)
+{
+    ConvolverProcess(self->convolver, buffer, frameCount);
+}
+
+
+size_t NoisyConvolveNodeGetLatency(NoisyConvolveNode *self)
+{
+    return ConvolverGetLatency(self->convolver);
+}
+
+
+void NoisyConvolveNodeSetRealTime(NoisyConvolveNode *self, bool realTime)
+{
+    ConvolverSetRealTime(self->convolver, realTime);
 }
 
 
@@ -82,6 +529,7 @@ void NoisyBiquadsNodeProcess(NoisyBiquadsNode *self, float *buffer, size_t frame
 
 typedef struct NoisyDCBlockNode {
     NoisyNodeVTable vtable;
+    NoisyBlockFilter filter;
     float x1, y1;
 } NoisyDCBlockNode;
 
@@ -89,6 +537,10 @@ typedef struct NoisyDCBlockNode {
 NoisyDCBlockNode *NoisyDCBlockNodeCreate(void)
 {
     AllocSelf(NoisyDCBlockNode);
+
+    // y[n] = x[n] - x[n - 1] + 0.9997 * y[n - 1]
+    sBlockFilterInit(&self->filter, (double[]){ 1, -1 }, (double[]){ 1, -0.9997 }, 1);
+
     return self;
 }
 
@@ -101,17 +553,115 @@ void NoisyDCBlockNodeFree(NoisyDCBlockNode *self)
 
 void NoisyDCBlockNodeProcess(NoisyDCBlockNode *self, float *buffer, size_t frameCount)
 {
-    float x1 = self->x1;
-    float y1 = self->y1;
+    sBlockFilterProcess(&self->filter, buffer, frameCount, &self->x1, &self->y1);
+}
 
-    for (size_t i = 0; i < frameCount; i++) {
-        float x0 = buffer[i];
-		y1 = buffer[i] = x0 - x1 + 0.9997 * y1;
-		x1 = x0;
-	}
- 
-    self->x1 = x1;
-    self->y1 = y1;
+
+#pragma mark - Decorrelate
+
+static const size_t sDecorrelateMaxFrames = 512;
+
+/*
+    A sparse FIR filter whose taps are a short burst of velvet noise.
+    Each tap is +1 or -1, so the filter is a sum of delayed copies of the
+    input. The result is scaled once to preserve the input power.
+*/
+typedef struct NoisyDecorrelateNode {
+    NoisyNodeVTable vtable;
+
+    size_t *positiveTaps;
+    size_t positiveCount;
+    size_t *negativeTaps;
+    size_t negativeCount;
+
+    size_t historyLength;
+    float *history;
+    float *output;
+    float scalar;
+} NoisyDecorrelateNode;
+
+
+static void sSeedRandom(uint64_t *s, uint64_t seed);
+static uint64_t sGetNextRandom(uint64_t *s);
+
+
+NoisyDecorrelateNode *NoisyDecorrelateNodeCreate(size_t length, double density, uint64_t randomSeed)
+{
+    AllocSelf(NoisyDecorrelateNode);
+
+    size_t period    = (density > 0) ? MAX(1, (size_t)round(1.0 / density)) : 1;
+    size_t cellCount = MAX(1, length / period);
+
+    self->positiveTaps = calloc(cellCount, sizeof(size_t));
+    self->negativeTaps = calloc(cellCount, sizeof(size_t));
+
+    uint64_t randomState[4];
+    sSeedRandom(randomState, randomSeed);
+
+    size_t maxTap = 0;
+
+    for (size_t i = 0; i < cellCount; i++) {
+        uint64_t result = sGetNextRandom(randomState);
+        size_t tap = (i * period) + (size_t)(((result >> 32) * period) >> 32);
+
+        if (result & 1) {
+            self->positiveTaps[self->positiveCount++] = tap;
+        } else {
+            self->negativeTaps[self->negativeCount++] = tap;
+        }
+
+        maxTap = MAX(maxTap, tap);
+    }
+
+    self->historyLength = maxTap;
+    self->history = calloc(maxTap + sDecorrelateMaxFrames, sizeof(float));
+    self->output  = calloc(sDecorrelateMaxFrames, sizeof(float));
+    self->scalar  = 1.0 / sqrt(cellCount);
+
+    return self;
+}
+
+
+void NoisyDecorrelateNodeFree(NoisyDecorrelateNode *self)
+{
+    free(self->positiveTaps);
+    free(self->negativeTaps);
+    free(self->history);
+    free(self->output);
+    free(self);
+}
+
+
+void NoisyDecorrelateNodeProcess(NoisyDecorrelateNode *self, float *buffer, size_t frameCount)
+{
+    size_t historyLength = self->historyLength;
+    float *history = self->history;
+    float *output  = self->output;
+
+    while (frameCount > 0) {
+        size_t framesToProcess = MIN(frameCount, sDecorrelateMaxFrames);
+
+        // history[historyLength + i] is the current input sample, history[historyLength + i - tap] is delayed by tap
+        memcpy(history + historyLength, buffer, framesToProcess * sizeof(float));
+        vDSP_vclr(output, 1, framesToProcess);
+
+        for (size_t t = 0; t < self->positiveCount; t++) {
+            float *delayed = history + historyLength - self->positiveTaps[t];
+            vDSP_vadd(output, 1, delayed, 1, output, 1, framesToProcess);
+        }
+
+        for (size_t t = 0; t < self->negativeCount; t++) {
+            float *delayed = history + historyLength - self->negativeTaps[t];
+            vDSP_vsub(delayed, 1, output, 1, output, 1, framesToProcess);
+        }
+
+        vDSP_vsmul(output, 1, &self->scalar, buffer, 1, framesToProcess);
+
+        memmove(history, history + framesToProcess, historyLength * sizeof(float));
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+    }
 }
 
 
@@ -120,6 +670,12 @@ void NoisyDCBlockNodeProcess(NoisyDCBlockNode *self, float *buffer, size_t frame
 typedef struct NoisyGainNode {
     NoisyNodeVTable vtable;
     float scalar;
+
+    // While modulated, the scalar moves by step each frame
+    double gain;
+    float current;
+    float step;
+    NoisyModulation modulation;
 } NoisyGainNode;
 
 
@@ -129,19 +685,48 @@ extern NoisyGainNode *NoisyGainNodeCreate(double gain)
     
     self->scalar = pow(10.0, gain / 20.0);
 
+    self->gain = gain;
+    self->current = self->scalar;
+
     return self;
 }
 
 
 void NoisyGainNodeFree(NoisyGainNode *self)
 {
+    sModulationFree(&self->modulation);
     free(self);
 }
 
 
 void NoisyGainNodeProcess(NoisyGainNode *self, float *buffer, size_t frameCount)
 {
-    vDSP_vsmul(buffer, 1, &self->scalar, buffer, 1, frameCount);
+    NoisyModulation *modulation = &self->modulation;
+
+    if (!modulation->count) {
+        vDSP_vsmul(buffer, 1, &self->scalar, buffer, 1, frameCount);
+        return;
+    }
+
+    while (frameCount > 0) {
+        if (!modulation->framesRemaining) {
+            sModulationStep(modulation);
+
+            double gain = sClampGain(self->gain + sModulationGetOffset(modulation, NoisyModulationParameterGain));
+            float target = pow(10.0, gain / 20.0);
+
+            self->step = (target - self->current) / NoisyModulationBlockFrameCount;
+        }
+
+        size_t framesToProcess = MIN(frameCount, modulation->framesRemaining);
+
+        // Advances current by step per frame
+        vDSP_vrampmul(buffer, 1, &self->current, &self->step, buffer, 1, framesToProcess);
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+        modulation->framesRemaining -= framesToProcess;
+    }
 }
 
 
@@ -152,6 +737,12 @@ typedef struct NoisyGeneratorNode {
     NoisyGeneratorType type;
     uint64_t s[4];
     float z;
+
+    // Velvet
+    size_t velvetPeriod;
+    size_t velvetPosition;
+    size_t velvetPulse;
+    float velvetSign;
 } NoisyGeneratorNode;
 
 
@@ -160,7 +751,7 @@ typedef struct NoisyGeneratorNode {
     by the xoshiro256** authors to seed the initial state.
     See https://prng.di.unimi.it
 */
-void sGeneratorSeedRandom(NoisyGeneratorNode *self, uint64_t seed)
+static void sSeedRandom(uint64_t *s, uint64_t seed)
 {
     uint64_t x = seed;
 
@@ -169,7 +760,7 @@ void sGeneratorSeedRandom(NoisyGeneratorNode *self, uint64_t seed)
         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
         z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
 
-        self->s[i] =  z ^ (z >> 31);
+        s[i] =  z ^ (z >> 31);
     }
 }
 
@@ -178,10 +769,8 @@ void sGeneratorSeedRandom(NoisyGeneratorNode *self, uint64_t seed)
     This implements the xoshiro256** algorithm to generate a 64-bit unsigned integer.
     See https://prng.di.unimi.it for more information about xoshiro256**
 */
-static uint64_t sGeneratorGetNextRandom(NoisyGeneratorNode *self)
+static uint64_t sGetNextRandom(uint64_t *s)
 {
-    uint64_t *s = self->s;
-    
     const uint64_t s1_5 = s[1] * 5;
     const uint64_t result = ((s1_5 << 7) | (s1_5 >> (64 - 7))) * 9;
     const uint64_t t = s[1] << 17;
@@ -206,7 +795,7 @@ static void sGeneratorFillUniformRandom(NoisyGeneratorNode *self, float *buffer,
     size_t maskedFrameCount = frameCount & ~3;
 
     for (i = 0; i < maskedFrameCount; i += 4) {
-        uint64_t result = sGeneratorGetNextRandom(self);
+        uint64_t result = sGetNextRandom(self->s);
 
         buffer[i + 0] = (uint16_t)((result & 0xFFFF000000000000) >> 48);
         buffer[i + 1] = (uint16_t)((result & 0x0000FFFF00000000) >> 32);
@@ -215,7 +804,7 @@ static void sGeneratorFillUniformRandom(NoisyGeneratorNode *self, float *buffer,
     }
     
     if (i < frameCount) {
-        uint64_t result = sGeneratorGetNextRandom(self);
+        uint64_t result = sGetNextRandom(self->s);
 
         if (i < frameCount) buffer[i++] = (uint16_t)((result & 0xFFFF000000000000) >> 48);
         if (i < frameCount) buffer[i++] = (uint16_t)((result & 0x0000FFFF00000000) >> 32);
@@ -233,7 +822,7 @@ static void sGeneratorFillUniformRandom(NoisyGeneratorNode *self, float *buffer,
 static void sGeneratorFillGaussianRandom(NoisyGeneratorNode *self, float *buffer, size_t frameCount)
 {
     for (size_t i = 0; i < frameCount; i++) {
-        uint64_t result = sGeneratorGetNextRandom(self);
+        uint64_t result = sGetNextRandom(self->s);
         
         buffer[i] = (
             (uint16_t)((result & 0xFFFF000000000000) >> 48) +
@@ -278,12 +867,116 @@ static void sApplyBrownianWalk(NoisyGeneratorNode *self, float *buffer, size_t f
 }
 
 
-NoisyGeneratorNode *NoisyGeneratorNodeCreate(NoisyGeneratorType type, uint64_t randomSeed)
+/*
+    Velvet noise places one +1 or -1 pulse at a random position within each
+    cell of velvetPeriod frames. All other samples are zero. Only the pulses
+    are written, so the cost is proportional to the density.
+*/
+static void sGeneratorFillVelvet(NoisyGeneratorNode *self, float *buffer, size_t frameCount)
+{
+    size_t period   = self->velvetPeriod;
+    size_t position = self->velvetPosition;
+    size_t pulse    = self->velvetPulse;
+    float  sign     = self->velvetSign;
+
+    vDSP_vclr(buffer, 1, frameCount);
+
+    size_t i = 0;
+    while (i < frameCount) {
+        if (position == 0) {
+            uint64_t result = sGetNextRandom(self->s);
+
+            pulse = (size_t)(((result >> 32) * period) >> 32);
+            sign  = (result & 1) ? 1.0f : -1.0f;
+        }
+
+        size_t count = MIN(period - position, frameCount - i);
+
+        if (pulse >= position && pulse < (position + count)) {
+            buffer[i + (pulse - position)] = sign;
+        }
+
+        i += count;
+        position += count;
+        if (position == period) position = 0;
+    }
+
+    self->velvetPosition = position;
+    self->velvetPulse    = pulse;
+    self->velvetSign     = sign;
+}
+
+
+/*
+    Fuses sGeneratorFillUniformRandom() and sApplyBrownianWalk() over blocks of 8 frames.
+
+    Each block's steps are converted from the random bits, turned into a running sum
+    with a log-step SIMD prefix sum, and offset by the current position. Reflection
+    only matters when a block leaves [-1, 1]. That is rare, and those blocks are redone
+    one step at a time.
+*/
+static void sGeneratorFillBrownian(NoisyGeneratorNode *self, float *buffer, size_t frameCount)
+{
+    const float scale  = 0.02f / (float)(UINT16_MAX);
+    const float offset = -0.01f;
+    const simd_float8 zero = { 0 };
+
+    float z = self->z;
+    size_t i = 0;
+
+    for ( ; (i + 8) <= frameCount; i += 8) {
+        uint64_t r0 = sGetNextRandom(self->s);
+        uint64_t r1 = sGetNextRandom(self->s);
+
+        // Same 16-bit split as sGeneratorFillUniformRandom()
+        simd_float8 steps = {
+            (uint16_t)(r0 >> 48), (uint16_t)(r0 >> 32), (uint16_t)(r0 >> 16), (uint16_t)r0,
+            (uint16_t)(r1 >> 48), (uint16_t)(r1 >> 32), (uint16_t)(r1 >> 16), (uint16_t)r1
+        };
+
+        steps = (steps * scale) + offset;
+
+        simd_float8 walk = steps;
+        walk += __builtin_shufflevector(walk, zero, 8, 0, 1, 2, 3, 4, 5, 6);
+        walk += __builtin_shufflevector(walk, zero, 8, 8, 0, 1, 2, 3, 4, 5);
+        walk += __builtin_shufflevector(walk, zero, 8, 8, 8, 8, 0, 1, 2, 3);
+        walk += z;
+
+        if (simd_reduce_max(walk) > 1.0f || simd_reduce_min(walk) < -1.0f) {
+            for (size_t j = 0; j < 8; j++) {
+                z += steps[j];
+
+                if (z > 1.0f) {
+                    z = 2.0f - z;
+                } else if (z < -1.0f) {
+                    z = -2.0f - z;
+                }
+
+                walk[j] = z;
+            }
+        }
+
+        memcpy(buffer + i, &walk, sizeof(walk));
+        z = walk[7];
+    }
+
+    self->z = z;
+
+    if (i < frameCount) {
+        sGeneratorFillUniformRandom(self, buffer + i, frameCount - i);
+        sApplyBrownianWalk(self, buffer + i, frameCount - i);
+    }
+}
+
+
+NoisyGeneratorNode *NoisyGeneratorNodeCreate(NoisyGeneratorType type, double density, uint64_t randomSeed)
 {
     AllocSelf(NoisyGeneratorNode);
     
     self->type = type;
-    sGeneratorSeedRandom(self, randomSeed);
+    sSeedRandom(self->s, randomSeed);
+
+    self->velvetPeriod = (density > 0) ? MAX(1, (size_t)round(1.0 / density)) : 1;
 
     return self;
 }
@@ -304,8 +997,10 @@ void NoisyGeneratorNodeProcess(NoisyGeneratorNode *self, float *buffer, size_t f
         sGeneratorFillGaussianRandom(self, buffer, frameCount);
     
     } else if (self->type == NoisyGeneratorTypeBrownian) {
-        sGeneratorFillUniformRandom(self, buffer, frameCount);
-        sApplyBrownianWalk(self, buffer, frameCount);
+        sGeneratorFillBrownian(self, buffer, frameCount);
+
+    } else if (self->type == NoisyGeneratorTypeVelvet) {
+        sGeneratorFillVelvet(self, buffer, frameCount);
     }
 }
 
@@ -366,30 +1061,48 @@ void NoisyNodeListProcess(NoisyNodeList *self, float *buffer, size_t frameCount)
 
 typedef struct NoisyOnePoleNode {
     NoisyNodeVTable vtable;
-    float a0, b1, y1;
+    NoisyBlockFilter filter;
+    float a0, b1, x1, y1;
+
+    // While modulated, b1 moves by step each frame
+    double Fc;
+    bool isHighpass;
+    float step;
+    NoisyModulation modulation;
 } NoisyOnePoleNode;
 
 
-extern NoisyOnePoleNode *NoisyOnePoleNodeCreate(double Fc, bool isHighpass)
-{
-    AllocSelf(NoisyOnePoleNode);
-    
-    float a0, b1;
+/*
+    This formula is a widely-used approximation.
+    See https://dsp.stackexchange.com/questions/28308
 
-    /*
-        This formula is a widely-used approximation.
-        See https://dsp.stackexchange.com/questions/28308
-    */
+    a0 is 1 + b1 for highpass and 1 - b1 for lowpass.
+*/
+static float sOnePoleGetB1(double Fc, bool isHighpass)
+{
     if (isHighpass) {
-        b1 = -exp(-2.0 * M_PI * (0.5 - Fc));
-        a0 = 1.0 + b1;
+        return -exp(-2.0 * M_PI * (0.5 - Fc));
     } else {
-        b1 = exp(-2.0 * M_PI * Fc);
-        a0 = 1.0 - b1;
+        return exp(-2.0 * M_PI * Fc);
     }
+}
+
+
+extern NoisyOnePoleNode *NoisyOnePoleNodeCreate(double Fc, bool isHighpass)
+{
+    AllocSelf(NoisyOnePoleNode);
+    
+    float b1 = sOnePoleGetB1(Fc, isHighpass);
+    float a0 = isHighpass ? (1.0 + b1) : (1.0 - b1);
 
     self->a0 = a0;
     self->b1 = b1;
+
+    self->Fc = Fc;
+    self->isHighpass = isHighpass;
+
+    // y[n] = a0 * x[n] + b1 * y[n - 1]
+    sBlockFilterInit(&self->filter, (double[]){ a0, 0 }, (double[]){ 1, -b1 }, 1);
     
     return self;
 }
@@ -397,25 +1110,66 @@ extern NoisyOnePoleNode *NoisyOnePoleNodeCreate(double Fc, bool isHighpass)
 
 void NoisyOnePoleNodeFree(NoisyOnePoleNode *self)
 {
+    sModulationFree(&self->modulation);
     free(self);
 }
 
 
-void NoisyOnePoleNodeProcess(NoisyOnePoleNode *self, float *buffer, size_t frameCount)
+// The coefficient changes every frame, so this runs the recurrence directly
+static void sOnePoleNodeProcessModulated(NoisyOnePoleNode *self, float *buffer, size_t frameCount)
 {
-    const float a0 = self->a0;
-    const float b1 = self->b1;
-    
+    float sign = self->isHighpass ? 1.0f : -1.0f;
+    float step = self->step;
+    float b1 = self->b1;
     float y1 = self->y1;
 
     for (size_t i = 0; i < frameCount; i++) {
-        buffer[i] = y1 = a0 * buffer[i] + b1 * y1;
+        b1 += step;
+
+        float x = buffer[i];
+        y1 = ((1.0f + (sign * b1)) * x) + (b1 * y1);
+        buffer[i] = y1;
+
+        self->x1 = x;
     }
-    
+
+    self->b1 = b1;
+    self->a0 = 1.0f + (sign * b1);
     self->y1 = y1;
 }
 
 
+void NoisyOnePoleNodeProcess(NoisyOnePoleNode *self, float *buffer, size_t frameCount)
+{
+    NoisyModulation *modulation = &self->modulation;
+
+    if (!modulation->count) {
+        // x1 is unused (its coefficient is zero) but sBlockFilterProcess() tracks it
+        sBlockFilterProcess(&self->filter, buffer, frameCount, &self->x1, &self->y1);
+        return;
+    }
+
+    while (frameCount > 0) {
+        if (!modulation->framesRemaining) {
+            sModulationStep(modulation);
+
+            double octaves = sModulationGetOffset(modulation, NoisyModulationParameterFrequency);
+            float target = sOnePoleGetB1(sClampFrequency(self->Fc * exp2(octaves)), self->isHighpass);
+
+            self->step = (target - self->b1) / NoisyModulationBlockFrameCount;
+        }
+
+        size_t framesToProcess = MIN(frameCount, modulation->framesRemaining);
+
+        sOnePoleNodeProcessModulated(self, buffer, framesToProcess);
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+        modulation->framesRemaining -= framesToProcess;
+    }
+}
+
+
 #pragma mark - Pinking
 
 typedef struct NoisyPinkingNode {
@@ -426,90 +1180,85 @@ typedef struct NoisyPinkingNode {
         struct { float b0, b1, b2, b3, b4, b5, b6; } pk3;
         struct { float b0, b1, b2; } pke;
         struct { float x1, x2, x3, y1, y2, y3; } rbj;
+        struct { float rows[16]; uint64_t s[4]; uint32_t counter; } voss;
     };
+
+    NoisyBlockFilter rbjFilter;
 } NoisyPinkingNode;
 
 
+/*
+    The "pke" and "pk3" filters are banks of independent one-pole filters whose outputs
+    are summed. Each filter is held in one lane of a SIMD vector, so a sample costs
+    a single vector multiply-add followed by a horizontal sum.
+*/
+
 /*
     Implements Paul Kellet's "pke" filter as posted to the Music-DSP mailing list
     on 1999-10-17. See https://www.firstpr.com.au/dsp/pink-noise/#Filtering
+
+    Lanes 0-2 are b0-b2. Lane 3 has no pole and holds the direct (w3) term.
 */
 static void sPinkingApplyPKE(NoisyPinkingNode *self, float *buffer, size_t frameCount)
 {
-    float b0 = self->pke.b0;
-    float b1 = self->pke.b1;
-    float b2 = self->pke.b2;
-
-    for (size_t i = 0; i < frameCount; i++) {
-        float white = buffer[i];
+    const float gain = 0.12;
 
-        const float gain = 0.12;
+    const simd_float4 poles   = { 0.99765f, 0.96300f, 0.57000f, 0.0f };
+    const simd_float4 weights = gain * (simd_float4){ 0.0990460f, 0.2965164f, 1.0526913f, 0.1848f };
 
-        float w0 = white * gain * 0.0990460;
-        float w1 = white * gain * 0.2965164;
-        float w2 = white * gain * 1.0526913;
-        float w3 = white * gain * 0.1848;
-        
-        b0 = 0.99765 * b0 + w0;
-        b1 = 0.96300 * b1 + w1;
-        b2 = 0.57000 * b2 + w2;
+    simd_float4 b = { self->pke.b0, self->pke.b1, self->pke.b2, 0.0f };
 
-        buffer[i] = b0 + b1 + b2 + w3;
+    for (size_t i = 0; i < frameCount; i++) {
+        b = simd_muladd(poles, b, weights * buffer[i]);
+        buffer[i] = simd_reduce_add(b);
     }
 
-    self->pk3.b0 = b0;
-    self->pk3.b1 = b1;
-    self->pk3.b2 = b2;
+    self->pke.b0 = b[0];
+    self->pke.b1 = b[1];
+    self->pke.b2 = b[2];
 }
 
 
 /*
     Implements Paul Kellet's "pk3" filter as posted to the Music-DSP mailing list
     on 1999-10-17. See https://www.firstpr.com.au/dsp/pink-noise/#Filtering
+
+    Lanes 0-5 are b0-b5. Lane 6 has no pole and holds the direct (w7) term.
+    b6 is the previous sample's w6, which is added separately.
 */
 static void sPinkingApplyPK3(NoisyPinkingNode *self, float *buffer, size_t frameCount)
 {
-    float b0 = self->pk3.b0;
-    float b1 = self->pk3.b1;
-    float b2 = self->pk3.b2;
-    float b3 = self->pk3.b3;
-    float b4 = self->pk3.b4;
-    float b5 = self->pk3.b5;
+    const float gain = 0.12;
+
+    const simd_float8 poles = {
+        0.99886f, 0.99332f, 0.96900f, 0.86650f, 0.55000f, -0.7616f, 0.0f, 0.0f
+    };
+
+    const simd_float8 weights = gain * (simd_float8){
+        0.0555179f, 0.0750759f, 0.1538520f, 0.3104856f, 0.5329522f, -0.0168980f, 0.5362f, 0.0f
+    };
+
+    simd_float8 b = {
+        self->pk3.b0, self->pk3.b1, self->pk3.b2, self->pk3.b3, self->pk3.b4, self->pk3.b5, 0.0f, 0.0f
+    };
+
     float b6 = self->pk3.b6;
 
     for (size_t i = 0; i < frameCount; i++) {
         float white = buffer[i];
-        
-        const float gain = 0.12;
-
-        float w0 = white * gain * 0.0555179;
-        float w1 = white * gain * 0.0750759;
-        float w2 = white * gain * 0.1538520;
-        float w3 = white * gain * 0.3104856;
-        float w4 = white * gain * 0.5329522;
-        float w5 = white * gain * 0.0168980;
-        float w6 = white * gain * 0.115926;
-        float w7 = white * gain * 0.5362;
-        
-        b0 =  0.99886 * b0 + w0;
-        b1 =  0.99332 * b1 + w1;
-        b2 =  0.96900 * b2 + w2;
-        b3 =  0.86650 * b3 + w3;
-        b4 =  0.55000 * b4 + w4;
-        b5 = -0.7616  * b5 - w5;
 
-        float pink = b0 + b1 + b2 + b3 + b4 + b5 + b6 + w7;
-        b6 = w6;
+        b = simd_muladd(poles, b, weights * white);
+        buffer[i] = simd_reduce_add(b) + b6;
 
-        buffer[i] = pink;
+        b6 = white * (gain * 0.115926f);
     }
 
-    self->pk3.b0 = b0;
-    self->pk3.b1 = b1;
-    self->pk3.b2 = b2;
-    self->pk3.b3 = b3;
-    self->pk3.b4 = b4;
-    self->pk3.b5 = b5;
+    self->pk3.b0 = b[0];
+    self->pk3.b1 = b[1];
+    self->pk3.b2 = b[2];
+    self->pk3.b3 = b[3];
+    self->pk3.b4 = b[4];
+    self->pk3.b5 = b[5];
     self->pk3.b6 = b6;
 }
 
@@ -523,39 +1272,75 @@ static void sPinkingApplyPK3(NoisyPinkingNode *self, float *buffer, size_t frame
 */
 static void sPinkingApplyRBJ(NoisyPinkingNode *self, float *buffer, size_t frameCount)
 {
-    float x1 = self->rbj.x1;
-    float x2 = self->rbj.x2;
-    float x3 = self->rbj.x3;
-    float y1 = self->rbj.y1;
-    float y2 = self->rbj.y2;
-    float y3 = self->rbj.y3;
+    sBlockFilterProcess(&self->rbjFilter, buffer, frameCount, &self->rbj.x1, &self->rbj.y1);
+}
+
+
+// Uniform from -1 to 1, from the top 24 bits of a xoshiro256** result
+static inline float sGetVossRowValue(uint64_t result)
+{
+    return ((float)(result >> 40) * (2.0f / 16777216.0f)) - 1.0f;
+}
+
+
+/*
+    Implements the Voss-McCartney algorithm. See https://www.firstpr.com.au/dsp/pink-noise/#Voss-McCartney
+
+    Each sample replaces one of 16 rows, chosen by the number of trailing zeros
+    in a counter. Row n is replaced every 2^(n + 1) samples, and the output is the
+    sum of all rows plus the current (white) input sample. Rows are drawn from the
+    node's own xoshiro256** state. They must be independent of the input: a row
+    holding an earlier input sample correlates with the output and tilts the slope.
+
+    The running sum is recomputed at the start of each call so that rounding errors
+    cannot accumulate.
+*/
+static void sPinkingApplyVoss(NoisyPinkingNode *self, float *buffer, size_t frameCount)
+{
+    float *rows = self->voss.rows;
+    uint32_t counter = self->voss.counter;
+
+    float sum = 0;
+    for (size_t r = 0; r < 16; r++) {
+        sum += rows[r];
+    }
 
     for (size_t i = 0; i < frameCount; i++) {
-        float x0 = buffer[i];
+        counter++;
+        uint32_t r = __builtin_ctz(counter | 0x8000);
 
-        float y0 = buffer[i] =
-            (0.2 * x0) + (-0.37880859 * x1) + (0.19171283 * x2) + (-0.0124264  * x3)
-                       - (-2.47930908 * y1) - (1.98501285 * y2) - (-0.50560043 * y3);
+        float row = sGetVossRowValue(sGetNextRandom(self->voss.s));
 
-        x3 = x2;  x2 = x1;  x1 = x0;
-        y3 = y2;  y2 = y1;  y1 = y0;
+        sum += row - rows[r];
+        rows[r] = row;
+
+        buffer[i] = sum + buffer[i];
     }
 
-    self->rbj.x1 = x1;
-    self->rbj.x2 = x2;
-    self->rbj.x3 = x3;
+    self->voss.counter = counter;
 
-    self->rbj.y1 = y1;
-    self->rbj.y2 = y2;
-    self->rbj.y3 = y3;
+    float gain = 0.09f;
+    vDSP_vsmul(buffer, 1, &gain, buffer, 1, frameCount);
 }
 
 
-NoisyPinkingNode *NoisyPinkingNodeCreate(NoisyPinkingType type)
+NoisyPinkingNode *NoisyPinkingNodeCreate(NoisyPinkingType type, uint64_t randomSeed)
 {
     AllocSelf(NoisyPinkingNode);
     
     self->type = type;
+
+    if (type == NoisyPinkingTypeVoss) {
+        sSeedRandom(self->voss.s, randomSeed);
+    }
+
+    if (type == NoisyPinkingTypeRBJ) {
+        sBlockFilterInit(&self->rbjFilter,
+            (double[]){ 0.2, -0.37880859, 0.19171283, -0.0124264  },
+            (double[]){ 1.0, -2.47930908, 1.98501285, -0.50560043 },
+            3
+        );
+    }
    
     return self;
 }
@@ -575,10 +1360,224 @@ void NoisyPinkingNodeProcess(NoisyPinkingNode *self, float *buffer, size_t frame
         sPinkingApplyPKE(self, buffer, frameCount);
     } else if (self->type == NoisyPinkingTypeRBJ) {
         sPinkingApplyRBJ(self, buffer, frameCount);
+    } else if (self->type == NoisyPinkingTypeVoss) {
+        sPinkingApplyVoss(self, buffer, frameCount);
+    }
+}
+
+
+#pragma mark - Spectral
+
+typedef struct NoisySpectralNode {
+    NoisyNodeVTable vtable;
+
+    FFT *fft;
+    size_t fftSize;
+    size_t blockSize;
+    size_t latency;
+
+    DSPSplitComplex kernel;
+    DSPSplitComplex spectrum;
+
+    float *history;
+    float *inputBlock;
+    float *outputBlock;
+    float *scratch;
+    size_t blockIndex;
+} NoisySpectralNode;
+
+
+static double sSpectralGetGain(const double *frequencies, const double *gains, size_t pointCount, double frequency)
+{
+    if (frequency <= frequencies[0]) {
+        return gains[0];
+    }
+    
+    for (size_t i = 1; i < pointCount; i++) {
+        if (frequency < frequencies[i]) {
+            double f0 = log2(frequencies[i - 1]);
+            double f1 = log2(frequencies[i]);
+            double t = (log2(frequency) - f0) / (f1 - f0);
+
+            return gains[i - 1] + (t * (gains[i] - gains[i - 1]));
+        }
+    }
+    
+    return gains[pointCount - 1];
+}
+
+
+/*
+    Designs a linear-phase FIR from the magnitude curve by frequency sampling:
+    the zero-phase impulse response of the sampled magnitudes is rotated by half
+    the kernel length, truncated with a Blackman window, and transformed back.
+    
+    The curve is linearly interpolated in dB over log-frequency, and held
+    constant outside of the first and last points.
+*/
+static void sSpectralMakeKernel(NoisySpectralNode *self, const double *frequencies, const double *gains, size_t pointCount)
+{
+    size_t N = self->fftSize;
+    size_t halfN = N / 2;
+    size_t tapCount = halfN + 1;
+    size_t center = (tapCount - 1) / 2;
+    
+    DSPSplitComplex *kernel = &self->kernel;
+    float *impulse = self->scratch;
+
+    for (size_t k = 0; k <= halfN; k++) {
+        double gain = sSpectralGetGain(frequencies, gains, pointCount, (double)k / N);
+        float magnitude = pow(10.0, gain / 20.0);
+
+        if (k == 0) {
+            kernel->realp[0] = magnitude;
+        } else if (k == halfN) {
+            kernel->imagp[0] = magnitude;
+        } else {
+            kernel->realp[k] = magnitude;
+            kernel->imagp[k] = 0;
+        }
+    }
+
+    // The inverse transform is scaled by N
+    FFTInverse(self->fft, kernel, impulse);
+
+    float *taps = calloc(N, sizeof(float));
+    
+    for (size_t i = 0; i < tapCount; i++) {
+        double x = (2.0 * M_PI * i) / (tapCount - 1);
+        double window = 0.42 - (0.5 * cos(x)) + (0.08 * cos(2 * x));
+        
+        size_t source = (i + N - center) % N;
+
+        taps[i] = (impulse[source] / N) * window;
+    }
+
+    FFTForward(self->fft, taps, kernel);
+
+    // Fold in the forward (x2 for the input, x2 for the kernel) and inverse (xN) scaling
+    float scale = 1.0 / (4.0 * N);
+    vDSP_vsmul(kernel->realp, 1, &scale, kernel->realp, 1, halfN);
+    vDSP_vsmul(kernel->imagp, 1, &scale, kernel->imagp, 1, halfN);
+
+    free(taps);
+}
+
+
+NoisySpectralNode *NoisySpectralNodeCreate(
+    const double *frequencies,
+    const double *gains,
+    size_t pointCount,
+    size_t log2FFTSize
+) {
+    AllocSelf(NoisySpectralNode);
+
+    size_t fftSize   = (size_t)1 << log2FFTSize;
+    size_t blockSize = fftSize / 2;
+
+    self->fft       = FFTCreate(log2FFTSize);
+    self->fftSize   = fftSize;
+    self->blockSize = blockSize;
+
+    // One block of buffering, plus the group delay of the linear-phase kernel
+    self->latency = blockSize + (blockSize / 2);
+    
+    self->kernel.realp   = calloc(blockSize, sizeof(float));
+    self->kernel.imagp   = calloc(blockSize, sizeof(float));
+    self->spectrum.realp = calloc(blockSize, sizeof(float));
+    self->spectrum.imagp = calloc(blockSize, sizeof(float));
+
+    self->history     = calloc(fftSize,   sizeof(float));
+    self->scratch     = calloc(fftSize,   sizeof(float));
+    self->inputBlock  = calloc(blockSize, sizeof(float));
+    self->outputBlock = calloc(blockSize, sizeof(float));
+
+    if (pointCount > 0) {
+        sSpectralMakeKernel(self, frequencies, gains, pointCount);
+    } else {
+        double zero = 0;
+        sSpectralMakeKernel(self, &zero, &zero, 1);
+    }
+
+    return self;
+}
+
+
+void NoisySpectralNodeFree(NoisySpectralNode *self)
+{
+    FFTFree(self->fft);
+
+    free(self->kernel.realp);
+    free(self->kernel.imagp);
+    free(self->spectrum.realp);
+    free(self->spectrum.imagp);
+
+    free(self->history);
+    free(self->scratch);
+    free(self->inputBlock);
+    free(self->outputBlock);
+
+    free(self);
+}
+
+
+/*
+    Overlap-save: the FFT input is the previous block followed by the new block.
+    With a kernel no longer than blockSize + 1 taps, the second half of the
+    circular convolution is free of wrap-around and becomes the next output block.
+*/
+static void sSpectralProcessBlock(NoisySpectralNode *self)
+{
+    size_t blockSize = self->blockSize;
+    float *history = self->history;
+
+    memmove(history, history + blockSize, blockSize * sizeof(float));
+    memcpy(history + blockSize, self->inputBlock, blockSize * sizeof(float));
+
+    FFTForward(self->fft, history, &self->spectrum);
+    FFTMultiply(self->fft, &self->spectrum, &self->kernel, &self->spectrum);
+    FFTInverse(self->fft, &self->spectrum, self->scratch);
+
+    memcpy(self->outputBlock, self->scratch + blockSize, blockSize * sizeof(float));
+}
+
+
+void NoisySpectralNodeProcess(NoisySpectralNode *self, float *buffer, size_t frameCount)
+{
+    size_t blockSize = self->blockSize;
+
+    while (frameCount > 0) {
+        size_t blockIndex = self->blockIndex;
+        size_t framesToProcess = MIN(frameCount, blockSize - blockIndex);
+
+        // Exchange input samples for output samples from the previous block
+        for (size_t i = 0; i < framesToProcess; i++) {
+            float input = buffer[i];
+            buffer[i] = self->outputBlock[blockIndex + i];
+            self->inputBlock[blockIndex + i] = input;
+        }
+
+        blockIndex += framesToProcess;
+
+        if (blockIndex == blockSize) {
+            sSpectralProcessBlock(self);
+            blockIndex = 0;
+        }
+
+        self->blockIndex = blockIndex;
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
     }
 }
 
 
+size_t NoisySpectralNodeGetLatency(NoisySpectralNode *self)
+{
+    return self->latency;
+}
+
+
 #pragma mark - Split
 
 typedef struct NoisySplitNode {
@@ -705,3 +1704,1136 @@ void NoisyZeroNodeProcess(NoisyZeroNode *self, float *buffer, size_t frameCount)
 {
     memset(buffer, 0, sizeof(float) * frameCount);
 }
+
+
+#pragma mark - Latency
+
+size_t NoisyNodeGetLatency(NoisyNodeRef self)
+{
+    if (!self) return 0;
+
+    NoisyNodeKind kind = sGetKind(self);
+    size_t result = 0;
+
+    if (kind == NoisyNodeListKind) {
+        NoisyNodeList *list = self;
+
+        for (size_t i = 0; i < list->count; i++) {
+            result += NoisyNodeGetLatency(list->nodes[i]);
+        }
+
+    } else if (kind == NoisySplitNodeKind) {
+        NoisySplitNode *split = self;
+
+        for (size_t i = 0; i < split->listCount; i++) {
+            result = MAX(result, NoisyNodeGetLatency(split->lists[i]));
+        }
+
+    } else if (kind == NoisyConvolveNodeKind) {
+        result = NoisyConvolveNodeGetLatency(self);
+
+    } else if (kind == NoisySpectralNodeKind) {
+        result = NoisySpectralNodeGetLatency(self);
+    }
+
+    return result;
+}
+
+
+void NoisyNodeSetRealTime(NoisyNodeRef self, bool realTime)
+{
+    if (!self) return;
+
+    NoisyNodeKind kind = sGetKind(self);
+
+    if (kind == NoisyNodeListKind) {
+        NoisyNodeList *list = self;
+
+        for (size_t i = 0; i < list->count; i++) {
+            NoisyNodeSetRealTime(list->nodes[i], realTime);
+        }
+
+    } else if (kind == NoisySplitNodeKind) {
+        NoisySplitNode *split = self;
+
+        for (size_t i = 0; i < split->listCount; i++) {
+            NoisyNodeSetRealTime(split->lists[i], realTime);
+        }
+
+    } else if (kind == NoisyConvolveNodeKind) {
+        NoisyConvolveNodeSetRealTime(self, realTime);
+    }
+}
+
+
+#pragma mark - Modulators
+
+static NoisyModulation *sGetModulation(NoisyNodeRef self)
+{
+    NoisyNodeKind kind = sGetKind(self);
+
+    if (kind == NoisyBiquadsNodeKind) {
+        return &((NoisyBiquadsNode *)self)->modulation;
+    } else if (kind == NoisyGainNodeKind) {
+        return &((NoisyGainNode *)self)->modulation;
+    } else if (kind == NoisyOnePoleNodeKind) {
+        return &((NoisyOnePoleNode *)self)->modulation;
+    }
+
+    return NULL;
+}
+
+
+static bool sIsModulated(NoisyNodeRef self)
+{
+    NoisyModulation *modulation = sGetModulation(self);
+    return modulation && modulation->count > 0;
+}
+
+
+bool NoisyNodeAddModulator(
+    NoisyNodeRef self,
+    Modulator *modulator,
+    NoisyModulationParameter parameter,
+    size_t section,
+    double depth
+) {
+    NoisyNodeKind kind = sGetKind(self);
+    bool isValid = false;
+
+    if (kind == NoisyBiquadsNodeKind) {
+        NoisyBiquadsNode *biquads = self;
+
+        isValid = biquads->designs && (section < biquads->sectionCount) && (
+            parameter == NoisyModulationParameterGain ||
+            parameter == NoisyModulationParameterFrequency ||
+            parameter == NoisyModulationParameterQ
+        );
+
+    } else if (kind == NoisyGainNodeKind) {
+        isValid = (parameter == NoisyModulationParameterGain) && (section == 0);
+
+    } else if (kind == NoisyOnePoleNodeKind) {
+        isValid = (parameter == NoisyModulationParameterFrequency) && (section == 0);
+    }
+
+    if (!isValid) {
+        ModulatorFree(modulator);
+        return false;
+    }
+
+    if (kind == NoisyBiquadsNodeKind) {
+        sBiquadsNodeUseCascade(self);
+    }
+
+    sModulationAppend(sGetModulation(self), modulator, parameter, section, depth);
+
+    return true;
+}
+
+
+#pragma mark - Flat List
+
+/*
+    A NoisyFlatList lowers a node list, including nested split nodes, into a
+    single array of instructions. A switch dispatches each one directly to the
+    node's process function, so there is no per-node indirect call and the
+    compiler can inline the kernels.
+
+    Slot 0 is the caller's buffer. Each split node gets two scratch slots:
+    an untouched copy of its input, and a work buffer for branches after the first.
+
+    Split nodes with several expensive branches instead become a single parallel
+    instruction. Each branch is lowered into its own flat list with its own
+    buffer, so that branches can run on different threads.
+*/
+
+typedef enum {
+    NoisyFlatOpBiquads,
+    NoisyFlatOpConvolve,
+    NoisyFlatOpDCBlock,
+    NoisyFlatOpDecorrelate,
+    NoisyFlatOpGain,
+    NoisyFlatOpGenerator,
+    NoisyFlatOpOnePole,
+    NoisyFlatOpPinking,
+    NoisyFlatOpSpectral,
+    NoisyFlatOpZero,
+
+    NoisyFlatOpCopy,    // slot = source
+    NoisyFlatOpAdd,     // slot += source
+    NoisyFlatOpParallel // slot = sum of branches(slot), node is a NoisyFlatParallel
+} NoisyFlatOp;
+
+
+typedef struct NoisyFlatInstruction {
+    NoisyFlatOp op;
+    uint16_t slot;
+    uint16_t source;
+    NoisyNodeRef node;
+} NoisyFlatInstruction;
+
+
+typedef struct NoisyFlatParallel {
+    NoisyFlatList **branches;
+    size_t branchCount;
+
+    // Buffers for branches after the first, which runs in place
+    float *buffers;
+
+    // Set for each run
+    float *slot;
+    size_t frameCount;
+} NoisyFlatParallel;
+
+
+typedef struct NoisyFlatList {
+    NoisyFlatInstruction *instructions;
+    size_t count;
+    size_t capacity;
+
+    float *scratch;
+    size_t slotCount;
+
+    NoisyFlatParallel **parallels;
+    size_t parallelCount;
+
+    double cost;
+    WorkerPool *workerPool;
+} NoisyFlatList;
+
+
+static const size_t sFlatMaxFrames = 512;
+
+
+static void sFlatListRun(NoisyFlatList *self, float *buffer, size_t frameCount);
+
+
+static double sGetNodeCost(NoisyNodeRef node)
+{
+    switch (sGetKind(node)) {
+    case NoisyBiquadsNodeKind:
+        return ((NoisyBiquadsNode *)node)->sectionCount;
+
+    case NoisyDecorrelateNodeKind: {
+        NoisyDecorrelateNode *decorrelate = node;
+        return 1.0 + ((decorrelate->positiveCount + decorrelate->negativeCount) * 0.25);
+    }
+
+    case NoisyConvolveNodeKind:
+    case NoisySpectralNodeKind:
+        return 16.0;
+
+    case NoisyGeneratorNodeKind:
+    case NoisyPinkingNodeKind:
+        return 2.0;
+
+    case NoisyNodeListKind: {
+        NoisyNodeList *list = node;
+        double cost = 0;
+
+        for (size_t i = 0; i < list->count; i++) {
+            cost += sGetNodeCost(list->nodes[i]);
+        }
+
+        return cost;
+    }
+
+    case NoisySplitNodeKind: {
+        NoisySplitNode *split = node;
+        double cost = split->listCount * 0.5; // Copies and adds
+
+        for (size_t i = 0; i < split->listCount; i++) {
+            cost += sGetNodeCost(split->lists[i]);
+        }
+
+        return cost;
+    }
+
+    default:
+        return 1.0;
+    }
+}
+
+
+static bool sShouldRunInParallel(NoisySplitNode *split)
+{
+    size_t expensiveCount = 0;
+
+    for (size_t i = 0; i < split->listCount; i++) {
+        if (sGetNodeCost(split->lists[i]) >= NoisyFlatListParallelMinimumCost) {
+            expensiveCount++;
+        }
+    }
+
+    return expensiveCount >= 2;
+}
+
+
+static void sFlatParallelFree(NoisyFlatParallel *self)
+{
+    if (!self) return;
+
+    for (size_t i = 0; i < self->branchCount; i++) {
+        NoisyFlatListFree(self->branches[i]);
+    }
+
+    free(self->branches);
+    free(self->buffers);
+    free(self);
+}
+
+
+static NoisyFlatParallel *sFlatParallelCreate(NoisySplitNode *split)
+{
+    NoisyFlatParallel *self = calloc(1, sizeof(NoisyFlatParallel));
+
+    self->branchCount = split->listCount;
+    self->branches = calloc(split->listCount, sizeof(NoisyFlatList *));
+    self->buffers  = calloc((split->listCount - 1) * sFlatMaxFrames, sizeof(float));
+
+    for (size_t i = 0; i < split->listCount; i++) {
+        self->branches[i] = NoisyFlatListCreate(split->lists[i]);
+
+        if (!self->branches[i]) {
+            sFlatParallelFree(self);
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+
+static void sFlatParallelTask(void *context, size_t index)
+{
+    NoisyFlatParallel *self = context;
+    float *buffer = index ? (self->buffers + ((index - 1) * sFlatMaxFrames)) : self->slot;
+
+    sFlatListRun(self->branches[index], buffer, self->frameCount);
+}
+
+
+// Same order of operations as sSplitNodeProcess(), so results match a serial run
+static void sFlatParallelRun(NoisyFlatParallel *self, WorkerPool *workerPool, float *slot, size_t frameCount)
+{
+    for (size_t i = 1; i < self->branchCount; i++) {
+        memcpy(self->buffers + ((i - 1) * sFlatMaxFrames), slot, frameCount * sizeof(float));
+    }
+
+    self->slot = slot;
+    self->frameCount = frameCount;
+
+    if (frameCount < NoisyFlatListParallelMinimumFrameCount) workerPool = NULL;
+
+    WorkerPoolRun(workerPool, sFlatParallelTask, self, self->branchCount);
+
+    for (size_t i = 1; i < self->branchCount; i++) {
+        vDSP_vadd(slot, 1, self->buffers + ((i - 1) * sFlatMaxFrames), 1, slot, 1, frameCount);
+    }
+}
+
+
+static void sFlatListEmit(NoisyFlatList *self, NoisyFlatOp op, size_t slot, size_t source, NoisyNodeRef node)
+{
+    if (self->count == self->capacity) {
+        self->capacity = self->capacity ? (self->capacity * 2) : 16;
+        self->instructions = realloc(self->instructions, self->capacity * sizeof(NoisyFlatInstruction));
+    }
+
+    self->instructions[self->count++] = (NoisyFlatInstruction){ op, slot, source, node };
+}
+
+
+static bool sFlatListLower(NoisyFlatList *self, NoisyNodeList *list, size_t slot)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        NoisyNodeRef node = list->nodes[i];
+        NoisyNodeKind kind = sGetKind(node);
+
+        if (kind == NoisySplitNodeKind) {
+            NoisySplitNode *split = node;
+            if (split->listCount == 0) continue;
+
+            if (sShouldRunInParallel(split)) {
+                NoisyFlatParallel *parallel = sFlatParallelCreate(split);
+                if (!parallel) return false;
+
+                self->parallels = realloc(self->parallels, (self->parallelCount + 1) * sizeof(NoisyFlatParallel *));
+                self->parallels[self->parallelCount++] = parallel;
+
+                sFlatListEmit(self, NoisyFlatOpParallel, slot, slot, parallel);
+                self->cost += sGetNodeCost(split);
+
+                continue;
+            }
+
+            size_t input = self->slotCount++;
+            size_t work  = self->slotCount++;
+
+            if (self->slotCount > UINT16_MAX) return false;
+
+            sFlatListEmit(self, NoisyFlatOpCopy, input, slot, NULL);
+
+            // Same order of operations as sSplitNodeProcess()
+            if (!sFlatListLower(self, split->lists[0], slot)) return false;
+
+            for (size_t j = 1; j < split->listCount; j++) {
+                bool isLast = (j == (split->listCount - 1));
+                size_t branch = isLast ? input : work;
+
+                if (!isLast) sFlatListEmit(self, NoisyFlatOpCopy, work, input, NULL);
+                if (!sFlatListLower(self, split->lists[j], branch)) return false;
+
+                sFlatListEmit(self, NoisyFlatOpAdd, slot, branch, NULL);
+            }
+
+        } else if (kind == NoisyNodeListKind) {
+            if (!sFlatListLower(self, node, slot)) return false;
+
+        } else {
+            NoisyFlatOp op;
+
+            if      (kind == NoisyBiquadsNodeKind)     op = NoisyFlatOpBiquads;
+            else if (kind == NoisyConvolveNodeKind)    op = NoisyFlatOpConvolve;
+            else if (kind == NoisyDCBlockNodeKind)     op = NoisyFlatOpDCBlock;
+            else if (kind == NoisyDecorrelateNodeKind) op = NoisyFlatOpDecorrelate;
+            else if (kind == NoisyGainNodeKind)        op = NoisyFlatOpGain;
+            else if (kind == NoisyGeneratorNodeKind)   op = NoisyFlatOpGenerator;
+            else if (kind == NoisyOnePoleNodeKind)     op = NoisyFlatOpOnePole;
+            else if (kind == NoisyPinkingNodeKind)     op = NoisyFlatOpPinking;
+            else if (kind == NoisySpectralNodeKind)    op = NoisyFlatOpSpectral;
+            else if (kind == NoisyZeroNodeKind)        op = NoisyFlatOpZero;
+            else return false;
+
+            sFlatListEmit(self, op, slot, slot, node);
+            self->cost += sGetNodeCost(node);
+        }
+    }
+
+    return true;
+}
+
+
+NoisyFlatList *NoisyFlatListCreate(NoisyNodeList *nodeList)
+{
+    if (!nodeList) return NULL;
+
+    NoisyFlatList *self = calloc(1, sizeof(NoisyFlatList));
+    self->slotCount = 1;
+
+    if (!sFlatListLower(self, nodeList, 0)) {
+        NoisyFlatListFree(self);
+        return NULL;
+    }
+
+    if (self->slotCount > 1) {
+        self->scratch = calloc((self->slotCount - 1) * sFlatMaxFrames, sizeof(float));
+    }
+
+    return self;
+}
+
+
+void NoisyFlatListFree(NoisyFlatList *self)
+{
+    if (!self) return;
+
+    for (size_t i = 0; i < self->parallelCount; i++) {
+        sFlatParallelFree(self->parallels[i]);
+    }
+
+    free(self->parallels);
+    free(self->instructions);
+    free(self->scratch);
+    free(self);
+}
+
+
+static void sFlatListRun(NoisyFlatList *self, float *buffer, size_t frameCount)
+{
+    const NoisyFlatInstruction *instruction = self->instructions;
+    const NoisyFlatInstruction *end = instruction + self->count;
+
+    float *scratch = self->scratch;
+
+    // Slot 0 is the caller's buffer. Slot n > 0 is the (n - 1)th block of scratch.
+    #define SLOT(i) ((i) ? (scratch + (((i) - 1) * sFlatMaxFrames)) : buffer)
+
+    for ( ; instruction < end; instruction++) {
+        float *slot = SLOT(instruction->slot);
+        NoisyNodeRef node = instruction->node;
+
+        switch (instruction->op) {
+        case NoisyFlatOpBiquads:     NoisyBiquadsNodeProcess(node, slot, frameCount);     break;
+        case NoisyFlatOpConvolve:    NoisyConvolveNodeProcess(node, slot, frameCount);    break;
+        case NoisyFlatOpDCBlock:     NoisyDCBlockNodeProcess(node, slot, frameCount);     break;
+        case NoisyFlatOpDecorrelate: NoisyDecorrelateNodeProcess(node, slot, frameCount); break;
+        case NoisyFlatOpGain:        NoisyGainNodeProcess(node, slot, frameCount);        break;
+        case NoisyFlatOpGenerator:   NoisyGeneratorNodeProcess(node, slot, frameCount);   break;
+        case NoisyFlatOpOnePole:     NoisyOnePoleNodeProcess(node, slot, frameCount);     break;
+        case NoisyFlatOpPinking:     NoisyPinkingNodeProcess(node, slot, frameCount);     break;
+        case NoisyFlatOpSpectral:    NoisySpectralNodeProcess(node, slot, frameCount);    break;
+        case NoisyFlatOpZero:        NoisyZeroNodeProcess(node, slot, frameCount);        break;
+
+        case NoisyFlatOpCopy:
+            memcpy(slot, SLOT(instruction->source), frameCount * sizeof(float));
+            break;
+
+        case NoisyFlatOpAdd:
+            vDSP_vadd(slot, 1, SLOT(instruction->source), 1, slot, 1, frameCount);
+            break;
+
+        case NoisyFlatOpParallel:
+            sFlatParallelRun(node, self->workerPool, slot, frameCount);
+            break;
+        }
+    }
+
+    #undef SLOT
+}
+
+
+void NoisyFlatListProcess(NoisyFlatList *self, float *buffer, size_t frameCount)
+{
+    if (!self) return;
+
+    while (frameCount > 0) {
+        size_t framesToProcess = MIN(frameCount, sFlatMaxFrames);
+
+        sFlatListRun(self, buffer, framesToProcess);
+
+        buffer += framesToProcess;
+        frameCount -= framesToProcess;
+    }
+}
+
+
+double NoisyFlatListGetCost(NoisyFlatList *self)
+{
+    return self ? self->cost : 0;
+}
+
+
+void NoisyFlatListSetWorkerPool(NoisyFlatList *self, WorkerPool *workerPool)
+{
+    if (!self) return;
+
+    self->workerPool = workerPool;
+
+    for (size_t i = 0; i < self->parallelCount; i++) {
+        NoisyFlatParallel *parallel = self->parallels[i];
+
+        for (size_t j = 0; j < parallel->branchCount; j++) {
+            NoisyFlatListSetWorkerPool(parallel->branches[j], workerPool);
+        }
+    }
+}
+
+
+#pragma mark - Batch
+
+/*
+    A batch list runs the same node graph for several independent instances ("lanes").
+    
+    Buffers are lane-interleaved: buffer[(frame * laneCount) + lane]. Each state variable
+    is stored as an array with one element per lane. The inner loop of every kernel runs
+    across lanes rather than across time, so per-sample recurrences (IIR filters, the
+    brownian walk, the PRNG) no longer serialize and the compiler can vectorize them.
+*/
+
+static const size_t sBatchMaxFrames = 256;
+
+typedef struct NoisyBatchList NoisyBatchList;
+
+typedef struct NoisyBatchStep {
+    NoisyNodeKind kind;
+    int subtype;
+
+    float scalar;
+    float a0, b1;
+
+    size_t sectionCount;
+    float *coefficients;
+
+    float *state;
+    uint64_t *random;
+    uint32_t counter;
+
+    NoisyBatchList **lists;
+    size_t listCount;
+    float *scratch;
+} NoisyBatchStep;
+
+typedef struct NoisyBatchList {
+    size_t laneCount;
+    size_t count;
+    NoisyBatchStep *steps;
+} NoisyBatchList;
+
+
+static void sBatchStepFree(NoisyBatchStep *step);
+
+
+static bool sBatchCheckLanes(NoisyNodeRef *nodes, size_t laneCount)
+{
+    NoisyNodeKind kind = sGetKind(nodes[0]);
+
+    for (size_t k = 1; k < laneCount; k++) {
+        if (sGetKind(nodes[k]) != kind) return false;
+    }
+
+    // Lanes share coefficients, which modulation would change per lane
+    for (size_t k = 0; k < laneCount; k++) {
+        if (sIsModulated(nodes[k])) return false;
+    }
+
+    for (size_t k = 1; k < laneCount; k++) {
+        if (kind == NoisyBiquadsNodeKind) {
+            NoisyBiquadsNode *a = nodes[0], *b = nodes[k];
+
+            if (a->sectionCount != b->sectionCount) return false;
+            if (a->sectionCount && memcmp(a->coefficients, b->coefficients, 5 * a->sectionCount * sizeof(double))) return false;
+
+        } else if (kind == NoisyGainNodeKind) {
+            if (((NoisyGainNode *)nodes[0])->scalar != ((NoisyGainNode *)nodes[k])->scalar) return false;
+
+        } else if (kind == NoisyGeneratorNodeKind) {
+            if (((NoisyGeneratorNode *)nodes[0])->type != ((NoisyGeneratorNode *)nodes[k])->type) return false;
+
+        } else if (kind == NoisyOnePoleNodeKind) {
+            NoisyOnePoleNode *a = nodes[0], *b = nodes[k];
+            if (a->a0 != b->a0 || a->b1 != b->b1) return false;
+
+        } else if (kind == NoisyPinkingNodeKind) {
+            NoisyPinkingNode *a = nodes[0], *b = nodes[k];
+            if (a->type != b->type) return false;
+            if (a->type == NoisyPinkingTypeVoss && a->voss.counter != b->voss.counter) return false;
+
+        } else if (kind == NoisySplitNodeKind) {
+            if (((NoisySplitNode *)nodes[0])->listCount != ((NoisySplitNode *)nodes[k])->listCount) return false;
+        }
+    }
+
+    return true;
+}
+
+
+static bool sBatchStepInit(NoisyBatchStep *step, NoisyNodeRef *nodes, size_t laneCount)
+{
+    if (!sBatchCheckLanes(nodes, laneCount)) {
+        return false;
+    }
+
+    NoisyNodeKind kind = sGetKind(nodes[0]);
+    step->kind = kind;
+
+    if (kind == NoisyBiquadsNodeKind) {
+        NoisyBiquadsNode *node = nodes[0];
+        size_t sectionCount = node->sectionCount;
+
+        step->sectionCount = sectionCount;
+        step->coefficients = malloc(5 * sectionCount * sizeof(float));
+
+        for (size_t i = 0; i < 5 * sectionCount; i++) {
+            step->coefficients[i] = node->coefficients[i];
+        }
+
+        // { x1, x2, y1, y2 } per section, with one element per lane
+        step->state = calloc(4 * sectionCount * laneCount, sizeof(float));
+
+    } else if (kind == NoisyDCBlockNodeKind) {
+        step->state = calloc(2 * laneCount, sizeof(float));
+
+        for (size_t k = 0; k < laneCount; k++) {
+            NoisyDCBlockNode *node = nodes[k];
+            step->state[k]             = node->x1;
+            step->state[k + laneCount] = node->y1;
+        }
+
+    } else if (kind == NoisyGainNodeKind) {
+        step->scalar = ((NoisyGainNode *)nodes[0])->scalar;
+
+    } else if (kind == NoisyGeneratorNodeKind) {
+        if (((NoisyGeneratorNode *)nodes[0])->type == NoisyGeneratorTypeVelvet) {
+            return false;
+        }
+
+        step->subtype = ((NoisyGeneratorNode *)nodes[0])->type;
+        step->random  = calloc(4 * laneCount, sizeof(uint64_t));
+        step->state   = calloc(laneCount, sizeof(float));
+
+        for (size_t k = 0; k < laneCount; k++) {
+            NoisyGeneratorNode *node = nodes[k];
+
+            for (size_t j = 0; j < 4; j++) {
+                step->random[(j * laneCount) + k] = node->s[j];
+            }
+
+            step->state[k] = node->z;
+        }
+
+    } else if (kind == NoisyOnePoleNodeKind) {
+        NoisyOnePoleNode *node = nodes[0];
+
+        step->a0 = node->a0;
+        step->b1 = node->b1;
+        step->state = calloc(laneCount, sizeof(float));
+
+        for (size_t k = 0; k < laneCount; k++) {
+            step->state[k] = ((NoisyOnePoleNode *)nodes[k])->y1;
+        }
+
+    } else if (kind == NoisyPinkingNodeKind && ((NoisyPinkingNode *)nodes[0])->type == NoisyPinkingTypeVoss) {
+        step->subtype = NoisyPinkingTypeVoss;
+        step->counter = ((NoisyPinkingNode *)nodes[0])->voss.counter;
+
+        // 16 rows and the running sum
+        step->state  = calloc(17 * laneCount, sizeof(float));
+        step->random = calloc(4 * laneCount, sizeof(uint64_t));
+
+        for (size_t k = 0; k < laneCount; k++) {
+            NoisyPinkingNode *node = nodes[k];
+
+            for (size_t j = 0; j < 16; j++) {
+                step->state[(j * laneCount) + k] = node->voss.rows[j];
+            }
+
+            for (size_t j = 0; j < 4; j++) {
+                step->random[(j * laneCount) + k] = node->voss.s[j];
+            }
+        }
+
+    } else if (kind == NoisyPinkingNodeKind) {
+        step->subtype = ((NoisyPinkingNode *)nodes[0])->type;
+        step->state = calloc(7 * laneCount, sizeof(float));
+
+        // All three pinking states share the union storage; copy it as a flat float array
+        for (size_t k = 0; k < laneCount; k++) {
+            const float *values = &((NoisyPinkingNode *)nodes[k])->pk3.b0;
+
+            for (size_t j = 0; j < 7; j++) {
+                step->state[(j * laneCount) + k] = values[j];
+            }
+        }
+
+    } else if (kind == NoisySplitNodeKind) {
+        size_t listCount = ((NoisySplitNode *)nodes[0])->listCount;
+        NoisyNodeRef *laneLists = malloc(laneCount * sizeof(NoisyNodeRef));
+        
+        step->listCount = listCount;
+        step->lists     = calloc(listCount, sizeof(NoisyBatchList *));
+        step->scratch   = listCount > 1 ? malloc(2 * sBatchMaxFrames * laneCount * sizeof(float)) : NULL;
+
+        bool ok = true;
+
+        for (size_t i = 0; ok && (i < listCount); i++) {
+            for (size_t k = 0; k < laneCount; k++) {
+                laneLists[k] = ((NoisySplitNode *)nodes[k])->lists[i];
+            }
+
+            step->lists[i] = NoisyBatchListCreate((NoisyNodeList **)laneLists, laneCount);
+            ok = (step->lists[i] != NULL);
+        }
+        
+        free(laneLists);
+
+        if (!ok) return false;
+
+    } else if (kind == NoisyZeroNodeKind) {
+        // Stateless
+
+    } else {
+        // Nested node lists only appear inside split nodes. Other kinds have no batch kernel.
+        return false;
+    }
+
+    return true;
+}
+
+
+static void sBatchStepFree(NoisyBatchStep *step)
+{
+    for (size_t i = 0; i < step->listCount; i++) {
+        NoisyBatchListFree(step->lists[i]);
+    }
+
+    free(step->lists);
+    free(step->scratch);
+    free(step->coefficients);
+    free(step->state);
+    free(step->random);
+}
+
+
+static void sBatchProcessBiquads(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    for (size_t s = 0; s < step->sectionCount; s++) {
+        const float *c = &step->coefficients[s * 5];
+        const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+
+        // Direct form I. Each section keeps its own input history: sharing it with the
+        // previous section's output history (as vDSP_biquad() does) only works frame-major.
+        float *restrict x1 = step->state + ((4 * s) + 0) * laneCount;
+        float *restrict x2 = step->state + ((4 * s) + 1) * laneCount;
+        float *restrict y1 = step->state + ((4 * s) + 2) * laneCount;
+        float *restrict y2 = step->state + ((4 * s) + 3) * laneCount;
+
+        for (size_t i = 0; i < frameCount; i++) {
+            float *restrict frame = buffer + (i * laneCount);
+
+            for (size_t k = 0; k < laneCount; k++) {
+                float x0 = frame[k];
+                float y0 = (b0 * x0) + (b1 * x1[k]) + (b2 * x2[k]) - (a1 * y1[k]) - (a2 * y2[k]);
+
+                x2[k] = x1[k];  x1[k] = x0;
+                y2[k] = y1[k];  y1[k] = y0;
+
+                frame[k] = y0;
+            }
+        }
+    }
+}
+
+
+static void sBatchProcessDCBlock(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    float *restrict x1 = step->state;
+    float *restrict y1 = step->state + laneCount;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        float *restrict frame = buffer + (i * laneCount);
+
+        for (size_t k = 0; k < laneCount; k++) {
+            float x0 = frame[k];
+            y1[k] = frame[k] = x0 - x1[k] + 0.9997f * y1[k];
+            x1[k] = x0;
+        }
+    }
+}
+
+
+static void sBatchFillRandom(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    uint64_t *restrict s0 = step->random;
+    uint64_t *restrict s1 = step->random + laneCount;
+    uint64_t *restrict s2 = step->random + laneCount * 2;
+    uint64_t *restrict s3 = step->random + laneCount * 3;
+
+    bool isGaussian = (step->subtype == NoisyGeneratorTypeGaussian);
+    size_t framesPerResult = isGaussian ? 1 : 4;
+
+    for (size_t i = 0; i < frameCount; i += framesPerResult) {
+        float *restrict frame = buffer + (i * laneCount);
+        size_t available = MIN(frameCount - i, framesPerResult);
+
+        for (size_t k = 0; k < laneCount; k++) {
+            // xoshiro256**, see sGetNextRandom()
+            const uint64_t s1_5   = s1[k] * 5;
+            const uint64_t result = ((s1_5 << 7) | (s1_5 >> (64 - 7))) * 9;
+            const uint64_t t      = s1[k] << 17;
+
+            s2[k] ^= s0[k];
+            s3[k] ^= s1[k];
+            s1[k] ^= s2[k];
+            s0[k] ^= s3[k];
+            s2[k] ^= t;
+            s3[k] = (s3[k] << 45) | (s3[k] >> (64 - 45));
+
+            uint16_t p0 = (uint16_t)(result >> 48);
+            uint16_t p1 = (uint16_t)(result >> 32);
+            uint16_t p2 = (uint16_t)(result >> 16);
+            uint16_t p3 = (uint16_t)(result      );
+
+            if (isGaussian) {
+                frame[k] = (float)p0 + (float)p1 + (float)p2 + (float)p3;
+            } else {
+                                     frame[k                ] = p0;
+                if (available > 1)   frame[k + laneCount    ] = p1;
+                if (available > 2)   frame[k + laneCount * 2] = p2;
+                if (available > 3)   frame[k + laneCount * 3] = p3;
+            }
+        }
+    }
+
+    float scale = isGaussian ? (1.0f / (float)(UINT16_MAX * 2)) : (2.0f / (float)(UINT16_MAX));
+    float minusOne = -1.0f;
+
+    vDSP_vsmsa(buffer, 1, &scale, &minusOne, buffer, 1, frameCount * laneCount);
+}
+
+
+static void sBatchProcessGenerator(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    sBatchFillRandom(step, laneCount, buffer, frameCount);
+
+    if (step->subtype == NoisyGeneratorTypeBrownian) {
+        float *restrict z = step->state;
+
+        for (size_t i = 0; i < frameCount; i++) {
+            float *restrict frame = buffer + (i * laneCount);
+
+            for (size_t k = 0; k < laneCount; k++) {
+                float zk = z[k] + (frame[k] * 0.01f);
+
+                zk = (zk >  1.0f) ? ( 2.0f - zk) : zk;
+                zk = (zk < -1.0f) ? (-2.0f - zk) : zk;
+
+                frame[k] = z[k] = zk;
+            }
+        }
+    }
+}
+
+
+static void sBatchProcessOnePole(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    const float a0 = step->a0;
+    const float b1 = step->b1;
+    float *restrict y1 = step->state;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        float *restrict frame = buffer + (i * laneCount);
+
+        for (size_t k = 0; k < laneCount; k++) {
+            frame[k] = y1[k] = a0 * frame[k] + b1 * y1[k];
+        }
+    }
+}
+
+
+// Same as sPinkingApplyVoss(). The lanes share a counter, so every lane replaces the same row.
+static void sBatchProcessVoss(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    float *restrict sum = step->state + (16 * laneCount);
+    uint32_t counter = step->counter;
+
+    uint64_t *restrict s0 = step->random;
+    uint64_t *restrict s1 = step->random + laneCount;
+    uint64_t *restrict s2 = step->random + laneCount * 2;
+    uint64_t *restrict s3 = step->random + laneCount * 3;
+
+    vDSP_vclr(sum, 1, laneCount);
+
+    for (size_t j = 0; j < 16; j++) {
+        vDSP_vadd(sum, 1, step->state + (j * laneCount), 1, sum, 1, laneCount);
+    }
+
+    for (size_t i = 0; i < frameCount; i++) {
+        float *restrict frame = buffer + (i * laneCount);
+
+        counter++;
+        float *restrict row = step->state + (__builtin_ctz(counter | 0x8000) * laneCount);
+
+        for (size_t k = 0; k < laneCount; k++) {
+            // xoshiro256**, see sGetNextRandom()
+            const uint64_t s1_5   = s1[k] * 5;
+            const uint64_t result = ((s1_5 << 7) | (s1_5 >> (64 - 7))) * 9;
+            const uint64_t t      = s1[k] << 17;
+
+            s2[k] ^= s0[k];
+            s3[k] ^= s1[k];
+            s1[k] ^= s2[k];
+            s0[k] ^= s3[k];
+            s2[k] ^= t;
+            s3[k] = (s3[k] << 45) | (s3[k] >> (64 - 45));
+
+            float value = sGetVossRowValue(result);
+
+            sum[k] += value - row[k];
+            row[k] = value;
+
+            frame[k] = sum[k] + frame[k];
+        }
+    }
+
+    step->counter = counter;
+
+    float gain = 0.09f;
+    vDSP_vsmul(buffer, 1, &gain, buffer, 1, frameCount * laneCount);
+}
+
+
+static void sBatchProcessPinking(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t frameCount)
+{
+    if (step->subtype == NoisyPinkingTypeVoss) {
+        sBatchProcessVoss(step, laneCount, buffer, frameCount);
+        return;
+    }
+
+    float *restrict v0 = step->state;
+    float *restrict v1 = step->state + laneCount;
+    float *restrict v2 = step->state + laneCount * 2;
+    float *restrict v3 = step->state + laneCount * 3;
+    float *restrict v4 = step->state + laneCount * 4;
+    float *restrict v5 = step->state + laneCount * 5;
+    float *restrict v6 = step->state + laneCount * 6;
+
+    const float gain = 0.12f;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        float *restrict frame = buffer + (i * laneCount);
+
+        // Same recurrences as sPinkingApplyPK3(), sPinkingApplyPKE() and sPinkingApplyRBJ()
+        if (step->subtype == NoisyPinkingTypePK3) {
+            for (size_t k = 0; k < laneCount; k++) {
+                float white = frame[k];
+
+                v0[k] =  0.99886f * v0[k] + white * gain * 0.0555179f;
+                v1[k] =  0.99332f * v1[k] + white * gain * 0.0750759f;
+                v2[k] =  0.96900f * v2[k] + white * gain * 0.1538520f;
+                v3[k] =  0.86650f * v3[k] + white * gain * 0.3104856f;
+                v4[k] =  0.55000f * v4[k] + white * gain * 0.5329522f;
+                v5[k] = -0.7616f  * v5[k] - white * gain * 0.0168980f;
+
+                frame[k] = v0[k] + v1[k] + v2[k] + v3[k] + v4[k] + v5[k] + v6[k] + white * gain * 0.5362f;
+                v6[k] = white * gain * 0.115926f;
+            }
+
+        } else if (step->subtype == NoisyPinkingTypePKE) {
+            for (size_t k = 0; k < laneCount; k++) {
+                float white = frame[k];
+
+                v0[k] = 0.99765f * v0[k] + white * gain * 0.0990460f;
+                v1[k] = 0.96300f * v1[k] + white * gain * 0.2965164f;
+                v2[k] = 0.57000f * v2[k] + white * gain * 1.0526913f;
+
+                frame[k] = v0[k] + v1[k] + v2[k] + white * gain * 0.1848f;
+            }
+
+        } else if (step->subtype == NoisyPinkingTypeRBJ) {
+            // v0-v2 are x1-x3, v3-v5 are y1-y3
+            for (size_t k = 0; k < laneCount; k++) {
+                float x0 = frame[k];
+
+                float y0 = (0.2f * x0) + (-0.37880859f * v0[k]) + (0.19171283f * v1[k]) + (-0.0124264f  * v2[k])
+                                      - (-2.47930908f * v3[k]) - (1.98501285f * v4[k]) - (-0.50560043f * v5[k]);
+
+                v2[k] = v1[k];  v1[k] = v0[k];  v0[k] = x0;
+                v5[k] = v4[k];  v4[k] = v3[k];  v3[k] = y0;
+
+                frame[k] = y0;
+            }
+        }
+    }
+}
+
+
+static void sBatchProcessSplit(NoisyBatchStep *step, size_t laneCount, float *buffer, size_t inFrameCount)
+{
+    size_t framesRemaining = inFrameCount;
+
+    // Rather than one scratch buffer per list (as in NoisySplitNode), keep an untouched copy
+    // of the input and a single work buffer. The last list consumes the copy in-place.
+    float *input = step->scratch;
+    float *work  = step->scratch + (sBatchMaxFrames * laneCount);
+
+    while (framesRemaining > 0) {
+        size_t frameCount  = MIN(framesRemaining, sBatchMaxFrames);
+        size_t sampleCount = frameCount * laneCount;
+
+        if (step->listCount > 1) {
+            memcpy(input, buffer, sampleCount * sizeof(float));
+        }
+
+        if (step->listCount > 0) {
+            NoisyBatchListProcess(step->lists[0], buffer, frameCount);
+        }
+
+        for (size_t i = 1; i < step->listCount; i++) {
+            bool isLast = (i == step->listCount - 1);
+            float *tmp = isLast ? input : work;
+
+            if (!isLast) memcpy(work, input, sampleCount * sizeof(float));
+
+            NoisyBatchListProcess(step->lists[i], tmp, frameCount);
+            vDSP_vadd(buffer, 1, tmp, 1, buffer, 1, sampleCount);
+        }
+
+        buffer += sampleCount;
+        framesRemaining -= frameCount;
+    }
+}
+
+
+NoisyBatchList *NoisyBatchListCreate(NoisyNodeList **nodeLists, size_t laneCount)
+{
+    if (laneCount == 0) return NULL;
+
+    size_t count = nodeLists[0] ? nodeLists[0]->count : 0;
+
+    for (size_t k = 0; k < laneCount; k++) {
+        size_t laneListCount = nodeLists[k] ? nodeLists[k]->count : 0;
+        if (laneListCount != count) return NULL;
+    }
+
+    NoisyBatchList *self = calloc(1, sizeof(NoisyBatchList));
+
+    self->laneCount = laneCount;
+    self->steps     = count ? calloc(count, sizeof(NoisyBatchStep)) : NULL;
+
+    NoisyNodeRef *laneNodes = malloc(laneCount * sizeof(NoisyNodeRef));
+    bool ok = true;
+
+    for (size_t i = 0; ok && (i < count); i++) {
+        for (size_t k = 0; k < laneCount; k++) {
+            laneNodes[k] = nodeLists[k]->nodes[i];
+        }
+
+        ok = sBatchStepInit(&self->steps[i], laneNodes, laneCount);
+        self->count = i + 1;
+    }
+
+    free(laneNodes);
+
+    if (!ok) {
+        NoisyBatchListFree(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+
+void NoisyBatchListFree(NoisyBatchList *self)
+{
+    if (!self) return;
+
+    for (size_t i = 0; i < self->count; i++) {
+        sBatchStepFree(&self->steps[i]);
+    }
+
+    free(self->steps);
+    free(self);
+}
+
+
+void NoisyBatchListProcess(NoisyBatchList *self, float *buffer, size_t frameCount)
+{
+    if (!self) return;
+
+    size_t laneCount = self->laneCount;
+
+    for (size_t i = 0; i < self->count; i++) {
+        NoisyBatchStep *step = &self->steps[i];
+        NoisyNodeKind kind = step->kind;
+
+        if (kind == NoisyBiquadsNodeKind) {
+            sBatchProcessBiquads(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisyDCBlockNodeKind) {
+            sBatchProcessDCBlock(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisyGainNodeKind) {
+            vDSP_vsmul(buffer, 1, &step->scalar, buffer, 1, frameCount * laneCount);
+        } else if (kind == NoisyGeneratorNodeKind) {
+            sBatchProcessGenerator(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisyOnePoleNodeKind) {
+            sBatchProcessOnePole(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisyPinkingNodeKind) {
+            sBatchProcessPinking(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisySplitNodeKind) {
+            sBatchProcessSplit(step, laneCount, buffer, frameCount);
+        } else if (kind == NoisyZeroNodeKind) {
+            memset(buffer, 0, sizeof(float) * frameCount * laneCount);
+        }
+    }
+}
@@ -8,20 +8,59 @@
 #include <stdbool.h>
 #include <Accelerate/Accelerate.h>
 
+#include "Modulator.h"
+#include "WorkerPool.h"
+
 typedef void *NoisyNodeRef;
 
 extern void NoisyNodeFree(NoisyNodeRef self);
 
+// Returns the number of frames by which the node delays its input
+extern size_t NoisyNodeGetLatency(NoisyNodeRef self);
+
+// Lets nodes with worker threads skip late work rather than wait for it. Must not be
+// called while processing.
+extern void NoisyNodeSetRealTime(NoisyNodeRef self, bool realTime);
+
 
 #pragma mark - Biquads
 
 typedef struct NoisyBiquadsNode NoisyBiquadsNode;
 
+// Unmodulated nodes with fewer sections use vDSP_biquad(), which is faster for short
+// cascades (below four sections, the cascade pads its lanes with pass-through sections).
+// Tune with "--benchmark --suite biquads".
+enum { NoisyBiquadsNodeCascadeMinimumSectionCount = 8 };
+
 extern NoisyBiquadsNode *NoisyBiquadsNodeCreate(const double *coefficients, size_t sectionCount);
+
+// designs holds { type, frequency, Q, gain } per section, with a BiquadType and a normalized
+// frequency (see BiquadGetCoefficients()). Only nodes created this way may be modulated.
+extern NoisyBiquadsNode *NoisyBiquadsNodeCreateWithDesigns(const double *designs, size_t sectionCount);
+
 extern void NoisyBiquadsNodeFree(NoisyBiquadsNode *self);
 extern void NoisyBiquadsNodeProcess(NoisyBiquadsNode *self, float *buffer, size_t frameCount);
 
 
+#pragma mark - Convolve
+
+typedef struct NoisyConvolveNode NoisyConvolveNode;
+
+// See Convolver.h. Returns NULL for invalid block sizes or an empty impulse.
+extern NoisyConvolveNode *NoisyConvolveNodeCreate(
+    const float *impulse,
+    size_t impulseLength,
+    size_t headBlockSize,
+    size_t tailBlockSize,
+    bool useWorkerThread
+);
+
+extern void NoisyConvolveNodeFree(NoisyConvolveNode *self);
+extern void NoisyConvolveNodeProcess(NoisyConvolveNode *self, float *buffer, size_t frameCount);
+extern size_t NoisyConvolveNodeGetLatency(NoisyConvolveNode *self);
+extern void NoisyConvolveNodeSetRealTime(NoisyConvolveNode *self, bool realTime);
+
+
 #pragma mark - DC Block
 
 typedef struct NoisyDCBlockNode NoisyDCBlockNode;
@@ -31,6 +70,16 @@ extern void NoisyDCBlockNodeFree(NoisyDCBlockNode *self);
 extern void NoisyDCBlockNodeProcess(NoisyDCBlockNode *self, float *buffer, size_t frameCount);
 
 
+#pragma mark - Decorrelate
+
+typedef struct NoisyDecorrelateNode NoisyDecorrelateNode;
+
+// length is in frames, density is normalized (taps per frame)
+extern NoisyDecorrelateNode *NoisyDecorrelateNodeCreate(size_t length, double density, uint64_t randomSeed);
+extern void NoisyDecorrelateNodeFree(NoisyDecorrelateNode *self);
+extern void NoisyDecorrelateNodeProcess(NoisyDecorrelateNode *self, float *buffer, size_t frameCount);
+
+
 #pragma mark - Gain
 
 typedef struct NoisyGainNode NoisyGainNode;
@@ -45,12 +94,14 @@ extern void NoisyGainNodeProcess(NoisyGainNode *self, float *buffer, size_t fram
 typedef enum NoisyGeneratorType {
     NoisyGeneratorTypeUniform,
     NoisyGeneratorTypeGaussian,
-    NoisyGeneratorTypeBrownian
+    NoisyGeneratorTypeBrownian,
+    NoisyGeneratorTypeVelvet
 } NoisyGeneratorType;
 
 typedef struct NoisyGeneratorNode NoisyGeneratorNode;
 
-extern NoisyGeneratorNode *NoisyGeneratorNodeCreate(NoisyGeneratorType type, uint64_t randomSeed);
+// density is normalized (pulses per frame) and only used by NoisyGeneratorTypeVelvet
+extern NoisyGeneratorNode *NoisyGeneratorNodeCreate(NoisyGeneratorType type, double density, uint64_t randomSeed);
 extern void NoisyGeneratorNodeFree(NoisyGeneratorNode *self);
 extern void NoisyGeneratorNodeProcess(NoisyGeneratorNode *self, float *buffer, size_t frameCount);
 
@@ -79,16 +130,35 @@ extern void NoisyOnePoleNodeProcess(NoisyOnePoleNode *self, float *buffer, size_
 typedef enum NoisyPinkingType {
     NoisyPinkingTypePK3,
     NoisyPinkingTypePKE,
-    NoisyPinkingTypeRBJ
+    NoisyPinkingTypeRBJ,
+    NoisyPinkingTypeVoss
 } NoisyPinkingType;
 
 typedef struct NoisyPinkingNode NoisyPinkingNode;
 
-extern NoisyPinkingNode *NoisyPinkingNodeCreate(NoisyPinkingType type);
+// randomSeed is only used by NoisyPinkingTypeVoss, which draws its rows from it
+extern NoisyPinkingNode *NoisyPinkingNodeCreate(NoisyPinkingType type, uint64_t randomSeed);
 extern void NoisyPinkingNodeFree(NoisyPinkingNode *self);
 extern void NoisyPinkingNodeProcess(NoisyPinkingNode *self, float *buffer, size_t frameCount);
 
 
+#pragma mark - Spectral
+
+typedef struct NoisySpectralNode NoisySpectralNode;
+
+// frequencies are normalized (frequency / sampleRate) and ascending, gains are in dB
+extern NoisySpectralNode *NoisySpectralNodeCreate(
+    const double *frequencies,
+    const double *gains,
+    size_t pointCount,
+    size_t log2FFTSize
+);
+
+extern void NoisySpectralNodeFree(NoisySpectralNode *self);
+extern void NoisySpectralNodeProcess(NoisySpectralNode *self, float *buffer, size_t frameCount);
+extern size_t NoisySpectralNodeGetLatency(NoisySpectralNode *self);
+
+
 #pragma mark - Split
 
 typedef struct NoisySplitNode NoisySplitNode;
@@ -108,4 +178,84 @@ extern void NoisyZeroNodeFree(NoisyZeroNode *self);
 extern void NoisyZeroNodeProcess(NoisyZeroNode *self, float *buffer, size_t frameCount);
 
 
+#pragma mark - Modulation
+
+/*
+    Gain, OnePole, and Biquads nodes (see NoisyBiquadsNodeCreateWithDesigns()) may
+    have modulators. Once per NoisyModulationBlockFrameCount frames, the node steps
+    its modulators, recomputes the modulated parameters, and moves towards them over
+    the block. Gains and one-pole coefficients are interpolated per frame. Biquad
+    coefficients are ramped by BiquadCascadeSetCoefficients().
+
+    Each modulator's value is scaled by depth and added to the parameter: in dB for
+    gains, and in octaves for frequencies and Q. Modulated nodes cannot be batched.
+*/
+typedef enum NoisyModulationParameter {
+    NoisyModulationParameterGain,
+    NoisyModulationParameterFrequency,
+    NoisyModulationParameterQ
+} NoisyModulationParameter;
+
+enum {
+    NoisyModulationBlockFrameCount = 128
+};
+
+// Takes ownership of modulator. section is only used by Biquads nodes.
+// Returns false, and frees modulator, if the node doesn't have the parameter.
+extern bool NoisyNodeAddModulator(
+    NoisyNodeRef self,
+    Modulator *modulator,
+    NoisyModulationParameter parameter,
+    size_t section,
+    double depth
+);
+
+
+#pragma mark - Flat List
+
+/*
+    Lowers a node list (including nested split nodes) into a flat instruction
+    array with switch dispatch. The node list still owns its nodes and must
+    outlive the flat list. Returns NULL for a NULL list, or if the list cannot
+    be lowered (in which case, render the node list itself).
+
+    Split nodes with at least two branches costing NoisyFlatListParallelMinimumCost
+    or more run their branches as tasks on the worker pool, if one is set.
+    Smaller graphs, and renders shorter than NoisyFlatListParallelMinimumFrameCount,
+    stay serial. Results are identical either way.
+*/
+typedef struct NoisyFlatList NoisyFlatList;
+
+// Costs are estimated per frame, in units of roughly one biquad section
+enum {
+    NoisyFlatListParallelMinimumCost = 32,
+    NoisyFlatListParallelMinimumFrameCount = 128
+};
+
+extern NoisyFlatList *NoisyFlatListCreate(NoisyNodeList *nodeList);
+extern void NoisyFlatListFree(NoisyFlatList *self);
+extern void NoisyFlatListProcess(NoisyFlatList *self, float *buffer, size_t frameCount);
+
+extern double NoisyFlatListGetCost(NoisyFlatList *self);
+
+// Must not be called while the list is processing. Pass NULL to run serially.
+extern void NoisyFlatListSetWorkerPool(NoisyFlatList *self, WorkerPool *workerPool);
+
+
+#pragma mark - Batch
+
+/*
+    Runs one node list per lane using a lane-interleaved buffer:
+    buffer[(frame * laneCount) + lane]
+
+    All lists must have the same topology and parameters (only the random
+    seeds and filter states may differ), otherwise NULL is returned.
+*/
+typedef struct NoisyBatchList NoisyBatchList;
+
+extern NoisyBatchList *NoisyBatchListCreate(NoisyNodeList **nodeLists, size_t laneCount);
+extern void NoisyBatchListFree(NoisyBatchList *self);
+extern void NoisyBatchListProcess(NoisyBatchList *self, float *buffer, size_t frameCount);
+
+
 #endif
@@ -8,11 +8,22 @@
 
 typedef struct NoisyProgram NoisyProgram;
 typedef struct NoisyNodeList NoisyNodeList;
+typedef struct WorkerPool WorkerPool;
 
+/*
+    May be called from any thread. isCancelled (which may be nil) is checked
+    while compiling the preset and while priming the nodes. Once it returns
+    YES, creation stops and fails with NSUserCancelledError.
+
+    NoisyProgramFree() may also be called from any thread. It saves the
+    settled auto gain to the preset's snapshot asynchronously, on a serial
+    queue.
+*/
 extern NoisyProgram *NoisyProgramCreate(
     Preset *preset,
     size_t channelCount,
     double sampleRate,
+    BOOL (^isCancelled)(void),
     NSError **outError
 );
 
@@ -20,6 +31,51 @@ extern void NoisyProgramFree(NoisyProgram *self);
 
 extern void NoisyProgramProcess(NoisyProgram *self, float *left, float *right, size_t frameCount);
 
-extern void NoisyProgramGetAutoGain(NoisyProgram *self, float *outLeft, float *outRight);
+// Lets NoisyProgramProcess() run expensive split branches, and the left and right
+// channel lists, on the pool's threads. Call before the program is handed to the
+// render thread. The pool must outlive the program. Pass NULL to run serially.
+extern void NoisyProgramSetWorkerPool(NoisyProgram *self, WorkerPool *workerPool);
+
+// Call before the program is handed to the render thread. Nodes then skip work that
+// their worker threads have not finished in time, rather than wait for it. Off for
+// priming and exporting, which must be exact.
+extern void NoisyProgramSetRealTime(NoisyProgram *self, BOOL realTime);
+
+// Measures the program's output and applies its loudness-based auto gain in place.
+// right is ignored for mono programs; copy left to right afterwards.
+extern void NoisyProgramApplyAutoGain(NoisyProgram *self, float *left, float *right, size_t frameCount);
+
+// Returns the current auto gain. Returns YES once it has settled.
+extern BOOL NoisyProgramGetAutoGain(NoisyProgram *self, float *outLeft, float *outRight);
 
 extern size_t NoisyProgramGetChannelCount(NoisyProgram *self);
+
+// The delay, in frames, introduced by the program's nodes. Programs are primed
+// during creation, so this only describes the alignment of the output.
+extern size_t NoisyProgramGetLatency(NoisyProgram *self);
+
+
+/*
+    A NoisyProgramBatch renders several programs built from the same preset, channel count,
+    and sample rate in a single call. Node states are stored struct-of-arrays with one
+    lane per program (see NoisyBatchList). Each lane keeps its own random seed, auto gain
+    (fixed at the source program's current gain), volume, and fade ramp.
+
+    The source programs are only read during creation and may be freed afterwards.
+    Returns NULL if the programs do not share the same topology.
+
+    Lanes start paused; use NoisyProgramBatchSetPlaying() to fade them in.
+*/
+typedef struct NoisyProgramBatch NoisyProgramBatch;
+
+extern NoisyProgramBatch *NoisyProgramBatchCreate(NoisyProgram **programs, size_t programCount);
+
+extern void NoisyProgramBatchFree(NoisyProgramBatch *self);
+
+extern size_t NoisyProgramBatchGetCount(NoisyProgramBatch *self);
+
+extern void NoisyProgramBatchSetVolume(NoisyProgramBatch *self, size_t index, float volume);
+extern void NoisyProgramBatchSetPlaying(NoisyProgramBatch *self, size_t index, BOOL playing, size_t frameDuration);
+
+// outLeft and outRight are arrays of programCount channel buffers, each with room for frameCount samples
+extern void NoisyProgramBatchProcess(NoisyProgramBatch *self, float **outLeft, float **outRight, size_t frameCount);
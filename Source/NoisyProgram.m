@@ -3,10 +3,11 @@
 
 #import "NoisyProgram.h"
 
-#import "Biquad.h"
+#import "AutoGain.h"
+#import "CompiledPreset.h"
 #import "Preset.h"
 #import "NoisyNode.h"
-#import "ProgramBuilder.h"
+#import "Ramper.h"
 
 @import Accelerate;
 
@@ -16,81 +17,177 @@ typedef struct NoisyProgram {
     size_t channelCount;
     double sampleRate;
 
-    float autoGainLevel;
-    BOOL  isAutoGainSeparate;
-    float leftAutoGain;
-    float rightAutoGain;
+    AutoGain *autoGain;
+
+    // Retained, to store the settled auto gain when the program is freed
+    CFTypeRef preset;
+    CFTypeRef compiledPreset;
+
+    size_t latency;
 
     NoisyNodeList *headNodeList;
     NoisyNodeList *leftNodeList;
     NoisyNodeList *rightNodeList;
+
+    // Flattened copies of the node lists above, used for rendering when not NULL
+    NoisyFlatList *headFlatList;
+    NoisyFlatList *leftFlatList;
+    NoisyFlatList *rightFlatList;
+
+    // Set by NoisyProgramSetWorkerPool()
+    WorkerPool *workerPool;
+    BOOL parallelChannels;
 } NoisyProgram;
 
 
+typedef struct NoisyProgramChannelTask {
+    NoisyProgram *program;
+    float *left;
+    float *right;
+    size_t frameCount;
+} NoisyProgramChannelTask;
+
+
+// Frames rendered between cancellation checks while priming
+static const size_t sPrimeChunkFrameCount = 4096;
+
+
 #pragma mark - Private Functions
 
+// A flat list is NULL if its node list is, or if lowering failed. In the latter case,
+// the node list renders directly.
+static void sProcessList(NoisyFlatList *flatList, NoisyNodeList *nodeList, float *buffer, size_t frameCount)
+{
+    if (flatList) {
+        NoisyFlatListProcess(flatList, buffer, frameCount);
+    } else {
+        NoisyNodeListProcess(nodeList, buffer, frameCount);
+    }
+}
 
 
-static NoisyProgram *sCreateProgram(ProgramBuilder *builder)
+static void sProcessChannel(void *context, size_t index)
 {
-    NoisyProgram *self = calloc(1, sizeof(NoisyProgram));
+    NoisyProgramChannelTask *task = context;
+    NoisyProgram *program = task->program;
 
-    self->channelCount  = [builder channelCount];
-    self->sampleRate    = [builder sampleRate];
-    
-    [builder transferHeadNodeList: &self->headNodeList
-                     leftNodeList: &self->leftNodeList
-                    rightNodeList: &self->rightNodeList];
+    if (index == 0) {
+        sProcessList(program->leftFlatList, program->leftNodeList, task->left, task->frameCount);
+    } else {
+        sProcessList(program->rightFlatList, program->rightNodeList, task->right, task->frameCount);
+    }
+}
 
-    return self;
+
+// Snapshots are written here, so that freeing a program never waits on the disk
+static dispatch_queue_t sGetSnapshotQueue(void)
+{
+    static dispatch_queue_t sQueue;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        sQueue = dispatch_queue_create("NoisyProgram.snapshot", attr);
+    });
+
+    return sQueue;
 }
 
 
-static void sComputeAutoGain(ProgramBuilder *builder, float *outLeft, float *outRight)
+static void sSaveAutoGain(Preset *preset, CompiledPreset *compiledPreset, float leftAutoGain, float rightAutoGain)
 {
-    NoisyProgram *program = sCreateProgram(builder);
+    dispatch_async(sGetSnapshotQueue(), ^{
+        float previousLeftAutoGain, previousRightAutoGain;
+        BOOL hasPrevious = [compiledPreset getComputedAutoGainLeft:&previousLeftAutoGain right:&previousRightAutoGain];
+
+        // Only rewrite the snapshot for changes of more than 0.1 dB
+        if (
+            !hasPrevious ||
+            fabsf(20.0f * log10f(leftAutoGain  / previousLeftAutoGain))  > 0.1f ||
+            fabsf(20.0f * log10f(rightAutoGain / previousRightAutoGain)) > 0.1f
+        ) {
+            [compiledPreset setComputedAutoGainLeft:leftAutoGain right:rightAutoGain];
+            [preset writeSnapshot];
+        }
+    });
+}
+
+
+static NSError *sMakeCancelledError(void)
+{
+    return [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+}
+
+
 
-    double targetLevel = [builder autoGainLevel];
+static NoisyProgram *sCreateProgram(
+    CompiledPreset *compiledPreset,
+    size_t channelCount,
+    double sampleRate,
+    BOOL (^isCancelled)(void),
+    NSError **outError
+) {
+    NoisyNodeList *headNodeList, *leftNodeList, *rightNodeList;
 
-    // Approximately 6 seconds of audio at 44.1Khz
-    size_t samplesToGenerate = 256 * 1024;
+    BOOL success = [compiledPreset makeHeadNodeList: &headNodeList
+                                       leftNodeList: &leftNodeList
+                                      rightNodeList: &rightNodeList
+                                       channelCount: channelCount
+                                         sampleRate: sampleRate
+                                              error: outError];
 
-    float *left   = malloc(sizeof(float) * samplesToGenerate);
-    float *right  = malloc(sizeof(float) * samplesToGenerate);
+    if (!success) return NULL;
 
-    NoisyProgramProcess(program, left, right, samplesToGenerate);
-    
-    float leftMinValue, leftMaxValue;
-    vDSP_minv(left,  1, &leftMinValue,  samplesToGenerate);
-    vDSP_maxv(left,  1, &leftMaxValue,  samplesToGenerate);
-    if (-leftMinValue > leftMaxValue) leftMaxValue = -leftMinValue;
+    NoisyProgram *self = calloc(1, sizeof(NoisyProgram));
 
-    float rightMinValue, rightMaxValue;
-    vDSP_minv(right, 1, &rightMinValue, samplesToGenerate);
-    vDSP_maxv(right, 1, &rightMaxValue, samplesToGenerate);
-    if (-rightMinValue > rightMaxValue) rightMaxValue = -rightMinValue;
+    self->channelCount  = channelCount;
+    self->sampleRate    = sampleRate;
 
-    free(left);
-    free(right);
-    NoisyProgramFree(program);
+    self->headNodeList  = headNodeList;
+    self->leftNodeList  = leftNodeList;
+    self->rightNodeList = rightNodeList;
 
-    double targetValue = pow(10.0, targetLevel / 20.0);
-    
+    self->headFlatList  = NoisyFlatListCreate(self->headNodeList);
+    self->leftFlatList  = NoisyFlatListCreate(self->leftNodeList);
+    self->rightFlatList = NoisyFlatListCreate(self->rightNodeList);
 
-    if ([builder isAutoGainSeparate]) {
-        NSLog(@"Auto gain left max value:  %lf dBFS", (double)(20.0 * log10(leftMaxValue)));
-        NSLog(@"Auto gain right max value: %lf dBFS", (double)(20.0 * log10(rightMaxValue)));
-        
-        *outLeft  = targetValue / leftMaxValue;
-        *outRight = targetValue / rightMaxValue;
-    } else {
-        float maxValue = MAX(leftMaxValue, rightMaxValue);
+    self->latency = NoisyNodeGetLatency(self->headNodeList) + MAX(
+        NoisyNodeGetLatency(self->leftNodeList),
+        NoisyNodeGetLatency(self->rightNodeList)
+    );
+
+    // Prime nodes with latency (such as spectral nodes) so that output starts immediately
+    if (self->latency > 0) {
+        size_t chunkFrameCount = MIN(self->latency, sPrimeChunkFrameCount);
+
+        float *left  = malloc(sizeof(float) * chunkFrameCount);
+        float *right = malloc(sizeof(float) * chunkFrameCount);
 
-        NSLog(@"Auto gain max value: %lf dBFS", (double)(20.0 * log10(maxValue)));
+        size_t framesRemaining = self->latency;
+        BOOL cancelled = NO;
 
-        *outLeft  = targetValue / maxValue;
-        *outRight = targetValue / maxValue;
+        while (framesRemaining > 0) {
+            if (isCancelled && isCancelled()) {
+                cancelled = YES;
+                break;
+            }
+
+            size_t frameCount = MIN(framesRemaining, chunkFrameCount);
+            NoisyProgramProcess(self, left, right, frameCount);
+            framesRemaining -= frameCount;
+        }
+
+        free(left);
+        free(right);
+
+        if (cancelled) {
+            NoisyProgramFree(self);
+            if (outError) *outError = sMakeCancelledError();
+            return NULL;
+        }
     }
+
+    return self;
 }
 
 
@@ -100,6 +197,7 @@ NoisyProgram *NoisyProgramCreate(
     Preset *preset,
     size_t channelCount,
     double sampleRate,
+    BOOL (^isCancelled)(void),
     NSError **outError
 ) {
     if ([preset error]) {
@@ -107,30 +205,34 @@ NoisyProgram *NoisyProgramCreate(
         return NULL;
     }
 
-    ProgramBuilder *selfBuilder = [[ProgramBuilder alloc] initWithPreset: preset
-                                                            channelCount: channelCount
-                                                              sampleRate: sampleRate
-                                                             forAutoGain: NO];
+    // Parsed once per preset revision, or loaded from a snapshot
+    CompiledPreset *compiledPreset = [preset compiledPresetWithCancelCheck:isCancelled error:outError];
+    if (!compiledPreset) return NULL;
 
-    if ([selfBuilder error]) {
-        if (outError) *outError = [selfBuilder error];
+    if (isCancelled && isCancelled()) {
+        if (outError) *outError = sMakeCancelledError();
         return NULL;
     }
 
-    // For Auto Gain, we always use stereo with a sample rate of 44100.0
-    ProgramBuilder *autoGainBuilder = [[ProgramBuilder alloc] initWithPreset: preset
-                                                                channelCount: 2
-                                                                  sampleRate: 44100
-                                                                 forAutoGain: YES];
-
-    if ([autoGainBuilder error]) {
-        if (outError) *outError = [autoGainBuilder error];
-        return NULL;
+    NoisyProgram *self = sCreateProgram(compiledPreset, channelCount, sampleRate, isCancelled, outError);
+    if (!self) return NULL;
+
+    self->autoGain = AutoGainCreate(
+        sampleRate,
+        channelCount,
+        [compiledPreset autoGainLoudness],
+        [compiledPreset autoGainLevel],
+        [compiledPreset isAutoGainSeparate]
+    );
+
+    // Start where the previous program of this revision settled
+    float leftAutoGain, rightAutoGain;
+    if ([compiledPreset getComputedAutoGainLeft:&leftAutoGain right:&rightAutoGain]) {
+        AutoGainSetSettledGain(self->autoGain, leftAutoGain, rightAutoGain);
     }
 
-    NoisyProgram *self = sCreateProgram(selfBuilder);
-
-    sComputeAutoGain(autoGainBuilder, &self->leftAutoGain, &self->rightAutoGain);
+    self->preset         = CFBridgingRetain(preset);
+    self->compiledPreset = CFBridgingRetain(compiledPreset);
 
     return self;
 }
@@ -140,6 +242,23 @@ void NoisyProgramFree(NoisyProgram *self)
 {
     if (!self) return;
 
+    if (self->compiledPreset) {
+        Preset *preset = CFBridgingRelease(self->preset);
+        CompiledPreset *compiledPreset = CFBridgingRelease(self->compiledPreset);
+
+        float leftAutoGain, rightAutoGain;
+
+        if (AutoGainGetGain(self->autoGain, &leftAutoGain, &rightAutoGain)) {
+            sSaveAutoGain(preset, compiledPreset, leftAutoGain, rightAutoGain);
+        }
+    }
+
+    AutoGainFree(self->autoGain);
+
+    NoisyFlatListFree(self->headFlatList);
+    NoisyFlatListFree(self->leftFlatList);
+    NoisyFlatListFree(self->rightFlatList);
+
     NoisyNodeFree(self->headNodeList);
     NoisyNodeFree(self->leftNodeList);
     NoisyNodeFree(self->rightNodeList);
@@ -150,18 +269,54 @@ void NoisyProgramFree(NoisyProgram *self)
 
 void NoisyProgramProcess(NoisyProgram *self, float *left, float *right, size_t frameCount)
 {
-    NoisyNodeListProcess(self->headNodeList, left, frameCount);
+    sProcessList(self->headFlatList, self->headNodeList, left, frameCount);
 
     memcpy(right, left, sizeof(float) * frameCount);
 
-    NoisyNodeListProcess(self->leftNodeList, left, frameCount);
-    NoisyNodeListProcess(self->rightNodeList, right, frameCount);
+    if (self->parallelChannels && frameCount >= NoisyFlatListParallelMinimumFrameCount) {
+        NoisyProgramChannelTask task = { self, left, right, frameCount };
+        WorkerPoolRun(self->workerPool, sProcessChannel, &task, 2);
+
+    } else {
+        sProcessList(self->leftFlatList,  self->leftNodeList,  left,  frameCount);
+        sProcessList(self->rightFlatList, self->rightNodeList, right, frameCount);
+    }
+}
+
+
+void NoisyProgramSetWorkerPool(NoisyProgram *self, WorkerPool *workerPool)
+{
+    self->workerPool = workerPool;
+
+    NoisyFlatListSetWorkerPool(self->headFlatList,  workerPool);
+    NoisyFlatListSetWorkerPool(self->leftFlatList,  workerPool);
+    NoisyFlatListSetWorkerPool(self->rightFlatList, workerPool);
+
+    // Only worth a handoff when both channel lists have real work
+    self->parallelChannels = workerPool &&
+        NoisyFlatListGetCost(self->leftFlatList)  >= NoisyFlatListParallelMinimumCost &&
+        NoisyFlatListGetCost(self->rightFlatList) >= NoisyFlatListParallelMinimumCost;
+}
+
+
+void NoisyProgramSetRealTime(NoisyProgram *self, BOOL realTime)
+{
+    // The flat lists share their nodes with the node lists
+    NoisyNodeSetRealTime(self->headNodeList,  realTime);
+    NoisyNodeSetRealTime(self->leftNodeList,  realTime);
+    NoisyNodeSetRealTime(self->rightNodeList, realTime);
+}
+
+
+void NoisyProgramApplyAutoGain(NoisyProgram *self, float *left, float *right, size_t frameCount)
+{
+    AutoGainProcess(self->autoGain, left, self->channelCount > 1 ? right : NULL, frameCount);
 }
 
-void NoisyProgramGetAutoGain(NoisyProgram *self, float *outLeft, float *outRight)
+
+BOOL NoisyProgramGetAutoGain(NoisyProgram *self, float *outLeft, float *outRight)
 {
-    *outLeft  = self->leftAutoGain;
-    *outRight = self->rightAutoGain;
+    return AutoGainGetGain(self->autoGain, outLeft, outRight);
 }
 
 
@@ -170,3 +325,198 @@ extern size_t NoisyProgramGetChannelCount(NoisyProgram *self)
     return self->channelCount;
 }
 
+
+size_t NoisyProgramGetLatency(NoisyProgram *self)
+{
+    return self->latency;
+}
+
+
+#pragma mark - Batch
+
+static const size_t sBatchMaxFrames = 256;
+
+typedef struct NoisyProgramBatch {
+    size_t count;
+    size_t channelCount;
+
+    NoisyBatchList *headList;
+    NoisyBatchList *leftList;
+    NoisyBatchList *rightList;
+
+    float *leftBuffer;
+    float *rightBuffer;
+
+    float *leftGains;
+    float *rightGains;
+    float *volumes;
+
+    Ramper **rampers;
+} NoisyProgramBatch;
+
+
+NoisyProgramBatch *NoisyProgramBatchCreate(NoisyProgram **programs, size_t programCount)
+{
+    if (programCount == 0) return NULL;
+
+    NoisyProgram *first = programs[0];
+
+    for (size_t i = 0; i < programCount; i++) {
+        NoisyProgram *program = programs[i];
+
+        if (
+            (program->channelCount != first->channelCount) ||
+            (program->sampleRate   != first->sampleRate)   ||
+            (!program->headNodeList  != !first->headNodeList)  ||
+            (!program->leftNodeList  != !first->leftNodeList)  ||
+            (!program->rightNodeList != !first->rightNodeList)
+        ) {
+            return NULL;
+        }
+    }
+
+    NoisyNodeList **lists = malloc(sizeof(NoisyNodeList *) * programCount);
+
+    __auto_type makeBatchList = ^(NoisyNodeList *(^getList)(NoisyProgram *)) {
+        if (!getList(first)) return (NoisyBatchList *)NULL;
+
+        for (size_t i = 0; i < programCount; i++) {
+            lists[i] = getList(programs[i]);
+        }
+
+        return NoisyBatchListCreate(lists, programCount);
+    };
+
+    NoisyBatchList *headList  = makeBatchList(^(NoisyProgram *p) { return p->headNodeList;  });
+    NoisyBatchList *leftList  = makeBatchList(^(NoisyProgram *p) { return p->leftNodeList;  });
+    NoisyBatchList *rightList = makeBatchList(^(NoisyProgram *p) { return p->rightNodeList; });
+
+    free(lists);
+
+    if (
+        (!headList  && first->headNodeList)  ||
+        (!leftList  && first->leftNodeList)  ||
+        (!rightList && first->rightNodeList)
+    ) {
+        NoisyBatchListFree(headList);
+        NoisyBatchListFree(leftList);
+        NoisyBatchListFree(rightList);
+
+        return NULL;
+    }
+
+    NoisyProgramBatch *self = calloc(1, sizeof(NoisyProgramBatch));
+
+    self->count        = programCount;
+    self->channelCount = first->channelCount;
+
+    self->headList  = headList;
+    self->leftList  = leftList;
+    self->rightList = rightList;
+
+    self->leftBuffer  = malloc(sizeof(float) * sBatchMaxFrames * programCount);
+    self->rightBuffer = malloc(sizeof(float) * sBatchMaxFrames * programCount);
+
+    self->leftGains  = malloc(sizeof(float) * programCount);
+    self->rightGains = malloc(sizeof(float) * programCount);
+    self->volumes    = malloc(sizeof(float) * programCount);
+    self->rampers    = malloc(sizeof(Ramper *) * programCount);
+
+    for (size_t i = 0; i < programCount; i++) {
+        NoisyProgramGetAutoGain(programs[i], &self->leftGains[i], &self->rightGains[i]);
+        self->volumes[i]    = 1.0;
+
+        self->rampers[i] = RamperCreate();
+    }
+
+    return self;
+}
+
+
+void NoisyProgramBatchFree(NoisyProgramBatch *self)
+{
+    if (!self) return;
+
+    NoisyBatchListFree(self->headList);
+    NoisyBatchListFree(self->leftList);
+    NoisyBatchListFree(self->rightList);
+
+    for (size_t i = 0; i < self->count; i++) {
+        RamperFree(self->rampers[i]);
+    }
+
+    free(self->leftBuffer);
+    free(self->rightBuffer);
+    free(self->leftGains);
+    free(self->rightGains);
+    free(self->volumes);
+    free(self->rampers);
+
+    free(self);
+}
+
+
+size_t NoisyProgramBatchGetCount(NoisyProgramBatch *self)
+{
+    return self->count;
+}
+
+
+void NoisyProgramBatchSetVolume(NoisyProgramBatch *self, size_t index, float volume)
+{
+    if (index < self->count) {
+        self->volumes[index] = volume;
+    }
+}
+
+
+void NoisyProgramBatchSetPlaying(NoisyProgramBatch *self, size_t index, BOOL playing, size_t frameDuration)
+{
+    if (index < self->count) {
+        RamperUpdate(self->rampers[index], playing, frameDuration);
+    }
+}
+
+
+void NoisyProgramBatchProcess(NoisyProgramBatch *self, float **outLeft, float **outRight, size_t inFrameCount)
+{
+    size_t count = self->count;
+    size_t offset = 0;
+
+    while (offset < inFrameCount) {
+        size_t frameCount = MIN(inFrameCount - offset, sBatchMaxFrames);
+        
+        float *left  = self->leftBuffer;
+        float *right = self->rightBuffer;
+
+        // Same structure as NoisyProgramProcess(), with every buffer holding all lanes
+        NoisyBatchListProcess(self->headList, left, frameCount);
+
+        memcpy(right, left, sizeof(float) * frameCount * count);
+
+        NoisyBatchListProcess(self->leftList,  left,  frameCount);
+        NoisyBatchListProcess(self->rightList, right, frameCount);
+
+        // De-interleave each lane into its output, then apply its ramp and gain
+        for (size_t i = 0; i < count; i++) {
+            float *laneLeft  = outLeft[i]  + offset;
+            float *laneRight = outRight ? outRight[i] + offset : NULL;
+
+            float leftVolume  = self->volumes[i] * self->leftGains[i];
+            float rightVolume = self->volumes[i] * self->rightGains[i];
+
+            if (self->channelCount == 1) {
+                vDSP_vsmul(left + i, count, &leftVolume, laneLeft, 1, frameCount);
+                RamperProcess(self->rampers[i], laneLeft, NULL, frameCount);
+                if (laneRight) memcpy(laneRight, laneLeft, sizeof(float) * frameCount);
+
+            } else {
+                vDSP_vsmul(left + i, count, &leftVolume, laneLeft, 1, frameCount);
+                if (laneRight) vDSP_vsmul(right + i, count, &rightVolume, laneRight, 1, frameCount);
+                RamperProcess(self->rampers[i], laneLeft, laneRight, frameCount);
+            }
+        }
+
+        offset += frameCount;
+    }
+}
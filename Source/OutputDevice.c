@@ -0,0 +1,405 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "OutputDevice.h"
+#include "FloatingPoint.h"
+#include "WavWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/mman.h>
+
+static const size_t sPrefaultStackSize = 256 * 1024;
+
+
+typedef struct OutputDevice {
+    OutputDeviceOptions options;
+    char *path;
+
+    OutputDeviceRenderCallback render;
+    void *context;
+
+    float *left;
+    float *right;
+
+    WavWriter *writer;
+
+    pthread_t thread;
+    bool threadActive;
+    _Atomic(bool) quit;
+
+    double startTime;
+    double stopTime;
+
+    // Only written by the render thread
+    _Atomic(uint64_t) framesRendered;
+    _Atomic(uint64_t) periods;
+    _Atomic(uint64_t) deadlineMisses;
+    _Atomic(uint64_t) skippedPeriods;
+    _Atomic(double)   wakeLatencySum;
+    _Atomic(double)   wakeLatencySumOfSquares;
+    _Atomic(double)   maxWakeLatency;
+    _Atomic(double)   renderTimeSum;
+    _Atomic(double)   maxRenderTime;
+    _Atomic(double)   cpuTime;
+    _Atomic(bool)     realTime;
+    _Atomic(bool)     pinned;
+
+    bool memoryLocked;
+} OutputDevice;
+
+
+#pragma mark - Time
+
+static double sGetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+static double sGetThreadCPUTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+static void sSleepUntil(double time)
+{
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec  = (time_t)time;
+    ts.tv_nsec = (long)((time - ts.tv_sec) * 1e9);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+
+#else
+    double delta = time - sGetTime();
+    if (delta <= 0) return;
+
+    struct timespec ts;
+    ts.tv_sec  = (time_t)delta;
+    ts.tv_nsec = (long)((delta - ts.tv_sec) * 1e9);
+
+    nanosleep(&ts, NULL);
+#endif
+}
+
+
+#pragma mark - Stats
+
+// Stats have a single writer, so a relaxed load and store is enough
+
+static void sAddCount(_Atomic(uint64_t) *count, uint64_t value)
+{
+    atomic_store_explicit(count, atomic_load_explicit(count, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+
+static void sAddTime(_Atomic(double) *sum, _Atomic(double) *max, double value)
+{
+    atomic_store_explicit(sum, atomic_load_explicit(sum, memory_order_relaxed) + value, memory_order_relaxed);
+
+    if (max && value > atomic_load_explicit(max, memory_order_relaxed)) {
+        atomic_store_explicit(max, value, memory_order_relaxed);
+    }
+}
+
+
+#pragma mark - Render Thread
+
+static void sConfigureThread(OutputDevice *self)
+{
+    // The thread exits when rendering ends, so the previous state is never restored
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+
+#if defined(__linux__)
+    if (self->options.cpu >= 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(self->options.cpu % CPU_SETSIZE, &cpuSet);
+
+        atomic_store(&self->pinned, pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0);
+    }
+#endif
+
+    if (self->options.priority > 0) {
+        struct sched_param param = { .sched_priority = self->options.priority };
+        atomic_store(&self->realTime, pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0);
+    }
+}
+
+
+// Touches the pages of a large stack frame so that later calls do not fault
+__attribute__((noinline)) static void sPrefaultStack(void)
+{
+    volatile uint8_t stack[sPrefaultStackSize];
+
+    for (size_t i = 0; i < sPrefaultStackSize; i += 4096) {
+        stack[i] = 0;
+    }
+
+    // Keeps the frame alive, as the stores alone are never read
+    __asm__ volatile("" : : "r"(stack) : "memory");
+}
+
+
+static size_t sGetNextFrameCount(OutputDevice *self)
+{
+    uint64_t limit = self->options.frameCount;
+    size_t periodFrameCount = self->options.periodFrameCount;
+
+    if (limit == 0) return periodFrameCount;
+
+    uint64_t remaining = limit - atomic_load_explicit(&self->framesRendered, memory_order_relaxed);
+    return remaining < periodFrameCount ? (size_t)remaining : periodFrameCount;
+}
+
+
+static void sRunNullSink(OutputDevice *self)
+{
+    double period = self->options.periodFrameCount / self->options.sampleRate;
+    double scheduled = sGetTime();
+
+    while (!atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+        size_t frameCount = sGetNextFrameCount(self);
+        if (frameCount == 0) break;
+
+        sSleepUntil(scheduled);
+
+        double wakeTime = sGetTime();
+        self->render(self->context, self->left, self->right, frameCount);
+        double endTime = sGetTime();
+
+        double wakeLatency = wakeTime - scheduled;
+
+        sAddTime(&self->wakeLatencySum, &self->maxWakeLatency, wakeLatency);
+        sAddTime(&self->wakeLatencySumOfSquares, NULL, wakeLatency * wakeLatency);
+        sAddTime(&self->renderTimeSum, &self->maxRenderTime, endTime - wakeTime);
+
+        sAddCount(&self->framesRendered, frameCount);
+        sAddCount(&self->periods, 1);
+
+        // The device starts playing this period at the next boundary
+        scheduled += period;
+
+        if (endTime > scheduled) {
+            uint64_t skipCount = (uint64_t)ceil((endTime - scheduled) / period);
+
+            sAddCount(&self->deadlineMisses, 1);
+            sAddCount(&self->skippedPeriods, skipCount);
+
+            scheduled += skipCount * period;
+        }
+    }
+}
+
+
+static void sRunFileSink(OutputDevice *self)
+{
+    float *left  = self->left;
+    float *right = self->right;
+
+    while (!atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+        size_t frameCount = sGetNextFrameCount(self);
+        if (frameCount == 0) break;
+
+        double startTime = sGetTime();
+        self->render(self->context, left, right, frameCount);
+        double endTime = sGetTime();
+
+        if (!WavWriterWrite(self->writer, left, right, frameCount)) break;
+
+        sAddTime(&self->renderTimeSum, &self->maxRenderTime, endTime - startTime);
+
+        sAddCount(&self->framesRendered, frameCount);
+        sAddCount(&self->periods, 1);
+    }
+}
+
+
+static void *sRenderThreadMain(void *context)
+{
+    OutputDevice *self = context;
+
+    sConfigureThread(self);
+
+    if (self->options.lockMemory) {
+        sPrefaultStack();
+    }
+
+    double cpuStartTime = sGetThreadCPUTime();
+
+    if (self->options.sink == OutputDeviceSinkFile) {
+        sRunFileSink(self);
+    } else {
+        sRunNullSink(self);
+    }
+
+    atomic_store(&self->cpuTime, sGetThreadCPUTime() - cpuStartTime);
+
+    return NULL;
+}
+
+
+#pragma mark - Public Functions
+
+OutputDevice *OutputDeviceCreate(
+    const OutputDeviceOptions *options,
+    OutputDeviceRenderCallback render,
+    void *context
+) {
+    if (!options || !render) return NULL;
+    if (options->periodFrameCount == 0 || options->sampleRate <= 0) return NULL;
+    if (options->sink == OutputDeviceSinkFile && !options->path) return NULL;
+
+    OutputDevice *self = calloc(1, sizeof(OutputDevice));
+
+    self->options = *options;
+    self->render  = render;
+    self->context = context;
+
+    size_t periodFrameCount = options->periodFrameCount;
+
+    self->left  = calloc(periodFrameCount, sizeof(float));
+    self->right = calloc(periodFrameCount, sizeof(float));
+
+    if (options->sink == OutputDeviceSinkFile) {
+        self->path = strdup(options->path);
+        self->options.path = self->path;
+
+        self->writer = WavWriterCreate(self->path, options->sampleRate, 2, WavWriterFormatFloat32, false);
+
+        if (!self->writer) {
+            OutputDeviceFree(self);
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+
+void OutputDeviceFree(OutputDevice *self)
+{
+    if (!self) return;
+
+    OutputDeviceStop(self);
+
+    if (self->memoryLocked) {
+        munlockall();
+    }
+
+    if (self->writer) {
+        WavWriterClose(self->writer);
+    }
+
+    free(self->path);
+
+    free(self->left);
+    free(self->right);
+
+    free(self);
+}
+
+
+void OutputDeviceStart(OutputDevice *self)
+{
+    if (self->threadActive) return;
+
+    atomic_store(&self->framesRendered,          0);
+    atomic_store(&self->periods,                 0);
+    atomic_store(&self->deadlineMisses,          0);
+    atomic_store(&self->skippedPeriods,          0);
+    atomic_store(&self->wakeLatencySum,          0);
+    atomic_store(&self->wakeLatencySumOfSquares, 0);
+    atomic_store(&self->maxWakeLatency,          0);
+    atomic_store(&self->renderTimeSum,           0);
+    atomic_store(&self->maxRenderTime,           0);
+    atomic_store(&self->cpuTime,                 0);
+    atomic_store(&self->realTime,                false);
+    atomic_store(&self->pinned,                  false);
+
+    // Locks and faults in everything mapped so far, including the render
+    // callback's state, plus anything mapped later
+    if (self->options.lockMemory && !self->memoryLocked) {
+        self->memoryLocked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+    }
+
+    atomic_store(&self->quit, false);
+
+    self->startTime = sGetTime();
+    self->stopTime  = 0;
+
+    pthread_create(&self->thread, NULL, sRenderThreadMain, self);
+    self->threadActive = true;
+}
+
+
+void OutputDeviceWait(OutputDevice *self)
+{
+    if (!self->threadActive) return;
+
+    pthread_join(self->thread, NULL);
+    self->threadActive = false;
+    self->stopTime = sGetTime();
+
+    if (self->writer) {
+        WavWriterFlush(self->writer);
+    }
+}
+
+
+void OutputDeviceStop(OutputDevice *self)
+{
+    atomic_store(&self->quit, true);
+    OutputDeviceWait(self);
+}
+
+
+void OutputDeviceGetStats(OutputDevice *self, OutputDeviceStats *outStats)
+{
+    uint64_t periods = atomic_load_explicit(&self->periods, memory_order_relaxed);
+    uint64_t framesRendered = atomic_load_explicit(&self->framesRendered, memory_order_relaxed);
+
+    double wakeLatencySum = atomic_load_explicit(&self->wakeLatencySum, memory_order_relaxed);
+    double wakeLatencySumOfSquares = atomic_load_explicit(&self->wakeLatencySumOfSquares, memory_order_relaxed);
+    double renderTimeSum = atomic_load_explicit(&self->renderTimeSum, memory_order_relaxed);
+
+    double meanWakeLatency = periods ? (wakeLatencySum / periods) : 0;
+    double wakeVariance    = periods ? ((wakeLatencySumOfSquares / periods) - (meanWakeLatency * meanWakeLatency)) : 0;
+    double audioTime       = framesRendered / self->options.sampleRate;
+
+    outStats->periods        = periods;
+    outStats->deadlineMisses = atomic_load_explicit(&self->deadlineMisses, memory_order_relaxed);
+    outStats->skippedPeriods = atomic_load_explicit(&self->skippedPeriods, memory_order_relaxed);
+
+    outStats->meanWakeLatency = meanWakeLatency;
+    outStats->maxWakeLatency  = atomic_load_explicit(&self->maxWakeLatency, memory_order_relaxed);
+    outStats->wakeJitter      = wakeVariance > 0 ? sqrt(wakeVariance) : 0;
+
+    outStats->meanRenderTime = periods ? (renderTimeSum / periods) : 0;
+    outStats->maxRenderTime  = atomic_load_explicit(&self->maxRenderTime, memory_order_relaxed);
+
+    outStats->cpuTime     = atomic_load_explicit(&self->cpuTime, memory_order_relaxed);
+    outStats->elapsedTime = (self->stopTime ? self->stopTime : sGetTime()) - self->startTime;
+    outStats->load        = audioTime > 0 ? (renderTimeSum / audioTime) : 0;
+
+    outStats->realTime     = atomic_load_explicit(&self->realTime, memory_order_relaxed);
+    outStats->pinned       = atomic_load_explicit(&self->pinned,   memory_order_relaxed);
+    outStats->memoryLocked = self->memoryLocked;
+}
@@ -0,0 +1,97 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _OUTPUT_DEVICE_H_
+#define _OUTPUT_DEVICE_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Portable real-time output layer, for running the engine without CoreAudio
+    (for example, on a headless Linux host).
+
+    A dedicated render thread calls the render callback once per period. The
+    thread optionally runs under SCHED_FIFO, is pinned to a CPU, and runs with
+    all memory locked. Every buffer is allocated up front; nothing in the
+    render loop allocates or locks.
+
+    Sinks:
+
+    Null: simulates a device at the given sample rate and period using an
+    absolute high-resolution timer. Each period's render must finish before
+    the following period boundary, otherwise it is counted as a deadline miss
+    and the simulated clock skips ahead, as a real device would.
+
+    File: writes a 32-bit float WAV file (RF64 past 4 GB) using WavWriter. The
+    render thread freewheels (renders as fast as possible), so only render time
+    and CPU time are meaningful.
+
+    The render callback has the same shape as NoisyProgramProcess(), which may be
+    passed directly (cast to OutputDeviceRenderCallback) along with its NoisyProgram.
+    Create the program before OutputDeviceStart() so that its memory is locked and
+    pre-faulted along with everything else.
+*/
+
+typedef struct OutputDevice OutputDevice;
+
+typedef void (*OutputDeviceRenderCallback)(void *context, float *left, float *right, size_t frameCount);
+
+typedef enum {
+    OutputDeviceSinkNull = 0,
+    OutputDeviceSinkFile = 1
+} OutputDeviceSink;
+
+typedef struct OutputDeviceOptions {
+    OutputDeviceSink sink;
+    double sampleRate;
+    size_t periodFrameCount;
+    uint64_t frameCount;  // Stop after this many frames, or 0 to run until OutputDeviceStop()
+    const char *path;     // File sink only
+
+    int priority;         // SCHED_FIFO priority, or 0 to keep the default policy
+    int cpu;              // CPU to pin the render thread to, or -1
+    bool lockMemory;      // mlockall() and pre-fault the render thread's stack
+} OutputDeviceOptions;
+
+typedef struct OutputDeviceStats {
+    uint64_t periods;
+    uint64_t deadlineMisses;  // Periods which finished rendering after the next period boundary
+    uint64_t skippedPeriods;  // Periods dropped to resynchronize after a miss
+
+    double meanWakeLatency;   // Seconds between a scheduled and an actual wakeup (null sink)
+    double maxWakeLatency;
+    double wakeJitter;        // Standard deviation of the wake latency
+
+    double meanRenderTime;    // Seconds per period spent in the render callback
+    double maxRenderTime;
+
+    double cpuTime;           // CPU seconds used by the render thread
+    double elapsedTime;       // Seconds since OutputDeviceStart()
+    double load;              // Render time divided by audio time
+
+    bool realTime;            // SCHED_FIFO was granted
+    bool pinned;              // CPU affinity was applied
+    bool memoryLocked;        // mlockall() succeeded
+} OutputDeviceStats;
+
+// Returns NULL if the options are invalid or the output file cannot be created
+extern OutputDevice *OutputDeviceCreate(
+    const OutputDeviceOptions *options,
+    OutputDeviceRenderCallback render,
+    void *context
+);
+
+// Stops the device and finalizes the output file
+extern void OutputDeviceFree(OutputDevice *self);
+
+extern void OutputDeviceStart(OutputDevice *self);
+extern void OutputDeviceStop(OutputDevice *self);
+
+// Blocks until the render thread has rendered options->frameCount frames, then stops
+extern void OutputDeviceWait(OutputDevice *self);
+
+extern void OutputDeviceGetStats(OutputDevice *self, OutputDeviceStats *outStats);
+
+#endif
@@ -4,14 +4,22 @@
 
 @import Foundation;
 
+@class CompiledPreset;
+
 @interface Preset : NSObject
 
 + (NSString *) identifierWithFileURL:(NSURL *)fileURL;
 
 - (instancetype) initWithFileURL:(NSURL *)fileURL enabled:(BOOL)enabled;
 
+// Reads the file, or its snapshot. Does not touch shared state, so a preset
+// which is not yet visible to other threads may be updated on any queue.
 - (void) updateWithModificationDate:(NSDate *)modificationDate;
 
+// Adopts the contents of another preset for the same file, such as one
+// updated on a background queue
+- (void) updateWithPreset:(Preset *)preset;
+
 @property (nonatomic, readonly) NSURL *fileURL;
 @property (nonatomic, readonly) NSDate *modificationDate;
 
@@ -24,5 +32,16 @@
 
 @property (nonatomic, getter=isEnabled) BOOL enabled;
 
+// Compiles the preset on first use and keeps the result until the file changes.
+// May be called from any thread.
+- (CompiledPreset *) compiledPresetWithError:(NSError **)outError;
+
+// As above, but stops early with NSUserCancelledError once isCancelled returns YES.
+// Cancelled builds are not cached.
+- (CompiledPreset *) compiledPresetWithCancelCheck:(BOOL (^)(void))isCancelled error:(NSError **)outError;
+
+// Saves the compiled preset so that the next launch can skip parsing the JSON
+- (void) writeSnapshot;
+
 
 @end
@@ -3,7 +3,9 @@
 
 #import "Preset.h"
 #import "Biquad.h"
+#import "CompiledPreset.h"
 #import "PresetManager.h"
+#import "ProgramBuilder.h"
 
 
 @interface PresetManager (FriendMethods)
@@ -11,7 +13,17 @@
 @end
 
 
-@implementation Preset
+/*
+    Programs are built on a background queue while the main thread may
+    update or read the same preset. The fields filled by -_readFile and
+    the compile cache are guarded by @synchronized(self). ProgramBuilder
+    runs outside of the lock, so reading the name does not wait on a build.
+*/
+@implementation Preset {
+    CompiledPreset *_compiledPreset;
+    NSError *_compileError;
+    BOOL _needsReadFile;
+}
 
 + (NSString *) identifierWithFileURL:(NSURL *)fileURL
 {
@@ -63,6 +75,8 @@
         }
     }
     
+    _needsReadFile = NO;
+
     NSString *name = getString(rootDictionary, @"name");
    
     if (!name) {
@@ -75,10 +89,164 @@
 }
 
 
+- (NSURL *) _snapshotURL
+{
+    static NSURL *sFolderURL = nil;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        NSString *name = [[[NSBundle mainBundle] infoDictionary] objectForKey:@"CFBundleExecutable"];
+        NSURL *cachesURL = [[[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+
+        if (name) cachesURL = [cachesURL URLByAppendingPathComponent:name];
+        sFolderURL = [cachesURL URLByAppendingPathComponent:@"Presets"];
+    });
+
+    return [sFolderURL URLByAppendingPathComponent:[_identifier stringByAppendingPathExtension:@"compiled"]];
+}
+
+
 - (void) updateWithModificationDate:(NSDate *)modificationDate
 {
     _modificationDate = modificationDate;
-    [self _readFile];
+
+    _compiledPreset = nil;
+    _compileError = nil;
+
+    // A snapshot from a previous launch means the JSON is only read if something asks for it
+    CompiledPreset *snapshot = [[CompiledPreset alloc] initWithContentsOfURL: [self _snapshotURL]
+                                                      sourceModificationDate: modificationDate];
+
+    if (snapshot) {
+        _compiledPreset = snapshot;
+        _name = [snapshot name];
+        _rootDictionary = nil;
+        _error = nil;
+        _needsReadFile = YES;
+    } else {
+        [self _readFile];
+    }
+}
+
+
+- (void) updateWithPreset:(Preset *)preset
+{
+    @synchronized (self) {
+        _modificationDate = preset->_modificationDate;
+
+        _compiledPreset = preset->_compiledPreset;
+        _compileError   = preset->_compileError;
+
+        _name           = preset->_name;
+        _rootDictionary = preset->_rootDictionary;
+        _error          = preset->_error;
+        _needsReadFile  = preset->_needsReadFile;
+    }
+}
+
+
+- (NSDate *) modificationDate
+{
+    @synchronized (self) {
+        return _modificationDate;
+    }
+}
+
+
+- (NSString *) name
+{
+    @synchronized (self) {
+        return _name;
+    }
+}
+
+
+- (NSDictionary *) rootDictionary
+{
+    @synchronized (self) {
+        if (_needsReadFile) [self _readFile];
+        return _rootDictionary;
+    }
+}
+
+
+- (NSError *) error
+{
+    @synchronized (self) {
+        return _error;
+    }
+}
+
+
+- (CompiledPreset *) compiledPresetWithError:(NSError **)outError
+{
+    return [self compiledPresetWithCancelCheck:nil error:outError];
+}
+
+
+- (CompiledPreset *) compiledPresetWithCancelCheck:(BOOL (^)(void))isCancelled error:(NSError **)outError
+{
+    NSDate *modificationDate;
+
+    @synchronized (self) {
+        if (!_compiledPreset && !_compileError && _error) {
+            _compileError = _error;
+        }
+
+        if (_compiledPreset || _compileError) {
+            if (outError) *outError = _compileError;
+            return _compiledPreset;
+        }
+
+        modificationDate = _modificationDate;
+    }
+
+    ProgramBuilder *builder = [[ProgramBuilder alloc] initWithPreset:self cancelCheck:isCancelled];
+
+    CompiledPreset *compiledPreset = [builder compiledPreset];
+    NSError *compileError = [builder error];
+
+    // A cancelled build says nothing about the preset, so it isn't cached
+    BOOL wasCancelled = [[compileError domain] isEqualToString:NSCocoaErrorDomain] &&
+                        [compileError code] == NSUserCancelledError;
+
+    @synchronized (self) {
+        BOOL isSameRevision = [_modificationDate isEqual:modificationDate];
+
+        if (!wasCancelled && isSameRevision && !_compiledPreset && !_compileError) {
+            _compiledPreset = compiledPreset;
+            _compileError   = compileError;
+        }
+    }
+
+    if (outError) *outError = compileError;
+    return compiledPreset;
+}
+
+
+- (void) writeSnapshot
+{
+    CompiledPreset *compiledPreset;
+    NSDate *modificationDate;
+
+    @synchronized (self) {
+        compiledPreset = _compiledPreset;
+        modificationDate = _modificationDate;
+    }
+
+    if (!compiledPreset) return;
+
+    NSURL *snapshotURL = [self _snapshotURL];
+    NSError *error = nil;
+
+    [[NSFileManager defaultManager] createDirectoryAtURL: [snapshotURL URLByDeletingLastPathComponent]
+                             withIntermediateDirectories: YES
+                                              attributes: nil
+                                                   error: NULL];
+
+    if (![compiledPreset writeToURL:snapshotURL sourceModificationDate:modificationDate error:&error]) {
+        NSLog(@"Could not write snapshot for '%@' - %@", _identifier, error);
+    }
 }
 
 
@@ -10,13 +10,24 @@
 
 static id sSharedInstance = nil;
 
+// FSEvents latency, plus the time that changes are collected for before indexing
+static CFTimeInterval sEventStreamLatency = 0.05;
+static NSTimeInterval sDebounceInterval   = 0.1;
+
 NSString * const PresetsDidChangeNotificationName = @"PresetsDidChangeNotification";
 NSString * const SelectedPresetDidChangeNotificationName = @"SelectedPresetDidChangeNotification";
 
 
 @implementation PresetManager {
     FSEventStreamRef _eventStream;
-    NSMutableDictionary *_identifierToPresetMap;
+    NSMutableDictionary<NSString *, Preset *> *_identifierToPresetMap;
+
+    // Serial queue for FSEvents callbacks and indexing, which owns the fields below
+    dispatch_queue_t _indexQueue;
+    NSMutableDictionary<NSString *, NSDate *> *_pathToModificationDateMap;
+    NSMutableSet<NSString *> *_pendingPaths;
+    BOOL _needsFullScan;
+    BOOL _flushScheduled;
 
     NSInteger _updateCount;
     BOOL _needsPresetsDidChangeNotification;
@@ -45,6 +56,10 @@ NSString * const SelectedPresetDidChangeNotificationName = @"SelectedPresetDidCh
         _allPresets = [NSArray array];
         _enabledPresets = [NSArray array];
 
+        _indexQueue = dispatch_queue_create("PresetManager.index", DISPATCH_QUEUE_SERIAL);
+        _pathToModificationDateMap = [NSMutableDictionary dictionary];
+        _pendingPaths = [NSMutableSet set];
+
         [self _setupPresetsFolder];
         [self _setupEventStream];
         [self _scanPresetsFolder];
@@ -110,9 +125,18 @@ NSString * const SelectedPresetDidChangeNotificationName = @"SelectedPresetDidCh
 }
 
 
+// FSEvents reports canonical paths, so symlinks (such as a relocated Library) must be resolved
+// for the full scan and the event paths to agree. Unresolved until the folder exists.
 - (NSString *) _presetsFolderPath
 {
-    return [[self _applicationSupportFolderPath] stringByAppendingPathComponent:@"Presets"];
+    NSString *path = [[self _applicationSupportFolderPath] stringByAppendingPathComponent:@"Presets"];
+    char resolvedPath[PATH_MAX];
+
+    if (realpath([path fileSystemRepresentation], resolvedPath)) {
+        path = [[NSFileManager defaultManager] stringWithFileSystemRepresentation:resolvedPath length:strlen(resolvedPath)];
+    }
+
+    return path;
 }
 
 
@@ -145,9 +169,20 @@ static void sStreamCallback(
     const FSEventStreamEventFlags *eventFlags,
     const FSEventStreamEventId *eventIds
 ) {
-    dispatch_async(dispatch_get_main_queue(), ^{
-        [(__bridge PresetManager *)clientCallBackInfo _scanPresetsFolder];
-    });
+    const FSEventStreamEventFlags fullScanFlags =
+        kFSEventStreamEventFlagMustScanSubDirs |
+        kFSEventStreamEventFlagUserDropped |
+        kFSEventStreamEventFlagKernelDropped |
+        kFSEventStreamEventFlagRootChanged;
+
+    BOOL needsFullScan = NO;
+
+    for (size_t i = 0; i < numEvents; i++) {
+        if (eventFlags[i] & fullScanFlags) needsFullScan = YES;
+    }
+
+    [(__bridge PresetManager *)clientCallBackInfo _handleChangedPaths: (__bridge NSArray *)eventPaths
+                                                        needsFullScan: needsFullScan];
 }
 
 
@@ -161,103 +196,233 @@ static void sStreamCallback(
         NULL
     };
 
+    // File events report each changed file, so most changes avoid a full scan
     _eventStream = FSEventStreamCreate(
         NULL,
         sStreamCallback,
         &context,
         (__bridge CFArrayRef) @[ [self _presetsFolderPath ] ],
         kFSEventStreamEventIdSinceNow,
-        0,
-        kFSEventStreamCreateFlagUseCFTypes
+        sEventStreamLatency,
+        kFSEventStreamCreateFlagUseCFTypes | kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer
     );
 
-    FSEventStreamSetDispatchQueue(_eventStream, dispatch_get_global_queue(0, 0));
+    FSEventStreamSetDispatchQueue(_eventStream, _indexQueue);
         
     FSEventStreamStart(_eventStream);
 }
 
 
-- (void) _scanPresetsFolder
+#pragma mark - Index Queue
+
+// Coalesces events until the folder has been quiet for sDebounceInterval
+- (void) _handleChangedPaths:(NSArray<NSString *> *)paths needsFullScan:(BOOL)needsFullScan
 {
-    NSString *folderPath = [self _presetsFolderPath];
-    NSFileManager *manager = [NSFileManager defaultManager];
+    [_pendingPaths addObjectsFromArray:paths];
+    if (needsFullScan) _needsFullScan = YES;
 
-    if (![manager fileExistsAtPath:folderPath]) return;
+    if (_flushScheduled) return;
+    _flushScheduled = YES;
 
-    [self _beginUpdates];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, sDebounceInterval * NSEC_PER_SEC), _indexQueue, ^{
+        self->_flushScheduled = NO;
 
-    NSDirectoryEnumerator *enumerator = [manager enumeratorAtURL: [NSURL fileURLWithPath:folderPath]
-                                      includingPropertiesForKeys: @[ NSURLContentModificationDateKey ]
-                                                         options: 0
-                                                    errorHandler: nil];
+        NSMutableDictionary *loadedPresets = [NSMutableDictionary dictionary];
+        NSMutableSet *removedIdentifiers = [NSMutableSet set];
 
-    NSMutableDictionary *map = [NSMutableDictionary dictionary];
-    NSMutableArray *tmpPresets = [NSMutableArray array];
+        [self _indexWithLoadedPresets:loadedPresets removedIdentifiers:removedIdentifiers];
+
+        if ([loadedPresets count] || [removedIdentifiers count]) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self _applyLoadedPresets:loadedPresets removedIdentifiers:removedIdentifiers];
+            });
+        }
+    });
+}
 
-    for (NSURL *fileURL in enumerator) {
-        NSString *identifier = [Preset identifierWithFileURL:fileURL];
-        NSString *pathExtension = [fileURL pathExtension];
 
-        if (![pathExtension isEqualToString:@"json"]) continue;
+- (void) _indexFileURL: (NSURL *) fileURL
+      modificationDate: (NSDate *) modificationDate
+         loadedPresets: (NSMutableDictionary *) loadedPresets
+    removedIdentifiers: (NSMutableSet *) removedIdentifiers
+{
+    if (![[fileURL pathExtension] isEqualToString:@"json"]) return;
 
-        NSDate *modificationDate = nil;
+    NSString *path = [fileURL path];
+    NSString *identifier = [Preset identifierWithFileURL:fileURL];
+
+    if (!modificationDate) {
         [fileURL getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:NULL];
-        
-        if (!modificationDate) continue;
+    }
 
-        Preset *preset = [_identifierToPresetMap objectForKey:identifier];
-        
-        if (!preset) {
-            BOOL enabled = [[[Settings sharedInstance] enabledPresetIdentifiers] containsObject:identifier];
-            preset = [[Preset alloc] initWithFileURL:fileURL enabled:enabled];
+    if (!modificationDate) {
+        if ([_pathToModificationDateMap objectForKey:path]) {
+            [_pathToModificationDateMap removeObjectForKey:path];
+            [removedIdentifiers addObject:identifier];
         }
 
-        if ([modificationDate isGreaterThan:[preset modificationDate]]) {
-            [preset updateWithModificationDate:modificationDate];
-            _needsPresetsDidChangeNotification = YES;
-        }
+        return;
+    }
 
-        [tmpPresets addObject:preset];
-        [map setObject:preset forKey:identifier];
+    NSDate *indexedDate = [_pathToModificationDateMap objectForKey:path];
+
+    if (!indexedDate || [modificationDate isGreaterThan:indexedDate]) {
+        // Not yet visible to the main thread, so it may be read here
+        Preset *preset = [[Preset alloc] initWithFileURL:fileURL enabled:NO];
+        [preset updateWithModificationDate:modificationDate];
+
+        [loadedPresets setObject:preset forKey:identifier];
+        [_pathToModificationDateMap setObject:modificationDate forKey:path];
     }
+}
 
-    // Create a new allPresets array
-    {
-        NSMutableArray *allPresets = [NSMutableArray array];
 
-        for (Preset *preset in _allPresets) {
-            if ([tmpPresets containsObject:preset]) {
-                [allPresets addObject:preset];
-                [tmpPresets removeObject:preset];
-            }
+// Reads new and changed files into detached presets, and collects identifiers of removed files
+- (void) _indexWithLoadedPresets:(NSMutableDictionary *)loadedPresets removedIdentifiers:(NSMutableSet *)removedIdentifiers
+{
+    NSString *folderPath = [self _presetsFolderPath];
+    NSTimeInterval startTime = [NSDate timeIntervalSinceReferenceDate];
+
+    BOOL fullScan = _needsFullScan;
+    NSUInteger pathCount = 0;
+
+    if (fullScan) {
+        NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtURL: [NSURL fileURLWithPath:folderPath]
+                                                                 includingPropertiesForKeys: @[ NSURLContentModificationDateKey ]
+                                                                                    options: 0
+                                                                               errorHandler: nil];
+
+        NSMutableSet *missingPaths = [NSMutableSet setWithArray:[_pathToModificationDateMap allKeys]];
+
+        for (NSURL *fileURL in enumerator) {
+            NSDate *modificationDate = nil;
+            [fileURL getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:NULL];
+
+            if (!modificationDate) continue;
+
+            [missingPaths removeObject:[fileURL path]];
+
+            [self _indexFileURL: fileURL
+               modificationDate: modificationDate
+                  loadedPresets: loadedPresets
+             removedIdentifiers: removedIdentifiers];
+
+            pathCount++;
         }
 
-        [allPresets addObjectsFromArray:tmpPresets];
+        for (NSString *path in missingPaths) {
+            [_pathToModificationDateMap removeObjectForKey:path];
+            [removedIdentifiers addObject:[Preset identifierWithFileURL:[NSURL fileURLWithPath:path]]];
+        }
+
+    } else {
+        for (NSString *path in _pendingPaths) {
+            [self _indexFileURL: [NSURL fileURLWithPath:path]
+               modificationDate: nil
+                  loadedPresets: loadedPresets
+             removedIdentifiers: removedIdentifiers];
+        }
     }
 
-    NSMutableArray *allPresets = [NSMutableArray array];
+    _needsFullScan = NO;
+    [_pendingPaths removeAllObjects];
 
-    // Make an ordered allPresets array based on existing orderedPresetIdentifiers
-    for (NSString *identifier in [[Settings sharedInstance] orderedPresetIdentifiers]) {
-        Preset *preset = [map objectForKey:identifier];
-        
-        if (preset) {
-            [tmpPresets removeObject:preset];
-            [allPresets addObject:preset];
+    // Incremental passes run on every save, so only full scans (at launch, or after dropped events) are logged
+    if (fullScan) {
+        NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - startTime;
+
+        NSLog(@"Indexed %ld presets (%ld paths checked, %ld loaded, %ld removed) in %.1f ms",
+            (long)[_pathToModificationDateMap count],
+            (long)pathCount, (long)[loadedPresets count], (long)[removedIdentifiers count],
+            elapsed * 1000.0
+        );
+    }
+}
+
+
+#pragma mark - Main Thread
+
+- (void) _scanPresetsFolder
+{
+    NSMutableDictionary *loadedPresets = [NSMutableDictionary dictionary];
+    NSMutableSet *removedIdentifiers = [NSMutableSet set];
+
+    dispatch_sync(_indexQueue, ^{
+        self->_needsFullScan = YES;
+        [self _indexWithLoadedPresets:loadedPresets removedIdentifiers:removedIdentifiers];
+    });
+
+    [self _applyLoadedPresets:loadedPresets removedIdentifiers:removedIdentifiers];
+}
+
+
+- (void) _applyLoadedPresets:(NSDictionary<NSString *, Preset *> *)loadedPresets removedIdentifiers:(NSSet<NSString *> *)removedIdentifiers
+{
+    [self _beginUpdates];
+
+    BOOL membershipChanged = NO;
+
+    for (NSString *identifier in removedIdentifiers) {
+        if ([loadedPresets objectForKey:identifier]) continue;
+
+        if ([_identifierToPresetMap objectForKey:identifier]) {
+            [_identifierToPresetMap removeObjectForKey:identifier];
+            membershipChanged = YES;
         }
     }
 
-    // Add remaining objects sorted by name
-    [tmpPresets sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:@"identifier" ascending:YES] ]];
-    [allPresets addObjectsFromArray:tmpPresets];
+    NSSet *enabledIdentifiers = [NSSet setWithArray:[[Settings sharedInstance] enabledPresetIdentifiers]];
+
+    for (NSString *identifier in loadedPresets) {
+        Preset *loadedPreset = [loadedPresets objectForKey:identifier];
+        Preset *preset = [_identifierToPresetMap objectForKey:identifier];
+
+        if (!preset) {
+            BOOL enabled = [enabledIdentifiers containsObject:identifier];
+            preset = [[Preset alloc] initWithFileURL:[loadedPreset fileURL] enabled:enabled];
+
+            [_identifierToPresetMap setObject:preset forKey:identifier];
+            membershipChanged = YES;
+        }
+
+        [preset updateWithPreset:loadedPreset];
+        _needsPresetsDidChangeNotification = YES;
+    }
+
+    if (membershipChanged) {
+        NSMutableArray *allPresets = [NSMutableArray arrayWithCapacity:[_identifierToPresetMap count]];
+        NSMutableSet *addedIdentifiers = [NSMutableSet set];
 
-    NSString *selectedPresetIdentifier = [[Settings sharedInstance] selectedPresetIdentifier];
+        // Make an ordered allPresets array based on existing orderedPresetIdentifiers
+        for (NSString *identifier in [[Settings sharedInstance] orderedPresetIdentifiers]) {
+            Preset *preset = [_identifierToPresetMap objectForKey:identifier];
 
-    [self setAllPresets:allPresets];
+            if (preset && ![addedIdentifiers containsObject:identifier]) {
+                [allPresets addObject:preset];
+                [addedIdentifiers addObject:identifier];
+            }
+        }
 
-    _identifierToPresetMap = map;
+        // Add remaining objects sorted by identifier
+        NSMutableArray *remainingIdentifiers = [NSMutableArray array];
+
+        for (NSString *identifier in _identifierToPresetMap) {
+            if (![addedIdentifiers containsObject:identifier]) {
+                [remainingIdentifiers addObject:identifier];
+            }
+        }
 
-    [self selectPresetWithIdentifier:selectedPresetIdentifier];
+        [remainingIdentifiers sortUsingSelector:@selector(compare:)];
+
+        for (NSString *identifier in remainingIdentifiers) {
+            [allPresets addObject:[_identifierToPresetMap objectForKey:identifier]];
+        }
+
+        NSString *selectedPresetIdentifier = [[Settings sharedInstance] selectedPresetIdentifier];
+
+        [self setAllPresets:allPresets];
+        [self selectPresetWithIdentifier:selectedPresetIdentifier];
+    }
 
     [self _endUpdates];
 }
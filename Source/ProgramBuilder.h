@@ -3,37 +3,29 @@
 
 @import Foundation;
 
-@class Preset;
-typedef struct NoisyProgram  NoisyProgram;
-typedef struct NoisyNodeList NoisyNodeList;
+@class Preset, CompiledPreset;
 
 extern NSErrorDomain ProgramBuilderErrorDomain;
 
+/*
+    Parses and validates a preset's JSON into a CompiledPreset.
+    This happens once per preset revision; see -[Preset compiledPresetWithError:].
+*/
 @interface ProgramBuilder : NSObject
 
+- (instancetype) initWithPreset: (Preset *) preset;
+
+// isCancelled is checked before each node. Once it returns YES, parsing
+// stops and error is NSUserCancelledError.
 - (instancetype) initWithPreset: (Preset *) preset
-                   channelCount: (size_t) channelCount
-                     sampleRate: (double) sampleRate
-                    forAutoGain: (BOOL) forAutoGain;
+                    cancelCheck: (BOOL (^)(void)) isCancelled;
 
 // Input properties
 @property (nonatomic, readonly) Preset *preset;
-@property (nonatomic, readonly) size_t channelCount;
-@property (nonatomic, readonly) double sampleRate;
-@property (nonatomic, readonly) BOOL forAutoGain;
 
 
 // Output properties
-
-- (void) transferHeadNodeList: (NoisyNodeList **) outHeadNodeList
-                 leftNodeList: (NoisyNodeList **) outLeftNodeList
-                rightNodeList: (NoisyNodeList **) outRightNodeList;
-
+@property (nonatomic, readonly) CompiledPreset *compiledPreset;
 @property (nonatomic, readonly) NSError *error;
 
-@property (nonatomic, readonly) double autoGainLevel;
-@property (nonatomic, readonly) size_t autoGainSampleCount;
-@property (nonatomic, readonly, getter=isAutoGainSeparate) BOOL autoGainSeparate;
-
 @end
-
@@ -3,57 +3,87 @@
 
 #import "ProgramBuilder.h"
 
+#import "CompiledPreset.h"
 #import "NoisyNode.h"
-#import "NoisyProgram.h"
 #import "Biquad.h"
 #import "Preset.h"
 
+@import AVFAudio;
+
 static id sRequired = @{};
 
+// In Hz. Modulators are meant for slow movement, well below the control rate.
+static const double sMaximumModulatorRate = 20.0;
+
+// Largest depth magnitudes, in dB for gain and in octaves otherwise
+static const double sMaximumModulatorGainDepth   = 60.0;
+static const double sMaximumModulatorOctaveDepth = 8.0;
+
 NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
 
 
 @implementation ProgramBuilder {
     NSError *_error;
+    BOOL (^_isCancelled)(void);
     NSMutableArray *_pathComponents;
-    NSInteger _autoGainRandomSeed;
     NSInteger _nodeDepth;
 
-    NoisyNodeList *_headNodeList;
-    NoisyNodeList *_leftNodeList;
-    NoisyNodeList *_rightNodeList;
+    double _autoGainLevel;
+    double _autoGainLoudness;
+    BOOL _autoGainSeparate;
+
+    // CompiledNode records. Stereo branches are collected separately
+    // and placed after the head list.
+    NSMutableData *_headNodes;
+    NSMutableData *_leftNodes;
+    NSMutableData *_rightNodes;
+    NSMutableData *_currentNodes;
+
+    NSMutableData *_values;
+    NSMutableData *_samples;
+
+    // Maps each "id" to @[ node records, record index ]
+    NSMutableDictionary<NSString *, NSArray *> *_nodeIdentifiers;
+    NSMutableData *_modulators;
+
+    // Attributes of each file read, by path, taken before reading it
+    NSMutableDictionary<NSString *, NSDictionary<NSFileAttributeKey, id> *> *_dependencies;
 }
 
 
 #pragma mark - Lifecycle
 
 - (instancetype) initWithPreset: (Preset *) preset
-                   channelCount: (size_t) channelCount
-                     sampleRate: (double) sampleRate
-                    forAutoGain: (BOOL) forAutoGain
+{
+    return [self initWithPreset:preset cancelCheck:nil];
+}
+
+
+- (instancetype) initWithPreset: (Preset *) preset
+                    cancelCheck: (BOOL (^)(void)) isCancelled
 {
     if ((self = [super init])) {
         _preset = preset;
-        _channelCount = channelCount;
-        _sampleRate = sampleRate;
-        _forAutoGain = forAutoGain;
-        
+        _isCancelled = isCancelled;
+
         _pathComponents = [NSMutableArray array];
-        
+
+        _headNodes  = [NSMutableData data];
+        _values     = [NSMutableData data];
+        _samples    = [NSMutableData data];
+        _modulators = [NSMutableData data];
+
+        _nodeIdentifiers = [NSMutableDictionary dictionary];
+        _dependencies    = [NSMutableDictionary dictionary];
+
+        _currentNodes = _headNodes;
+
         [self _parsePreset];
     }
 
     return self;
 }
 
-
-- (void) dealloc
-{
-    NoisyNodeFree(_headNodeList);
-    NoisyNodeFree(_leftNodeList);
-    NoisyNodeFree(_rightNodeList);
-}
-
 #pragma mark - Validation
 
 - (void) _pushPathComponent:(NSString *)format, ... NS_FORMAT_FUNCTION(1,2)
@@ -182,21 +212,60 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
 }
 
 
+// The upper limit (the sample rate) is checked when a program is made
+- (double) _validateDensityInDictionary:(NSDictionary *)inDictionary
+{
+    double density = [[inDictionary objectForKey:@"density"] doubleValue];
+
+    if (!_error && density <= 0) {
+        [self _pushPathComponent:@".density"];
+        [self _raiseError:@"Density must be greater than 0"];
+        [self _popPathComponent];
+    }
+
+    return density;
+}
+
+
+#pragma mark - Records
+
+- (CompiledNode *) _appendNodeWithType: (CompiledNodeType) type
+                               subtype: (uint32_t) subtype
+                                 count: (size_t) count
+                                values: (const double *) values
+                            valueCount: (size_t) valueCount
+{
+    CompiledNode node = {
+        .type       = type,
+        .subtype    = subtype,
+        .count      = (uint32_t)count,
+        .valueIndex = (uint32_t)([_values length] / sizeof(double))
+    };
+
+    if (valueCount) [_values appendBytes:values length:(valueCount * sizeof(double))];
+    [_currentNodes appendBytes:&node length:sizeof(CompiledNode)];
+
+    return (CompiledNode *)((uint8_t *)[_currentNodes mutableBytes] + [_currentNodes length]) - 1;
+}
+
+
 #pragma mark - Readers
 
 - (void) _readAutoGainSettings:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
-        @"level":    @[ [NSNumber class], @( -3.0 ) ],
-        @"separate": @[ [NSNumber class], @NO       ],
+        @"loudness": @[ [NSNumber class], @( -20.0 ) ],
+        @"level":    @[ [NSNumber class], @( -3.0 )  ],
+        @"separate": @[ [NSNumber class], @NO        ],
     }];
         
+    _autoGainLoudness = [[inNode objectForKey:@"loudness"] doubleValue];
     _autoGainLevel    = [[inNode objectForKey:@"level"] doubleValue];
     _autoGainSeparate = [[inNode objectForKey:@"separate"] boolValue];
 }
 
 
-- (Biquad *) _readBiquad:(NSDictionary *)inNode
+- (BOOL) _readBiquad:(NSDictionary *)inNode values:(double *)outValues
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":      @[ [NSString class], sRequired ],
@@ -205,7 +274,7 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         @"Q":         @[ [NSNumber class], @( M_SQRT1_2 ) ],
     }];
 
-    if (_error) return nil;
+    if (_error) return NO;
 
     double frequency     = [[inNode objectForKey:@"frequency"] doubleValue];
     double gain          = [[inNode objectForKey:@"gain"]      doubleValue];
@@ -221,28 +290,34 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         @"highshelf": @( BiquadTypeHighshelf )
     }];
         
-    if (_error) return nil;
+    if (_error) return NO;
 
-    return [[Biquad alloc] initWithType:[typeNumber integerValue] frequency:frequency Q:Q gain:gain];
+    outValues[0] = [typeNumber integerValue];
+    outValues[1] = frequency;
+    outValues[2] = Q;
+    outValues[3] = gain;
+
+    return YES;
 }
 
 
-- (NoisyBiquadsNode *) _readBiquadsNode:(NSDictionary *)inNode
+- (void) _readBiquadsNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":     @[ [NSString class], sRequired ],
         @"biquads":  @[ [NSArray  class], sRequired ],
     }];
     
-    NSMutableArray *outBiquads = [NSMutableArray array];
+    NSArray *inBiquads = [inNode objectForKey:@"biquads"];
+    double *values = calloc(4 * [inBiquads count], sizeof(double));
+    size_t count = 0;
     
     NSInteger index = 0;
-    for (NSDictionary *inBiquad in [inNode objectForKey:@"biquads"]) {
+    for (NSDictionary *inBiquad in inBiquads) {
         [self _pushPathComponent:@".biquads[%ld]", (long)index++];
         
         if ([inBiquad isKindOfClass:[NSDictionary class]]) {
-            Biquad *outBiquad = [self _readBiquad:inBiquad];
-            if (outBiquad) [outBiquads addObject:outBiquad];
+            if ([self _readBiquad:inBiquad values:&values[4 * count]]) count++;
         } else {
             [self _raiseError:@"Expected an object type"];
         }
@@ -250,72 +325,210 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         [self _popPathComponent];
     }
 
-    if (_error) return NULL;
-    
-    double *coefficients = malloc(5 * [outBiquads count] * sizeof(double));
+    if (!_error) {
+        [self _appendNodeWithType:CompiledNodeTypeBiquads subtype:0 count:count values:values valueCount:(4 * count)];
+    }
 
-    [Biquad fillCoefficients:coefficients biquadArray:outBiquads sampleRate:_sampleRate];
-    
-    NoisyBiquadsNode *result = NoisyBiquadsNodeCreate(coefficients, [outBiquads count]);
+    free(values);
+}
+
+
+- (float *) _readImpulseAtURL:(NSURL *)fileURL channel:(NSUInteger)channel length:(size_t *)outLength sampleRate:(double *)outSampleRate
+{
+    NSError *error = nil;
+    AVAudioFile *file = [[AVAudioFile alloc] initForReading:fileURL error:&error];
+
+    if (!file) {
+        [self _raiseError:@"Could not read '%@': %@", [fileURL lastPathComponent], [error localizedDescription]];
+        return NULL;
+    }
+
+    AVAudioFormat *inFormat = [file processingFormat];
+    AVAudioFrameCount inFrameCount = (AVAudioFrameCount)[file length];
+
+    if (channel >= [inFormat channelCount]) {
+        [self _raiseError:@"'%@' has only %ld channel(s)", [fileURL lastPathComponent], (long)[inFormat channelCount]];
+        return NULL;
+    }
+
+    if (inFrameCount == 0 || ([file length] / [inFormat sampleRate]) > 30.0) {
+        [self _raiseError:@"Impulse response must be between 0 and 30 seconds long"];
+        return NULL;
+    }
+
+    AVAudioPCMBuffer *inBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:inFormat frameCapacity:inFrameCount];
+
+    if (![file readIntoBuffer:inBuffer error:&error]) {
+        [self _raiseError:@"Could not read '%@': %@", [fileURL lastPathComponent], [error localizedDescription]];
+        return NULL;
+    }
+
+    // Kept at the file's sample rate. CompiledPreset resamples when making a program.
+    size_t length = [inBuffer frameLength];
+    float *result = malloc(length * sizeof(float));
+
+    memcpy(result, [inBuffer floatChannelData][channel], length * sizeof(float));
+
+    *outLength = length;
+    *outSampleRate = [inFormat sampleRate];
 
-    free(coefficients);
-    
     return result;
 }
 
 
-- (NoisyDCBlockNode *) _readDCBlockNode:(NSDictionary *)inNode
+- (void) _readConvolveNode:(NSDictionary *)inNode
+{
+    inNode = [self _validateDictionary:inNode withTemplate:@{
+        @"type":    @[ [NSString class], sRequired ],
+        @"file":    @[ [NSString class], sRequired ],
+        @"channel": @[ [NSNumber class], @0 ],
+        @"gain":    @[ [NSNumber class], @0 ],
+    }];
+
+    if (_error) return;
+
+    NSString *path    = [inNode objectForKey:@"file"];
+    NSInteger channel = [[inNode objectForKey:@"channel"] integerValue];
+    double gain       = [[inNode objectForKey:@"gain"] doubleValue];
+
+    if (channel < 0) {
+        [self _pushPathComponent:@".channel"];
+        [self _raiseError:@"Channel must not be negative"];
+        [self _popPathComponent];
+        return;
+    }
+
+    // Relative paths are resolved against the preset's directory
+    NSURL *directoryURL = [[_preset fileURL] URLByDeletingLastPathComponent];
+    NSURL *fileURL = [path isAbsolutePath] ?
+        [NSURL fileURLWithPath:path] :
+        [NSURL fileURLWithPath:path relativeToURL:directoryURL];
+
+    // Taken first, so that a change during the read invalidates the snapshot
+    NSString *filePath = [[fileURL absoluteURL] path];
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:NULL];
+    if (attributes) [_dependencies setObject:attributes forKey:filePath];
+
+    [self _pushPathComponent:@".file"];
+
+    size_t impulseLength = 0;
+    double impulseSampleRate = 0;
+    float *impulse = [self _readImpulseAtURL:fileURL channel:channel length:&impulseLength sampleRate:&impulseSampleRate];
+
+    [self _popPathComponent];
+
+    if (_error) return;
+
+    float scalar = pow(10.0, gain / 20.0);
+    vDSP_vsmul(impulse, 1, &scalar, impulse, 1, impulseLength);
+
+    CompiledNode *node = [self _appendNodeWithType: CompiledNodeTypeConvolve
+                                           subtype: 0
+                                             count: impulseLength
+                                            values: &impulseSampleRate
+                                        valueCount: 1];
+
+    node->sampleIndex = (uint32_t)([_samples length] / sizeof(float));
+    [_samples appendBytes:impulse length:(impulseLength * sizeof(float))];
+
+    free(impulse);
+}
+
+
+- (void) _readDCBlockNode:(NSDictionary *)inNode
+{
+    [self _appendNodeWithType:CompiledNodeTypeDCBlock subtype:0 count:0 values:NULL valueCount:0];
+}
+
+
+- (void) _readDecorrelateNode:(NSDictionary *)inNode
 {
-    return NoisyDCBlockNodeCreate();
+    inNode = [self _validateDictionary:inNode withTemplate:@{
+        @"type":     @[ [NSString class], sRequired ],
+        @"duration": @[ [NSNumber class], @30 ],
+        @"density":  @[ [NSNumber class], @1000 ],
+    }];
+
+    double density  = [self _validateDensityInDictionary:inNode];
+    double duration = [[inNode objectForKey:@"duration"] doubleValue];
+
+    if (!_error && (duration <= 0 || duration > 1000)) {
+        [self _pushPathComponent:@".duration"];
+        [self _raiseError:@"Duration must be greater than 0 and no more than 1000"];
+        [self _popPathComponent];
+    }
+
+    if (_error) return;
+
+    double values[2] = { duration, density };
+    [self _appendNodeWithType:CompiledNodeTypeDecorrelate subtype:0 count:0 values:values valueCount:2];
 }
 
 
-- (NoisyGainNode *) _readGainNode:(NSDictionary *)inNode
+- (void) _readGainNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type": @[ [NSString class], sRequired ],
         @"gain": @[ [NSNumber class], sRequired ],
     }];
     
-    if (_error) return NULL;
+    if (_error) return;
  
     double gain = [[inNode objectForKey:@"gain"] doubleValue];
 
-    return NoisyGainNodeCreate(gain);
+    [self _appendNodeWithType:CompiledNodeTypeGain subtype:0 count:0 values:&gain valueCount:1];
 }
 
 
-- (NoisyGeneratorNode *) _readGeneratorNode:(NSDictionary *)inNode
+- (void) _readGeneratorNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":    @[ [NSString class], sRequired ],
         @"subtype": @[ [NSString class], @"uniform" ],
+        @"density": @[ [NSNumber class], @2000 ],
     }];
     
     NSNumber *subTypeNumber = [self _validateEnumKey:@"subtype" inDictionary:inNode withMap:@{
         @"uniform":  @( NoisyGeneratorTypeUniform  ),
         @"gaussian": @( NoisyGeneratorTypeGaussian ),
         @"brownian": @( NoisyGeneratorTypeBrownian ),
+        @"velvet":   @( NoisyGeneratorTypeVelvet   ),
     }];
 
-    if (_error) return NULL;
+    double density = [self _validateDensityInDictionary:inNode];
+
+    if (_error) return;
     
     NoisyGeneratorType generatorType = (NoisyGeneratorType)[subTypeNumber integerValue];
-    uint64_t randomSeed = _forAutoGain ? _autoGainRandomSeed++ : arc4random();
 
-    return NoisyGeneratorNodeCreate(generatorType, randomSeed);
+    [self _appendNodeWithType:CompiledNodeTypeGenerator subtype:generatorType count:0 values:&density valueCount:1];
 }
 
 
-- (NoisyNodeList *) _readNodeList:(NSArray *)inNodeArray
+- (void) _readNodeList:(NSArray *)inNodeArray
 {
-    NoisyNodeList *nodeList = NoisyNodeListCreate([inNodeArray count]);
+    // The stereo node switches _currentNodes, so keep our own reference for the count
+    NSMutableData *nodes = _currentNodes;
+    size_t listOffset = [nodes length];
+    size_t count = 0;
+
+    if (_nodeDepth >= CompiledPresetMaximumListDepth) {
+        [self _raiseError:@"Split nodes may be nested at most %d deep", CompiledPresetMaximumListDepth - 1];
+        return;
+    }
+
+    [self _appendNodeWithType:CompiledNodeTypeList subtype:0 count:0 values:NULL valueCount:0];
 
     _nodeDepth++;
 
     NSInteger index = 0;
 
     for (NSDictionary *inNode in inNodeArray) {
+        if (_isCancelled && _isCancelled()) {
+            if (!_error) _error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+            break;
+        }
+
         [self _pushPathComponent:@"[%ld]", (long)index++];
 
         if (![self _assertClass:[NSDictionary class] ofObject:inNode]) {
@@ -323,29 +536,52 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         }
         
         NSString *typeString = [inNode objectForKey:@"type"];
-        NoisyNodeRef node = NULL;
+        BOOL appendsNode = YES;
         
         if (!typeString) {
             [self _raiseError:@"Missing required key: 'type'"];
             break;
         }
 
+        // Any node may have an id, which modulators use to refer to it
+        id identifier = [inNode objectForKey:@"id"];
+
+        if (identifier) {
+            if ([typeString isEqual:@"stereo"]) {
+                [self _raiseError:@"A stereo node cannot have an id"];
+                break;
+            }
+
+            [self _readIdentifier:identifier];
+
+            NSMutableDictionary *nodeWithoutIdentifier = [inNode mutableCopy];
+            [nodeWithoutIdentifier removeObjectForKey:@"id"];
+            inNode = nodeWithoutIdentifier;
+        }
+
         if ([typeString isEqual:@"biquads"]) {
-            node = [self _readBiquadsNode:inNode];
+            [self _readBiquadsNode:inNode];
+        } else if ([typeString isEqual:@"convolve"]) {
+            [self _readConvolveNode:inNode];
         } else if ([typeString isEqual:@"dcblock"]) {
-            node = [self _readDCBlockNode:inNode];
+            [self _readDCBlockNode:inNode];
+        } else if ([typeString isEqual:@"decorrelate"]) {
+            [self _readDecorrelateNode:inNode];
         } else if ([typeString isEqual:@"gain"]) {
-            node = [self _readGainNode:inNode];
+            [self _readGainNode:inNode];
         } else if ([typeString isEqual:@"generator"]) {
-            node = [self _readGeneratorNode:inNode];
+            [self _readGeneratorNode:inNode];
         } else if ([typeString isEqual:@"onepole"]) {
-            node = [self _readOnePoleNode:inNode];
+            [self _readOnePoleNode:inNode];
         } else if ([typeString isEqual:@"pinking"]) {
-            node = [self _readPinkingNode:inNode];
+            [self _readPinkingNode:inNode];
+        } else if ([typeString isEqual:@"spectral"]) {
+            [self _readSpectralNode:inNode];
         } else if ([typeString isEqual:@"split"]) {
-            node = [self _readSplitNode:inNode];
+            [self _readSplitNode:inNode];
         } else if ([typeString isEqual:@"stereo"]) {
             [self _readStereoNode:inNode];
+            appendsNode = NO;
         } else if ([typeString isEqual:@"zero"]) {
             [self _readZeroNode:inNode];
         } else {
@@ -354,9 +590,7 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
             [self _popPathComponent];
         }
         
-        if (node) {
-            NoisyNodeListAppend(nodeList, node);
-        }
+        if (appendsNode) count++;
 
         [self _popPathComponent];
 
@@ -365,16 +599,188 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
     
     _nodeDepth--;
 
-    if (_error) {
-        NoisyNodeListFree(nodeList);
-        return NULL;
+    CompiledNode *listNode = (CompiledNode *)((uint8_t *)[nodes mutableBytes] + listOffset);
+    listNode->count = (uint32_t)count;
+}
+
+
+// The node's record is the next one appended to _currentNodes
+- (void) _readIdentifier:(id)identifier
+{
+    [self _pushPathComponent:@".id"];
+
+    if ([self _assertClass:[NSString class] ofObject:identifier]) {
+        if ([identifier length] == 0 || [identifier rangeOfString:@"."].location != NSNotFound) {
+            [self _raiseError:@"An id must be non-empty and cannot contain '.'"];
+        } else if ([_nodeIdentifiers objectForKey:identifier]) {
+            [self _raiseError:@"Duplicate id: '%@'", identifier];
+        } else {
+            NSNumber *recordIndex = @([_currentNodes length] / sizeof(CompiledNode));
+            [_nodeIdentifiers setObject:@[ _currentNodes, recordIndex ] forKey:identifier];
+        }
     }
-    
-    return nodeList;
+
+    [self _popPathComponent];
 }
 
 
-- (NoisyOnePoleNode *) _readOnePoleNode:(NSDictionary *)inNode
+- (void) _readModulatorTarget:(NSString *)target modulator:(CompiledModulator *)modulator
+{
+    [self _pushPathComponent:@".target"];
+
+    // "<id>.<parameter>", or "<id>.biquads[<index>].<parameter>"
+    NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:
+        @"^([^.]+)(?:\\.biquads\\[([0-9]+)\\])?\\.(gain|frequency|Q)$" options:0 error:NULL];
+
+    NSTextCheckingResult *match = [regex firstMatchInString:target options:0 range:NSMakeRange(0, [target length])];
+
+    if (!match) {
+        [self _raiseError:@"Invalid target: '%@'", target];
+        [self _popPathComponent];
+        return;
+    }
+
+    NSString *identifier = [target substringWithRange:[match rangeAtIndex:1]];
+    NSArray  *entry      = [_nodeIdentifiers objectForKey:identifier];
+
+    if (!entry) {
+        [self _raiseError:@"Unknown id: '%@'", identifier];
+        [self _popPathComponent];
+        return;
+    }
+
+    NSMutableData *nodes = [entry firstObject];
+    size_t recordIndex   = [[entry lastObject] unsignedIntegerValue];
+
+    const CompiledNode *node = (const CompiledNode *)[nodes bytes] + recordIndex;
+
+    BOOL hasSection = [match rangeAtIndex:2].location != NSNotFound;
+    NSInteger section = hasSection ? [[target substringWithRange:[match rangeAtIndex:2]] integerValue] : 0;
+
+    NSString *parameterString = [target substringWithRange:[match rangeAtIndex:3]];
+    NoisyModulationParameter parameter = [parameterString isEqual:@"gain"] ?
+        NoisyModulationParameterGain :
+        ([parameterString isEqual:@"Q"] ? NoisyModulationParameterQ : NoisyModulationParameterFrequency);
+
+    BOOL isValid = NO;
+
+    if (node->type == CompiledNodeTypeBiquads) {
+        isValid = hasSection && section < node->count;
+    } else if (node->type == CompiledNodeTypeGain) {
+        isValid = !hasSection && parameter == NoisyModulationParameterGain;
+    } else if (node->type == CompiledNodeTypeOnePole) {
+        isValid = !hasSection && parameter == NoisyModulationParameterFrequency;
+    }
+
+    if (!isValid) {
+        [self _raiseError:@"Cannot modulate '%@'", target];
+        [self _popPathComponent];
+        return;
+    }
+
+    // Node records are concatenated as head, left, right
+    size_t headCount = [_headNodes length] / sizeof(CompiledNode);
+    size_t leftCount = [_leftNodes length] / sizeof(CompiledNode);
+
+    if (nodes == _leftNodes) {
+        recordIndex += headCount;
+    } else if (nodes == _rightNodes) {
+        recordIndex += headCount + leftCount;
+    }
+
+    modulator->nodeIndex = (uint32_t)recordIndex;
+    modulator->parameter = parameter;
+    modulator->section   = (uint32_t)section;
+
+    [self _popPathComponent];
+}
+
+
+- (void) _readModulator:(NSDictionary *)inModulator
+{
+    inModulator = [self _validateDictionary:inModulator withTemplate:@{
+        @"target": @[ [NSString class], sRequired ],
+        @"shape":  @[ [NSString class], @"sine"   ],
+        @"rate":   @[ [NSNumber class], sRequired ],
+        @"depth":  @[ [NSNumber class], sRequired ],
+        @"phase":  @[ [NSNumber class], @0        ],
+    }];
+
+    if (_error) return;
+
+    NSNumber *shapeNumber = [self _validateEnumKey:@"shape" inDictionary:inModulator withMap:@{
+        @"sine":     @( ModulatorShapeSine     ),
+        @"triangle": @( ModulatorShapeTriangle ),
+        @"random":   @( ModulatorShapeRandom   )
+    }];
+
+    double rate  = [[inModulator objectForKey:@"rate"]  doubleValue];
+    double depth = [[inModulator objectForKey:@"depth"] doubleValue];
+    double phase = [[inModulator objectForKey:@"phase"] doubleValue];
+
+    if (!_error && (rate <= 0 || rate > sMaximumModulatorRate)) {
+        [self _pushPathComponent:@".rate"];
+        [self _raiseError:@"Rate must be greater than 0 and no more than %g", sMaximumModulatorRate];
+        [self _popPathComponent];
+    }
+
+    if (!_error && (phase < 0 || phase > 1)) {
+        [self _pushPathComponent:@".phase"];
+        [self _raiseError:@"Phase must be from 0 to 1"];
+        [self _popPathComponent];
+    }
+
+    if (_error) return;
+
+    CompiledModulator modulator = {
+        .shape = (uint32_t)[shapeNumber integerValue],
+        .rate  = rate,
+        .depth = depth,
+        .phase = phase
+    };
+
+    [self _readModulatorTarget:[inModulator objectForKey:@"target"] modulator:&modulator];
+
+    if (_error) return;
+
+    if (modulator.parameter == NoisyModulationParameterGain) {
+        if (fabs(depth) > sMaximumModulatorGainDepth) {
+            [self _pushPathComponent:@".depth"];
+            [self _raiseError:@"Gain depth must be no more than %g dB", sMaximumModulatorGainDepth];
+            [self _popPathComponent];
+        }
+
+    } else if (fabs(depth) > sMaximumModulatorOctaveDepth) {
+        [self _pushPathComponent:@".depth"];
+        [self _raiseError:@"Frequency and Q depth must be no more than %g octaves", sMaximumModulatorOctaveDepth];
+        [self _popPathComponent];
+    }
+
+    if (_error) return;
+
+    [_modulators appendBytes:&modulator length:sizeof(CompiledModulator)];
+}
+
+
+- (void) _readModulators:(NSArray *)inModulators
+{
+    NSInteger index = 0;
+
+    for (NSDictionary *inModulator in inModulators) {
+        [self _pushPathComponent:@"[%ld]", (long)index++];
+
+        if ([self _assertClass:[NSDictionary class] ofObject:inModulator]) {
+            [self _readModulator:inModulator];
+        }
+
+        [self _popPathComponent];
+
+        if (_error) break;
+    }
+}
+
+
+- (void) _readOnePoleNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":      @[ [NSString class], sRequired   ],
@@ -387,16 +793,16 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         @"lowpass":  @NO
     }];
 
-    if (_error) return NULL;
+    if (_error) return;
 
     double frequency  = [[inNode objectForKey:@"frequency"] doubleValue];
     BOOL   isHighpass = [subTypeNumber boolValue];
 
-    return NoisyOnePoleNodeCreate(frequency / _sampleRate, isHighpass);
+    [self _appendNodeWithType:CompiledNodeTypeOnePole subtype:isHighpass count:0 values:&frequency valueCount:1];
 }
 
 
-- (NoisyPinkingNode *) _readPinkingNode:(NSDictionary *)inNode
+- (void) _readPinkingNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":    @[ [NSString class], sRequired ],
@@ -404,31 +810,97 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
     }];
 
     NSNumber *subTypeNumber = [self _validateEnumKey:@"subtype" inDictionary:inNode withMap:@{
-        @"pk3": @( NoisyPinkingTypePK3 ),
-        @"pke": @( NoisyPinkingTypePKE ),
-        @"rbj": @( NoisyPinkingTypeRBJ )
+        @"pk3":  @( NoisyPinkingTypePK3  ),
+        @"pke":  @( NoisyPinkingTypePKE  ),
+        @"rbj":  @( NoisyPinkingTypeRBJ  ),
+        @"voss": @( NoisyPinkingTypeVoss )
     }];;
  
-    if (_error) return NULL;
+    if (_error) return;
     
     NoisyPinkingType pinkingType = (NoisyPinkingType)[subTypeNumber integerValue];
     
-    return NoisyPinkingNodeCreate(pinkingType);
+    [self _appendNodeWithType:CompiledNodeTypePinking subtype:pinkingType count:0 values:NULL valueCount:0];
 }
 
 
-- (NoisySplitNode *) _readSplitNode:(NSDictionary *)inNode
+- (void) _readSpectralNode:(NSDictionary *)inNode
+{
+    inNode = [self _validateDictionary:inNode withTemplate:@{
+        @"type":  @[ [NSString class], sRequired ],
+        @"curve": @[ [NSArray  class], sRequired ],
+    }];
+
+    if (_error) return;
+
+    NSArray *inPoints = [inNode objectForKey:@"curve"];
+    NSMutableArray *outPoints = [NSMutableArray array];
+
+    [self _pushPathComponent:@".curve"];
+
+    NSInteger index = 0;
+    for (NSDictionary *inPoint in inPoints) {
+        [self _pushPathComponent:@"[%ld]", (long)index++];
+
+        if ([self _assertClass:[NSDictionary class] ofObject:inPoint]) {
+            NSDictionary *outPoint = [self _validateDictionary:inPoint withTemplate:@{
+                @"frequency": @[ [NSNumber class], sRequired ],
+                @"gain":      @[ [NSNumber class], sRequired ],
+            }];
+            
+            if (!_error && [[outPoint objectForKey:@"frequency"] doubleValue] <= 0) {
+                [self _pushPathComponent:@".frequency"];
+                [self _raiseError:@"Frequency must be greater than 0"];
+                [self _popPathComponent];
+            }
+
+            if (!_error) [outPoints addObject:outPoint];
+        }
+        
+        [self _popPathComponent];
+        
+        if (_error) break;
+    }
+    
+    if (!_error && [outPoints count] == 0) {
+        [self _raiseError:@"Expected at least one point"];
+    }
+
+    [self _popPathComponent];
+
+    if (_error) return;
+
+    [outPoints sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:@"frequency" ascending:YES] ]];
+
+    size_t pointCount = [outPoints count];
+    double *values = malloc(2 * pointCount * sizeof(double));
+
+    for (size_t i = 0; i < pointCount; i++) {
+        NSDictionary *point = [outPoints objectAtIndex:i];
+
+        values[(2 * i)]     = [[point objectForKey:@"frequency"] doubleValue];
+        values[(2 * i) + 1] = [[point objectForKey:@"gain"] doubleValue];
+    }
+
+    [self _appendNodeWithType:CompiledNodeTypeSpectral subtype:0 count:pointCount values:values valueCount:(2 * pointCount)];
+
+    free(values);
+}
+
+
+- (void) _readSplitNode:(NSDictionary *)inNode
 {
     inNode = [self _validateDictionary:inNode withTemplate:@{
         @"type":     @[ [NSString class], sRequired ],
         @"programs": @[ [NSArray  class], sRequired ],
     }];
 
-    if (_error) return NULL;
+    if (_error) return;
 
     NSArray *inPrograms = [inNode objectForKey:@"programs"];
     
-    NoisySplitNode *splitNode = NoisySplitNodeCreate([inPrograms count]);
+    // Every branch must be an array, so the count is known up front
+    [self _appendNodeWithType:CompiledNodeTypeSplit subtype:0 count:[inPrograms count] values:NULL valueCount:0];
 
     [self _pushPathComponent:@".programs"];
 
@@ -437,8 +909,7 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         [self _pushPathComponent:@"[%ld]", (long)index++];
         
         if ([self _assertClass:[NSArray class] ofObject:inProgram]) {
-            NoisyNodeList *nodeList = [self _readNodeList:inProgram];
-            if (nodeList) NoisySplitNodeAppendNodeList(splitNode, nodeList);
+            [self _readNodeList:inProgram];
         }
         
         [self _popPathComponent];
@@ -447,19 +918,12 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
     }
     
     [self _popPathComponent];
-
-    if (_error) {
-        NoisyNodeFree(splitNode);
-        return NULL;
-    }
-
-    return splitNode;
 }
 
 
 - (void) _readStereoNode:(NSDictionary *)inNode
 {
-    if (_leftNodeList || _rightNodeList) {
+    if (_leftNodes || _rightNodes) {
         [self _raiseError:@"A program may only have one stereo node"];
         // Error here.
         return;
@@ -473,26 +937,29 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
         @"right": @[ [NSArray  class], sRequired ],
     }];
 
+    if (_error) return;
+
+    NSMutableData *previousNodes = _currentNodes;
+
+    _leftNodes  = [NSMutableData data];
+    _rightNodes = [NSMutableData data];
+
     [self _pushPathComponent:@".left"];
-    NoisyNodeList *leftList  = [self _readNodeList:[inNode objectForKey:@"left"]];
+    _currentNodes = _leftNodes;
+    [self _readNodeList:[inNode objectForKey:@"left"]];
     [self _popPathComponent];
 
     [self _pushPathComponent:@".right"];
-    NoisyNodeList *rightList = [self _readNodeList:[inNode objectForKey:@"right"]];
+    _currentNodes = _rightNodes;
+    [self _readNodeList:[inNode objectForKey:@"right"]];
     [self _popPathComponent];
 
-    if (_error) {
-        if (leftList)  NoisyNodeFree(leftList);
-        if (rightList) NoisyNodeFree(rightList);
-    } else {
-        _leftNodeList  = leftList;
-        _rightNodeList = rightList;
-    }
+    _currentNodes = previousNodes;
 }
 
-- (NoisyZeroNode *) _readZeroNode:(NSDictionary *)inNode
+- (void) _readZeroNode:(NSDictionary *)inNode
 {
-    return NoisyZeroNodeCreate();
+    [self _appendNodeWithType:CompiledNodeTypeZero subtype:0 count:0 values:NULL valueCount:0];
 }
 
 
@@ -504,8 +971,9 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
 
     rootDictionary = [self _validateDictionary:rootDictionary withTemplate:@{
         @"name":     @[ [NSString class] ],
-        @"program":  @[ [NSArray  class], sRequired ],
-        @"autogain": @[ [NSDictionary class] ]
+        @"program":    @[ [NSArray  class], sRequired ],
+        @"autogain":   @[ [NSDictionary class] ],
+        @"modulators": @[ [NSArray  class] ]
     }];
 
     [self _pushPathComponent:@".autogain"];
@@ -516,40 +984,46 @@ NSErrorDomain ProgramBuilderErrorDomain = @"ProgramBuilderErrorDomain";
 
     NSArray *programNodes = [rootDictionary objectForKey:@"program"];
     
-    _headNodeList = [self _readNodeList:programNodes];
-    
-    if ((_channelCount > 1) && !_error && !_leftNodeList && !_rightNodeList) {
-        _leftNodeList  = _headNodeList;
-        _rightNodeList = [self _readNodeList:programNodes];
-        _headNodeList  = NULL;
-    }
+    [self _readNodeList:programNodes];
     
     [self _popPathComponent];
-    [self _popPathComponent];
-}
 
+    // After the program, so that every id is known
+    if (!_error) {
+        [self _pushPathComponent:@".modulators"];
+        [self _readModulators:[rootDictionary objectForKey:@"modulators"]];
+        [self _popPathComponent];
+    }
 
-#pragma mark - Public Methods
-
+    [self _popPathComponent];
 
+    if (_error) return;
 
-- (void) transferHeadNodeList: (NoisyNodeList **) outHeadNodeList
-                 leftNodeList: (NoisyNodeList **) outLeftNodeList
-                rightNodeList: (NoisyNodeList **) outRightNodeList
-{
-    if (outHeadNodeList) {
-        *outHeadNodeList = _headNodeList;
-        _headNodeList = NULL;
-    }
+    BOOL isStereo = (_leftNodes != nil);
 
-    if (outLeftNodeList) {
-        *outLeftNodeList = _leftNodeList;
-        _leftNodeList = NULL;
+    NSMutableData *nodes = [_headNodes mutableCopy];
+    if (isStereo) {
+        [nodes appendData:_leftNodes];
+        [nodes appendData:_rightNodes];
     }
 
-    if (outRightNodeList) {
-        *outRightNodeList = _rightNodeList;
-        _rightNodeList = NULL;
+    _compiledPreset = [[CompiledPreset alloc] initWithName: [_preset name]
+                                                     nodes: [nodes bytes]
+                                                 nodeCount: [nodes length] / sizeof(CompiledNode)
+                                                    values: [_values bytes]
+                                                valueCount: [_values length] / sizeof(double)
+                                                   samples: [_samples bytes]
+                                               sampleCount: [_samples length] / sizeof(float)
+                                                modulators: [_modulators bytes]
+                                            modulatorCount: [_modulators length] / sizeof(CompiledModulator)
+                                              dependencies: _dependencies
+                                                  isStereo: isStereo
+                                             autoGainLevel: _autoGainLevel
+                                          autoGainLoudness: _autoGainLoudness
+                                        isAutoGainSeparate: _autoGainSeparate];
+
+    if (!_compiledPreset) {
+        [self _raiseError:@"Preset is too large"];
     }
 }
 
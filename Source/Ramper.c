@@ -113,6 +113,16 @@ extern void RamperProcess(Ramper *self, float *left, float *right, size_t frameC
 }
 
 
+bool RamperIsSilent(Ramper *self)
+{
+    if (atomic_load(&self->currentData) != atomic_load(&self->nextData)) {
+        return false;
+    }
+
+    return self->currentVolume == 0.0 && self->targetVolume == 0.0;
+}
+
+
 void RamperReset(Ramper *self)
 {
     memset(self, 0, sizeof(Ramper));
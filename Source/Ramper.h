@@ -5,6 +5,7 @@
 #define _RAMPER_H_
 
 #include <sys/types.h>
+#include <stdbool.h>
 
 typedef struct Ramper Ramper;
 
@@ -13,6 +14,10 @@ extern void RamperFree(Ramper *self);
 
 extern void RamperProcess(Ramper *self, float *left, float *right, size_t frameCount);
 
+// True when the ramp has settled at zero and no update is pending, in which
+// case RamperProcess() would clear its input. Call from the render thread.
+extern bool RamperIsSilent(Ramper *self);
+
 extern void RamperReset(Ramper *self);
 extern void RamperUpdate(Ramper *self, int shouldPlay, size_t frameDuration);
 
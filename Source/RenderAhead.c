@@ -0,0 +1,236 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "RenderAhead.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/param.h>
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <stdatomic.h>
+#include <dispatch/dispatch.h>
+
+
+typedef struct RenderAhead {
+    RenderAheadCallback render;
+    void *context;
+
+    size_t capacity;
+    size_t mask;
+    size_t batchFrameCount;
+
+    float *leftRing;
+    float *rightRing;
+    float *leftBatch;
+    float *rightBatch;
+
+    // Only the producer writes writeCount; only the consumer writes readCount
+    _Atomic(uint64_t) writeCount;
+    _Atomic(uint64_t) readCount;
+
+    _Atomic(uint64_t) underruns;
+    _Atomic(uint64_t) underrunFrames;
+    _Atomic(size_t)   minFillLevel;
+
+    pthread_t thread;
+    dispatch_semaphore_t semaphore;
+    _Atomic(bool) quit;
+    bool running;
+} RenderAhead;
+
+
+static void sCopyIn(float *ring, size_t mask, uint64_t position, const float *source, size_t frameCount)
+{
+    size_t start = position & mask;
+    size_t first = MIN(frameCount, (mask + 1) - start);
+
+    memcpy(ring + start, source, first * sizeof(float));
+    memcpy(ring, source + first, (frameCount - first) * sizeof(float));
+}
+
+
+static void sCopyOut(const float *ring, size_t mask, uint64_t position, float *destination, size_t frameCount)
+{
+    size_t start = position & mask;
+    size_t first = MIN(frameCount, (mask + 1) - start);
+
+    memcpy(destination, ring + start, first * sizeof(float));
+    memcpy(destination + first, ring, (frameCount - first) * sizeof(float));
+}
+
+
+// Renders batches until the ring cannot hold another one
+static void sFill(RenderAhead *self)
+{
+    size_t batchFrameCount = self->batchFrameCount;
+
+    while (!atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+        uint64_t writeCount = atomic_load_explicit(&self->writeCount, memory_order_relaxed);
+        uint64_t readCount  = atomic_load_explicit(&self->readCount,  memory_order_acquire);
+
+        if ((self->capacity - (size_t)(writeCount - readCount)) < batchFrameCount) {
+            break;
+        }
+
+        self->render(self->context, self->leftBatch, self->rightBatch, batchFrameCount);
+
+        sCopyIn(self->leftRing,  self->mask, writeCount, self->leftBatch,  batchFrameCount);
+        sCopyIn(self->rightRing, self->mask, writeCount, self->rightBatch, batchFrameCount);
+
+        atomic_store_explicit(&self->writeCount, writeCount + batchFrameCount, memory_order_release);
+    }
+}
+
+
+static void *sProducerMain(void *context)
+{
+    RenderAhead *self = context;
+
+    while (!atomic_load(&self->quit)) {
+        sFill(self);
+
+        // The consumer signals when a batch fits. The timeout only guards against a lost wakeup.
+        dispatch_semaphore_wait(self->semaphore, dispatch_time(DISPATCH_TIME_NOW, 100 * NSEC_PER_MSEC));
+    }
+
+    return NULL;
+}
+
+
+RenderAhead *RenderAheadCreate(
+    size_t capacity,
+    size_t batchFrameCount,
+    RenderAheadCallback render,
+    void *context
+) {
+    if (batchFrameCount == 0 || !render) return NULL;
+
+    RenderAhead *self = calloc(1, sizeof(RenderAhead));
+
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity || roundedCapacity < (2 * batchFrameCount)) {
+        roundedCapacity *= 2;
+    }
+
+    self->render  = render;
+    self->context = context;
+
+    self->capacity        = roundedCapacity;
+    self->mask            = roundedCapacity - 1;
+    self->batchFrameCount = batchFrameCount;
+
+    self->leftRing   = calloc(roundedCapacity, sizeof(float));
+    self->rightRing  = calloc(roundedCapacity, sizeof(float));
+    self->leftBatch  = calloc(batchFrameCount, sizeof(float));
+    self->rightBatch = calloc(batchFrameCount, sizeof(float));
+
+    self->semaphore = dispatch_semaphore_create(0);
+    atomic_init(&self->minFillLevel, roundedCapacity);
+
+    return self;
+}
+
+
+void RenderAheadFree(RenderAhead *self)
+{
+    if (!self) return;
+
+    RenderAheadStop(self);
+
+    dispatch_release(self->semaphore);
+
+    free(self->leftRing);
+    free(self->rightRing);
+    free(self->leftBatch);
+    free(self->rightBatch);
+
+    free(self);
+}
+
+
+void RenderAheadStart(RenderAhead *self)
+{
+    if (self->running) return;
+
+    atomic_store(&self->quit, false);
+
+    // Prefill on this thread. The producer does not exist yet, so there is still only one.
+    sFill(self);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_set_qos_class_np(&attr, QOS_CLASS_USER_INTERACTIVE, 0);
+
+    pthread_create(&self->thread, &attr, sProducerMain, self);
+    pthread_attr_destroy(&attr);
+
+    self->running = true;
+}
+
+
+void RenderAheadStop(RenderAhead *self)
+{
+    if (!self->running) return;
+
+    atomic_store(&self->quit, true);
+    dispatch_semaphore_signal(self->semaphore);
+    pthread_join(self->thread, NULL);
+
+    // Neither side is running, so the ring can be emptied
+    atomic_store(&self->writeCount, 0);
+    atomic_store(&self->readCount,  0);
+
+    self->running = false;
+}
+
+
+size_t RenderAheadRead(RenderAhead *self, float *left, float *right, size_t frameCount)
+{
+    uint64_t readCount  = atomic_load_explicit(&self->readCount,  memory_order_relaxed);
+    uint64_t writeCount = atomic_load_explicit(&self->writeCount, memory_order_acquire);
+
+    size_t available = (size_t)(writeCount - readCount);
+    size_t framesToRead = MIN(frameCount, available);
+
+    sCopyOut(self->leftRing,  self->mask, readCount, left,  framesToRead);
+    sCopyOut(self->rightRing, self->mask, readCount, right, framesToRead);
+
+    atomic_store_explicit(&self->readCount, readCount + framesToRead, memory_order_release);
+
+    if (framesToRead < frameCount) {
+        size_t missing = frameCount - framesToRead;
+
+        memset(left  + framesToRead, 0, missing * sizeof(float));
+        memset(right + framesToRead, 0, missing * sizeof(float));
+
+        atomic_fetch_add_explicit(&self->underruns, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&self->underrunFrames, missing, memory_order_relaxed);
+    }
+
+    size_t fillLevel = available - framesToRead;
+
+    if (fillLevel < atomic_load_explicit(&self->minFillLevel, memory_order_relaxed)) {
+        atomic_store_explicit(&self->minFillLevel, fillLevel, memory_order_relaxed);
+    }
+
+    if ((self->capacity - fillLevel) >= self->batchFrameCount) {
+        dispatch_semaphore_signal(self->semaphore);
+    }
+
+    return framesToRead;
+}
+
+
+void RenderAheadGetStats(RenderAhead *self, RenderAheadStats *outStats)
+{
+    uint64_t readCount  = atomic_load_explicit(&self->readCount,  memory_order_relaxed);
+    uint64_t writeCount = atomic_load_explicit(&self->writeCount, memory_order_relaxed);
+
+    outStats->capacity       = self->capacity;
+    outStats->fillLevel      = (size_t)(writeCount - readCount);
+    outStats->minFillLevel   = atomic_exchange_explicit(&self->minFillLevel, self->capacity, memory_order_relaxed);
+    outStats->underruns      = atomic_load_explicit(&self->underruns, memory_order_relaxed);
+    outStats->underrunFrames = atomic_load_explicit(&self->underrunFrames, memory_order_relaxed);
+}
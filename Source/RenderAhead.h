@@ -0,0 +1,53 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _RENDER_AHEAD_H_
+#define _RENDER_AHEAD_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+    Renders audio ahead of time on a producer thread into a lock-free
+    single-producer, single-consumer ring.
+
+    The producer calls the render callback in batches of batchFrameCount
+    frames whenever the ring has room for a full batch. The consumer (the
+    device callback) only copies out of the ring. If the ring runs dry, the
+    missing frames are filled with silence and the underrun is counted.
+
+    RenderAheadStart() fills the ring on the calling thread before starting the
+    producer, so output starts without an underrun. Start and Stop must not be
+    called while RenderAheadRead() may run.
+*/
+typedef struct RenderAhead RenderAhead;
+
+typedef void (*RenderAheadCallback)(void *context, float *left, float *right, size_t frameCount);
+
+typedef struct RenderAheadStats {
+    size_t   capacity;       // In frames
+    size_t   fillLevel;      // Frames currently in the ring
+    size_t   minFillLevel;   // Lowest fill level after a read, since the previous call
+    uint64_t underruns;      // Reads which found fewer frames than requested
+    uint64_t underrunFrames; // Frames of silence written due to underruns
+} RenderAheadStats;
+
+// capacity is rounded up to a power of two, and to at least two batches
+extern RenderAhead *RenderAheadCreate(
+    size_t capacity,
+    size_t batchFrameCount,
+    RenderAheadCallback render,
+    void *context
+);
+
+extern void RenderAheadFree(RenderAhead *self);
+
+extern void RenderAheadStart(RenderAhead *self);
+extern void RenderAheadStop(RenderAhead *self);
+
+// Consumer side. Does not allocate or lock. Returns the number of frames read.
+extern size_t RenderAheadRead(RenderAhead *self, float *left, float *right, size_t frameCount);
+
+extern void RenderAheadGetStats(RenderAhead *self, RenderAheadStats *outStats);
+
+#endif
@@ -0,0 +1,306 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "Resampler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+
+typedef float ResamplerVector __attribute__((vector_size(16), aligned(4)));
+
+static const size_t sLaneCount = 4;
+
+// Output frames rendered per pass. Bounds the size of the input buffer.
+static const size_t sChunkFrameCount = 256;
+
+// Positions are in input frames, as 32.32 fixed point
+static const int sFractionBits = 32;
+
+
+typedef struct ResamplerTier {
+    size_t tapCount;
+    size_t log2PhaseCount;
+    double attenuation; // In dB
+} ResamplerTier;
+
+
+static const ResamplerTier sTiers[] = {
+    { 16, 7,  50.0  },
+    { 32, 8,  80.0  },
+    { 64, 9,  100.0 }
+};
+
+
+typedef struct Resampler {
+    ResamplerCallback render;
+    void *context;
+
+    size_t tapCount;
+    size_t log2PhaseCount;
+
+    // phaseCount rows of tapCount coefficients, and the difference to the next row
+    float *coefficients;
+    float *deltas;
+
+    uint64_t position;
+    uint64_t step;
+
+    float *left;
+    float *right;
+    size_t inputCapacity;
+    size_t inputCount;
+} Resampler;
+
+
+#pragma mark - Private Functions
+
+// Zeroth-order modified Bessel function of the first kind
+static double sBesselI0(double x)
+{
+    double sum  = 1.0;
+    double term = 1.0;
+    double halfX = x * 0.5;
+
+    for (int k = 1; k < 64; k++) {
+        term *= (halfX / k) * (halfX / k);
+        sum  += term;
+
+        if (term < (sum * 1e-12)) break;
+    }
+
+    return sum;
+}
+
+
+static double sGetKaiserBeta(double attenuation)
+{
+    if (attenuation > 50.0) {
+        return 0.1102 * (attenuation - 8.7);
+    } else if (attenuation >= 21.0) {
+        return (0.5842 * pow(attenuation - 21.0, 0.4)) + (0.07886 * (attenuation - 21.0));
+    } else {
+        return 0.0;
+    }
+}
+
+
+static void sMakeCoefficients(Resampler *self, const ResamplerTier *tier, double inputSampleRate, double outputSampleRate)
+{
+    size_t tapCount   = tier->tapCount;
+    size_t phaseCount = (size_t)1 << tier->log2PhaseCount;
+
+    double beta = sGetKaiserBeta(tier->attenuation);
+    double i0Beta = sBesselI0(beta);
+
+    // Transition width (Kaiser's estimate), as a fraction of the Nyquist frequency.
+    // The cutoff is placed so that the stopband starts at the lower Nyquist frequency.
+    double transition = (tier->attenuation - 8.0) / (2.285 * (tapCount - 1) * M_PI);
+    double cutoff = (1.0 - (transition * 0.5)) * fmin(1.0, outputSampleRate / inputSampleRate);
+
+    double center = (tapCount / 2) - 1;
+    double halfLength = tapCount / 2;
+
+    double *row = malloc(sizeof(double) * tapCount * (phaseCount + 1));
+
+    for (size_t p = 0; p <= phaseCount; p++) {
+        double *r = &row[p * tapCount];
+        double sum = 0;
+
+        for (size_t k = 0; k < tapCount; k++) {
+            double t = (double)k - center - ((double)p / phaseCount);
+            double x = cutoff * t;
+
+            double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+
+            double ratio = t / halfLength;
+            double window = (fabs(ratio) < 1.0) ? sBesselI0(beta * sqrt(1.0 - ratio * ratio)) / i0Beta : 0.0;
+
+            r[k] = cutoff * sinc * window;
+            sum += r[k];
+        }
+
+        // Unity gain at DC for every phase
+        for (size_t k = 0; k < tapCount; k++) {
+            r[k] /= sum;
+        }
+    }
+
+    for (size_t p = 0; p < phaseCount; p++) {
+        for (size_t k = 0; k < tapCount; k++) {
+            double c0 = row[(p       * tapCount) + k];
+            double c1 = row[((p + 1) * tapCount) + k];
+
+            self->coefficients[(p * tapCount) + k] = c0;
+            self->deltas[(p * tapCount) + k] = c1 - c0;
+        }
+    }
+
+    free(row);
+}
+
+
+static inline __attribute__((always_inline)) float sSum(ResamplerVector v)
+{
+    return (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+
+static void sProcess(Resampler *self, float *outLeft, float *outRight, size_t frameCount)
+{
+    const size_t tapCount  = self->tapCount;
+    const size_t vectorCount = tapCount / sLaneCount;
+    const int phaseShift = sFractionBits - (int)self->log2PhaseCount;
+
+    const uint64_t fractionMask = ((uint64_t)1 << sFractionBits) - 1;
+    const uint64_t phaseMask    = ((uint64_t)1 << phaseShift) - 1;
+    const float phaseScale = 1.0f / (float)((uint64_t)1 << phaseShift);
+
+    uint64_t position = self->position;
+    const uint64_t step = self->step;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        size_t index = (size_t)(position >> sFractionBits);
+        uint64_t fraction = position & fractionMask;
+
+        size_t phase = (size_t)(fraction >> phaseShift);
+        float f = (float)(fraction & phaseMask) * phaseScale;
+
+        const ResamplerVector *c = (const ResamplerVector *)(self->coefficients + (phase * tapCount));
+        const ResamplerVector *d = (const ResamplerVector *)(self->deltas       + (phase * tapCount));
+        const ResamplerVector *l = (const ResamplerVector *)(self->left  + index);
+        const ResamplerVector *r = (const ResamplerVector *)(self->right + index);
+
+        ResamplerVector sumL = { 0 };
+        ResamplerVector sumR = { 0 };
+
+        for (size_t k = 0; k < vectorCount; k++) {
+            ResamplerVector h = c[k] + (d[k] * f);
+
+            sumL += h * l[k];
+            sumR += h * r[k];
+        }
+
+        outLeft[i]  = sSum(sumL);
+        outRight[i] = sSum(sumR);
+
+        position += step;
+    }
+
+    self->position = position;
+}
+
+
+#pragma mark - Public Functions
+
+Resampler *ResamplerCreate(
+    double inputSampleRate,
+    double outputSampleRate,
+    ResamplerQuality quality,
+    ResamplerCallback render,
+    void *context
+) {
+    if (inputSampleRate <= 0 || outputSampleRate <= 0) return NULL;
+
+    if (quality < ResamplerQualityLow)  quality = ResamplerQualityLow;
+    if (quality > ResamplerQualityHigh) quality = ResamplerQualityHigh;
+
+    const ResamplerTier *tier = &sTiers[quality];
+
+    Resampler *self = calloc(1, sizeof(Resampler));
+
+    self->render  = render;
+    self->context = context;
+
+    self->tapCount       = tier->tapCount;
+    self->log2PhaseCount = tier->log2PhaseCount;
+
+    size_t phaseCount = (size_t)1 << tier->log2PhaseCount;
+
+    self->coefficients = calloc(phaseCount * self->tapCount, sizeof(float));
+    self->deltas       = calloc(phaseCount * self->tapCount, sizeof(float));
+
+    sMakeCoefficients(self, tier, inputSampleRate, outputSampleRate);
+
+    double ratio = inputSampleRate / outputSampleRate;
+    self->step = (uint64_t)llround(ratio * (double)((uint64_t)1 << sFractionBits));
+
+    // Room for the filter's history plus the input of one chunk
+    self->inputCapacity = self->tapCount + (size_t)ceil(sChunkFrameCount * ratio) + 2;
+
+    self->left  = calloc(self->inputCapacity, sizeof(float));
+    self->right = calloc(self->inputCapacity, sizeof(float));
+
+    ResamplerReset(self);
+
+    return self;
+}
+
+
+void ResamplerFree(Resampler *self)
+{
+    if (!self) return;
+
+    free(self->coefficients);
+    free(self->deltas);
+    free(self->left);
+    free(self->right);
+
+    free(self);
+}
+
+
+void ResamplerReset(Resampler *self)
+{
+    // Silence before the first input frame, so that output starts aligned with it
+    self->inputCount = (self->tapCount / 2) - 1;
+    self->position = 0;
+
+    memset(self->left,  0, self->inputCapacity * sizeof(float));
+    memset(self->right, 0, self->inputCapacity * sizeof(float));
+}
+
+
+size_t ResamplerGetLatency(Resampler *self)
+{
+    return self->tapCount / 2;
+}
+
+
+void ResamplerRead(Resampler *self, float *left, float *right, size_t frameCount)
+{
+    while (frameCount > 0) {
+        size_t chunkFrameCount = frameCount < sChunkFrameCount ? frameCount : sChunkFrameCount;
+
+        // Pull enough input for the last output frame of this chunk
+        uint64_t lastPosition = self->position + ((chunkFrameCount - 1) * self->step);
+        size_t neededCount = (size_t)(lastPosition >> sFractionBits) + self->tapCount;
+
+        if (neededCount > self->inputCount) {
+            size_t renderCount = neededCount - self->inputCount;
+
+            self->render(self->context, self->left + self->inputCount, self->right + self->inputCount, renderCount);
+            self->inputCount = neededCount;
+        }
+
+        sProcess(self, left, right, chunkFrameCount);
+
+        // Drop input that no later output frame will use
+        size_t consumedCount = (size_t)(self->position >> sFractionBits);
+        if (consumedCount > self->inputCount) consumedCount = self->inputCount;
+
+        size_t remainingCount = self->inputCount - consumedCount;
+
+        memmove(self->left,  self->left  + consumedCount, remainingCount * sizeof(float));
+        memmove(self->right, self->right + consumedCount, remainingCount * sizeof(float));
+
+        self->inputCount = remainingCount;
+        self->position -= (uint64_t)consumedCount << sFractionBits;
+
+        left  += chunkFrameCount;
+        right += chunkFrameCount;
+        frameCount -= chunkFrameCount;
+    }
+}
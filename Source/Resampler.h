@@ -0,0 +1,56 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _RESAMPLER_H_
+#define _RESAMPLER_H_
+
+#include <sys/types.h>
+
+/*
+    Converts a stereo stream from an input (engine) sample rate to an output
+    (device) sample rate using a polyphase windowed-sinc filter.
+
+    The resampler pulls input from the render callback as needed, so it adds
+    no buffering of its own. The filter is a Kaiser-windowed sinc with its
+    cutoff below the lower of the two Nyquist frequencies. Coefficients for
+    fractional positions are interpolated linearly between adjacent phases.
+
+    Quality tiers trade CPU and latency for stopband attenuation:
+
+        Low:     16 taps,  128 phases, about 50 dB
+        Medium:  32 taps,  256 phases, about 80 dB
+        High:    64 taps,  512 phases, about 100 dB
+
+    Latency is half the tap count, in input frames.
+
+    ResamplerRead() does not allocate or lock.
+*/
+
+typedef enum {
+    ResamplerQualityLow    = 0,
+    ResamplerQualityMedium = 1,
+    ResamplerQualityHigh   = 2
+} ResamplerQuality;
+
+typedef struct Resampler Resampler;
+
+typedef void (*ResamplerCallback)(void *context, float *left, float *right, size_t frameCount);
+
+extern Resampler *ResamplerCreate(
+    double inputSampleRate,
+    double outputSampleRate,
+    ResamplerQuality quality,
+    ResamplerCallback render,
+    void *context
+);
+
+extern void ResamplerFree(Resampler *self);
+
+extern void ResamplerReset(Resampler *self);
+
+// In input frames
+extern size_t ResamplerGetLatency(Resampler *self);
+
+extern void ResamplerRead(Resampler *self, float *left, float *right, size_t frameCount);
+
+#endif
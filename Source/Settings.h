@@ -48,5 +48,10 @@ typedef NS_ENUM(NSInteger, IconMode) {
 @property (nonatomic) NSTimeInterval playFadeDuration;
 @property (nonatomic) NSTimeInterval pauseFadeDuration;
 @property (nonatomic) NSTimeInterval muteFadeDuration;
+@property (nonatomic) NSTimeInterval renderAheadDuration;
+@property (nonatomic) BOOL meteringEnabled;
+@property (nonatomic) double engineSampleRate;     // 0 follows the device
+@property (nonatomic) NSInteger resamplerQuality;  // ResamplerQuality
+@property (nonatomic) NSInteger renderWorkerCount; // 0 renders on one thread
 
 @end
@@ -50,7 +50,12 @@ static NSDictionary *sGetDefaultValues(void)
             @"useNowPlayingSPI":  @NO,
             @"playFadeDuration":  @0.1,
             @"pauseFadeDuration": @0.15,
-            @"muteFadeDuration":  @1.0
+            @"muteFadeDuration":  @1.0,
+            @"renderAheadDuration": @0.0,
+            @"meteringEnabled": @NO,
+            @"engineSampleRate": @0.0,
+            @"resamplerQuality": @1,
+            @"renderWorkerCount": @2
         };
     });
 
@@ -0,0 +1,544 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "StreamServer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+
+#pragma mark - Time
+
+static double sGetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+
+static void sSleepUntil(double time)
+{
+    double delta = time - sGetTime();
+    if (delta <= 0) return;
+
+    struct timespec ts;
+    ts.tv_sec  = (time_t)delta;
+    ts.tv_nsec = (long)((delta - ts.tv_sec) * 1e9);
+
+    nanosleep(&ts, NULL);
+}
+
+
+#pragma mark - Deque
+
+/*
+    Chase-Lev work-stealing deque with a fixed capacity. The owner pushes and pops at the
+    bottom, thieves steal from the top. Each stream is in at most one deque at a time,
+    so the capacity never needs to exceed the stream count.
+
+    See "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., 2013)
+*/
+typedef struct Deque {
+    _Atomic(int64_t) top;
+    _Atomic(int64_t) bottom;
+    _Atomic(int32_t) *items;
+    int64_t mask;
+} Deque;
+
+
+static void sDequeInit(Deque *deque, size_t minimumCapacity)
+{
+    size_t capacity = 1;
+    while (capacity < minimumCapacity) capacity <<= 1;
+
+    deque->items = calloc(capacity, sizeof(_Atomic(int32_t)));
+    deque->mask  = capacity - 1;
+
+    atomic_init(&deque->top,    0);
+    atomic_init(&deque->bottom, 0);
+}
+
+
+static void sDequePush(Deque *deque, int32_t item)
+{
+    int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+
+    atomic_store_explicit(&deque->items[b & deque->mask], item, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+
+static bool sDequePop(Deque *deque, int32_t *outItem)
+{
+    int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *outItem = atomic_load_explicit(&deque->items[b & deque->mask], memory_order_relaxed);
+
+    if (t == b) {
+        // Last item, race against thieves
+        bool won = atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+
+    return true;
+}
+
+
+static bool sDequeSteal(Deque *deque, int32_t *outItem)
+{
+    int64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) return false;
+
+    *outItem = atomic_load_explicit(&deque->items[t & deque->mask], memory_order_relaxed);
+
+    return atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+
+#pragma mark - Server
+
+typedef struct Stream {
+    StreamServerRenderCallback render;
+    void *context;
+
+    // Ring of blockCount blocks, each holding blockFrameCount left samples then right samples
+    float *ring;
+
+    _Atomic(uint64_t) writeCount;
+    _Atomic(uint64_t) readCount;
+    _Atomic(uint64_t) underruns;
+    _Atomic(bool) claimed;
+
+    double startTime;
+} Stream;
+
+
+typedef struct Worker {
+    StreamServer *server;
+    pthread_t thread;
+    size_t index;
+
+    Deque deque;
+
+    int32_t *refillItems;
+    double  *refillDeadlines;
+
+    _Atomic(uint64_t) blocksRendered;
+    _Atomic(uint64_t) blocksStolen;
+    _Atomic(uint64_t) deadlineMisses;
+    _Atomic(double)   busyTime;
+    _Atomic(double)   maxLateness;
+} Worker;
+
+
+typedef struct StreamServer {
+    size_t blockFrameCount;
+    size_t ringBlockCount;
+    double period;
+
+    Stream *streams;
+    size_t streamCount;
+    size_t maxStreamCount;
+
+    Worker *workers;
+    size_t workerCount;
+
+    _Atomic(bool) running;
+    double startTime;
+    double stopTime;
+} StreamServer;
+
+
+static double sGetDeadline(StreamServer *server, Stream *stream, uint64_t blockIndex)
+{
+    // Every underrun pushes the consumer's schedule back by one block
+    uint64_t underruns = atomic_load_explicit(&stream->underruns, memory_order_relaxed);
+    return stream->startTime + ((blockIndex + underruns) * server->period);
+}
+
+
+static bool sIsReady(StreamServer *server, Stream *stream)
+{
+    uint64_t writeCount = atomic_load_explicit(&stream->writeCount, memory_order_acquire);
+    uint64_t readCount  = atomic_load_explicit(&stream->readCount,  memory_order_acquire);
+
+    return (writeCount - readCount) < server->ringBlockCount;
+}
+
+
+static void sRenderBlock(StreamServer *server, Worker *worker, int32_t streamIndex)
+{
+    Stream *stream = &server->streams[streamIndex];
+    size_t blockFrameCount = server->blockFrameCount;
+
+    uint64_t writeCount = atomic_load_explicit(&stream->writeCount, memory_order_relaxed);
+    double deadline = sGetDeadline(server, stream, writeCount);
+
+    float *left  = stream->ring + ((writeCount % server->ringBlockCount) * blockFrameCount * 2);
+    float *right = left + blockFrameCount;
+
+    double startTime = sGetTime();
+    stream->render(stream->context, left, right, blockFrameCount);
+    double endTime = sGetTime();
+
+    atomic_store_explicit(&stream->writeCount, writeCount + 1, memory_order_release);
+    atomic_store_explicit(&stream->claimed, false, memory_order_release);
+
+    // Stats are only written by this worker
+    atomic_store_explicit(&worker->blocksRendered, atomic_load_explicit(&worker->blocksRendered, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&worker->busyTime, atomic_load_explicit(&worker->busyTime, memory_order_relaxed) + (endTime - startTime), memory_order_relaxed);
+
+    if (endTime > deadline) {
+        double lateness = endTime - deadline;
+
+        atomic_store_explicit(&worker->deadlineMisses, atomic_load_explicit(&worker->deadlineMisses, memory_order_relaxed) + 1, memory_order_relaxed);
+
+        if (lateness > atomic_load_explicit(&worker->maxLateness, memory_order_relaxed)) {
+            atomic_store_explicit(&worker->maxLateness, lateness, memory_order_relaxed);
+        }
+    }
+}
+
+
+/*
+    Claims every ready stream owned by this worker and pushes them so that the
+    earliest deadline is at the bottom (popped first by the owner) and the latest
+    deadline is at the top (stolen first by other workers).
+*/
+static bool sRefill(StreamServer *server, Worker *worker)
+{
+    size_t count = 0;
+
+    for (size_t s = worker->index; s < server->streamCount; s += server->workerCount) {
+        Stream *stream = &server->streams[s];
+
+        if (!sIsReady(server, stream)) continue;
+        if (atomic_exchange_explicit(&stream->claimed, true, memory_order_acquire)) continue;
+
+        // Another worker may have filled the ring between the check and the claim
+        if (!sIsReady(server, stream)) {
+            atomic_store_explicit(&stream->claimed, false, memory_order_release);
+            continue;
+        }
+
+        uint64_t writeCount = atomic_load_explicit(&stream->writeCount, memory_order_relaxed);
+        double deadline = sGetDeadline(server, stream, writeCount);
+
+        // Insertion sort, latest deadline first. Worker stream counts are small.
+        size_t i = count++;
+        while (i > 0 && worker->refillDeadlines[i - 1] < deadline) {
+            worker->refillDeadlines[i] = worker->refillDeadlines[i - 1];
+            worker->refillItems[i]     = worker->refillItems[i - 1];
+            i--;
+        }
+
+        worker->refillDeadlines[i] = deadline;
+        worker->refillItems[i]     = (int32_t)s;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        sDequePush(&worker->deque, worker->refillItems[i]);
+    }
+
+    return count > 0;
+}
+
+
+static bool sSteal(StreamServer *server, Worker *worker, int32_t *outItem)
+{
+    size_t workerCount = server->workerCount;
+
+    for (size_t i = 1; i < workerCount; i++) {
+        Worker *victim = &server->workers[(worker->index + i) % workerCount];
+
+        if (sDequeSteal(&victim->deque, outItem)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static void *sWorkerMain(void *context)
+{
+    Worker *worker = context;
+    StreamServer *server = worker->server;
+
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(worker->index % CPU_SETSIZE, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#endif
+
+    double idleSleep = server->period / 8;
+
+    while (atomic_load_explicit(&server->running, memory_order_acquire)) {
+        int32_t item;
+
+        if (sDequePop(&worker->deque, &item)) {
+            sRenderBlock(server, worker, item);
+
+        } else if (sRefill(server, worker)) {
+            continue;
+
+        } else if (sSteal(server, worker, &item)) {
+            atomic_store_explicit(&worker->blocksStolen, atomic_load_explicit(&worker->blocksStolen, memory_order_relaxed) + 1, memory_order_relaxed);
+            sRenderBlock(server, worker, item);
+
+        } else {
+            sSleepUntil(sGetTime() + idleSleep);
+        }
+    }
+
+    return NULL;
+}
+
+
+#pragma mark - Public Functions
+
+StreamServer *StreamServerCreate(
+    size_t workerCount,
+    size_t maxStreamCount,
+    size_t blockFrameCount,
+    size_t ringBlockCount,
+    double sampleRate
+) {
+    if (workerCount == 0) {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cpuCount > 0 ? cpuCount : 1;
+    }
+
+    if (ringBlockCount < 2) ringBlockCount = 2;
+
+    StreamServer *self = calloc(1, sizeof(StreamServer));
+
+    self->blockFrameCount = blockFrameCount;
+    self->ringBlockCount  = ringBlockCount;
+    self->period          = blockFrameCount / sampleRate;
+
+    self->maxStreamCount = maxStreamCount;
+    self->streams        = calloc(maxStreamCount, sizeof(Stream));
+
+    self->workerCount = workerCount;
+    self->workers     = calloc(workerCount, sizeof(Worker));
+
+    for (size_t i = 0; i < workerCount; i++) {
+        Worker *worker = &self->workers[i];
+
+        worker->server = self;
+        worker->index  = i;
+        worker->refillItems     = malloc(sizeof(int32_t) * maxStreamCount);
+        worker->refillDeadlines = malloc(sizeof(double)  * maxStreamCount);
+
+        sDequeInit(&worker->deque, maxStreamCount);
+    }
+
+    return self;
+}
+
+
+void StreamServerFree(StreamServer *self)
+{
+    if (!self) return;
+
+    StreamServerStop(self);
+
+    for (size_t i = 0; i < self->streamCount; i++) {
+        free(self->streams[i].ring);
+    }
+
+    for (size_t i = 0; i < self->workerCount; i++) {
+        free(self->workers[i].deque.items);
+        free(self->workers[i].refillItems);
+        free(self->workers[i].refillDeadlines);
+    }
+
+    free(self->streams);
+    free(self->workers);
+    free(self);
+}
+
+
+ssize_t StreamServerAddStream(StreamServer *self, StreamServerRenderCallback render, void *context)
+{
+    if (atomic_load(&self->running)) return -1;
+    if (self->streamCount >= self->maxStreamCount) return -1;
+
+    Stream *stream = &self->streams[self->streamCount];
+
+    stream->render  = render;
+    stream->context = context;
+    stream->ring    = calloc(self->ringBlockCount * self->blockFrameCount * 2, sizeof(float));
+
+    return (ssize_t)self->streamCount++;
+}
+
+
+void StreamServerStart(StreamServer *self)
+{
+    if (atomic_load(&self->running)) return;
+
+    double now = sGetTime();
+
+    // Give every ring one full ring of lead time, and stagger consumers across the period
+    for (size_t i = 0; i < self->streamCount; i++) {
+        Stream *stream = &self->streams[i];
+
+        atomic_store(&stream->writeCount, 0);
+        atomic_store(&stream->readCount,  0);
+        atomic_store(&stream->underruns,  0);
+        atomic_store(&stream->claimed,    false);
+
+        stream->startTime = now + (self->ringBlockCount * self->period) + ((self->period * i) / self->streamCount);
+    }
+
+    for (size_t i = 0; i < self->workerCount; i++) {
+        Worker *worker = &self->workers[i];
+
+        atomic_store(&worker->deque.top,    0);
+        atomic_store(&worker->deque.bottom, 0);
+
+        atomic_store(&worker->blocksRendered, 0);
+        atomic_store(&worker->blocksStolen,   0);
+        atomic_store(&worker->deadlineMisses, 0);
+        atomic_store(&worker->busyTime,       0);
+        atomic_store(&worker->maxLateness,    0);
+    }
+
+    self->startTime = now;
+    self->stopTime  = 0;
+
+    atomic_store(&self->running, true);
+
+    for (size_t i = 0; i < self->workerCount; i++) {
+        pthread_create(&self->workers[i].thread, NULL, sWorkerMain, &self->workers[i]);
+    }
+}
+
+
+void StreamServerStop(StreamServer *self)
+{
+    if (!atomic_exchange(&self->running, false)) return;
+
+    for (size_t i = 0; i < self->workerCount; i++) {
+        pthread_join(self->workers[i].thread, NULL);
+    }
+
+    self->stopTime = sGetTime();
+}
+
+
+bool StreamServerReadBlock(StreamServer *self, size_t streamIndex, float *left, float *right)
+{
+    Stream *stream = &self->streams[streamIndex];
+    size_t blockFrameCount = self->blockFrameCount;
+
+    uint64_t readCount  = atomic_load_explicit(&stream->readCount,  memory_order_relaxed);
+    uint64_t writeCount = atomic_load_explicit(&stream->writeCount, memory_order_acquire);
+
+    if (readCount == writeCount) {
+        memset(left,  0, sizeof(float) * blockFrameCount);
+        memset(right, 0, sizeof(float) * blockFrameCount);
+
+        atomic_fetch_add_explicit(&stream->underruns, 1, memory_order_relaxed);
+
+        return false;
+    }
+
+    float *block = stream->ring + ((readCount % self->ringBlockCount) * blockFrameCount * 2);
+
+    memcpy(left,  block,                   sizeof(float) * blockFrameCount);
+    memcpy(right, block + blockFrameCount, sizeof(float) * blockFrameCount);
+
+    atomic_store_explicit(&stream->readCount, readCount + 1, memory_order_release);
+
+    return true;
+}
+
+
+void StreamServerGetStats(StreamServer *self, StreamServerStats *outStats)
+{
+    StreamServerStats stats = {0};
+
+    for (size_t i = 0; i < self->workerCount; i++) {
+        Worker *worker = &self->workers[i];
+
+        stats.blocksRendered += atomic_load_explicit(&worker->blocksRendered, memory_order_relaxed);
+        stats.blocksStolen   += atomic_load_explicit(&worker->blocksStolen,   memory_order_relaxed);
+        stats.deadlineMisses += atomic_load_explicit(&worker->deadlineMisses, memory_order_relaxed);
+        stats.busyTime       += atomic_load_explicit(&worker->busyTime,       memory_order_relaxed);
+
+        double maxLateness = atomic_load_explicit(&worker->maxLateness, memory_order_relaxed);
+        if (maxLateness > stats.maxLateness) stats.maxLateness = maxLateness;
+    }
+
+    for (size_t i = 0; i < self->streamCount; i++) {
+        stats.underruns += atomic_load_explicit(&self->streams[i].underruns, memory_order_relaxed);
+    }
+
+    double endTime = atomic_load(&self->running) ? sGetTime() : self->stopTime;
+    stats.elapsedTime = self->startTime ? (endTime - self->startTime) : 0;
+
+    *outStats = stats;
+}
+
+
+void StreamServerRunLoadTest(StreamServer *self, double duration, StreamServerStats *outStats)
+{
+    size_t blockFrameCount = self->blockFrameCount;
+    size_t streamCount = self->streamCount;
+
+    float *left  = malloc(sizeof(float) * blockFrameCount);
+    float *right = malloc(sizeof(float) * blockFrameCount);
+
+    StreamServerStart(self);
+
+    double endTime = self->startTime + duration;
+
+    // Stream start times are staggered in index order, so reading streams in order
+    // visits every simulated device callback in time order.
+    for (uint64_t block = 0; streamCount > 0; block++) {
+        double blockTime = block * self->period;
+
+        if (self->streams[0].startTime + blockTime > endTime) break;
+
+        for (size_t i = 0; i < streamCount; i++) {
+            sSleepUntil(self->streams[i].startTime + blockTime);
+            StreamServerReadBlock(self, i, left, right);
+        }
+    }
+
+    StreamServerStop(self);
+    StreamServerGetStats(self, outStats);
+
+    free(left);
+    free(right);
+}
@@ -0,0 +1,68 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _STREAM_SERVER_H_
+#define _STREAM_SERVER_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Renders many independent streams on a pool of worker threads.
+
+    Each stream owns a lock-free ring of output blocks. A stream's consumer is expected to
+    read one block every buffer period; block j of a stream must therefore be rendered before
+    that stream's j-th read. Workers keep a work-stealing deque of "render the next block
+    for stream S" tasks, refill it in earliest-deadline-first order from the streams they
+    own, and steal the latest-deadline tasks from other workers when idle.
+
+    The render callback has the same shape as NoisyProgramProcess(), which may be passed
+    directly (cast to StreamServerRenderCallback) along with its NoisyProgram.
+*/
+
+typedef struct StreamServer StreamServer;
+
+typedef void (*StreamServerRenderCallback)(void *context, float *left, float *right, size_t frameCount);
+
+typedef struct StreamServerStats {
+    uint64_t blocksRendered;
+    uint64_t blocksStolen;
+    uint64_t deadlineMisses; // Blocks finished after their deadline
+    uint64_t underruns;      // Reads which found an empty ring
+    double   busyTime;       // Seconds spent in render callbacks, summed across workers
+    double   elapsedTime;    // Seconds since StreamServerStart()
+    double   maxLateness;    // Largest deadline miss, in seconds
+} StreamServerStats;
+
+// A workerCount of 0 uses one worker per online CPU
+extern StreamServer *StreamServerCreate(
+    size_t workerCount,
+    size_t maxStreamCount,
+    size_t blockFrameCount,
+    size_t ringBlockCount,
+    double sampleRate
+);
+
+extern void StreamServerFree(StreamServer *self);
+
+// Streams may only be added while the server is stopped. Returns the stream index or -1.
+extern ssize_t StreamServerAddStream(StreamServer *self, StreamServerRenderCallback render, void *context);
+
+extern void StreamServerStart(StreamServer *self);
+extern void StreamServerStop(StreamServer *self);
+
+// Consumer side. Copies the next block into left/right (blockFrameCount samples each).
+// Returns false and writes silence on underrun. Only one consumer per stream.
+extern bool StreamServerReadBlock(StreamServer *self, size_t streamIndex, float *left, float *right);
+
+extern void StreamServerGetStats(StreamServer *self, StreamServerStats *outStats);
+
+/*
+    Synthetic load generator. Starts the server, simulates one device per stream (reading a
+    block every buffer period, staggered across the period), runs for the given duration,
+    stops the server, and reports statistics.
+*/
+extern void StreamServerRunLoadTest(StreamServer *self, double duration, StreamServerStats *outStats);
+
+#endif
@@ -0,0 +1,421 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "WavWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/param.h>
+
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error WavWriter assumes a little-endian host
+#endif
+
+
+static const size_t sTargetBufferSize = 4 * 1024 * 1024;
+static const size_t sPageSize         = 4096;
+static const size_t sMaxHeaderSize    = 96;
+
+// An enum rather than a static const, as it sizes an array in WavWriter
+enum { sLaneCount = 8 };
+
+
+typedef struct WavWriter {
+    int fd;
+
+    size_t channelCount;
+    uint32_t sampleRate;
+    WavWriterFormat format;
+    size_t bytesPerSample;
+    bool dither;
+
+    size_t headerSize;
+
+    uint8_t *buffer;
+    size_t bufferSize;
+    size_t bufferLength;
+
+    uint64_t fileOffset;  // Where the buffer will be written
+    uint64_t dataSize;
+
+    // One xorshift32 state per lane, so that the dither loops vectorize
+    uint32_t randomStates[sLaneCount];
+} WavWriter;
+
+
+#pragma mark - Header
+
+static void sPutUInt16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+}
+
+
+static void sPutUInt32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8)  & 0xff;
+    bytes[2] = (value >> 16) & 0xff;
+    bytes[3] = (value >> 24) & 0xff;
+}
+
+
+static void sPutUInt64(uint8_t *bytes, uint64_t value)
+{
+    sPutUInt32(bytes,     (uint32_t)(value & 0xffffffff));
+    sPutUInt32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+
+/*
+    RIFF/WAVE      12 bytes
+    JUNK or ds64   36 bytes (RF64 size table)
+    fmt            24 bytes, or 26 for float
+    fact           12 bytes, float only
+    data            8 bytes, then samples
+
+    Returns the header size.
+*/
+static size_t sMakeHeader(WavWriter *self, uint8_t *header, uint64_t dataSize)
+{
+    bool isFloat = (self->format == WavWriterFormatFloat32);
+
+    size_t blockAlign = self->bytesPerSample * self->channelCount;
+    uint64_t frameCount = dataSize / blockAlign;
+
+    size_t fmtSize    = isFloat ? 18 : 16;
+    size_t headerSize = 12 + 36 + (8 + fmtSize) + (isFloat ? 12 : 0) + 8;
+
+    // The data chunk is padded to an even size
+    uint64_t riffSize = (headerSize - 8) + dataSize + (dataSize & 1);
+    bool isRF64 = riffSize > UINT32_MAX;
+
+    uint8_t *p = header;
+
+    memcpy(p, isRF64 ? "RF64" : "RIFF", 4);
+    sPutUInt32(p + 4, isRF64 ? UINT32_MAX : (uint32_t)riffSize);
+    memcpy(p + 8, "WAVE", 4);
+    p += 12;
+
+    memcpy(p, isRF64 ? "ds64" : "JUNK", 4);
+    sPutUInt32(p + 4, 28);
+    memset(p + 8, 0, 28);
+
+    if (isRF64) {
+        sPutUInt64(p +  8, riffSize);
+        sPutUInt64(p + 16, dataSize);
+        sPutUInt64(p + 24, frameCount);
+        sPutUInt32(p + 32, 0); // Table length
+    }
+
+    p += 36;
+
+    memcpy(p, "fmt ", 4);
+    sPutUInt32(p +  4, (uint32_t)fmtSize);
+    sPutUInt16(p +  8, isFloat ? 3 : 1); // WAVE_FORMAT_IEEE_FLOAT or WAVE_FORMAT_PCM
+    sPutUInt16(p + 10, (uint16_t)self->channelCount);
+    sPutUInt32(p + 12, self->sampleRate);
+    sPutUInt32(p + 16, (uint32_t)(self->sampleRate * blockAlign));
+    sPutUInt16(p + 20, (uint16_t)blockAlign);
+    sPutUInt16(p + 22, (uint16_t)(self->bytesPerSample * 8));
+    if (isFloat) sPutUInt16(p + 24, 0);
+    p += 8 + fmtSize;
+
+    if (isFloat) {
+        memcpy(p, "fact", 4);
+        sPutUInt32(p + 4, 4);
+        sPutUInt32(p + 8, isRF64 ? UINT32_MAX : (uint32_t)frameCount);
+        p += 12;
+    }
+
+    memcpy(p, "data", 4);
+    sPutUInt32(p + 4, isRF64 ? UINT32_MAX : (uint32_t)dataSize);
+    p += 8;
+
+    return p - header;
+}
+
+
+static bool sWriteFully(int fd, const uint8_t *bytes, size_t length, uint64_t offset)
+{
+    while (length > 0) {
+        ssize_t written = pwrite(fd, bytes, length, (off_t)offset);
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        bytes  += written;
+        length -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+
+static bool sWriteBuffer(WavWriter *self)
+{
+    if (self->bufferLength == 0) return true;
+
+    if (!sWriteFully(self->fd, self->buffer, self->bufferLength, self->fileOffset)) {
+        return false;
+    }
+
+    self->fileOffset  += self->bufferLength;
+    self->bufferLength = 0;
+
+    return true;
+}
+
+
+#pragma mark - Conversion
+
+static inline float sNextDither(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+
+    // Sum of two uniform variables in [0, 1), shifted to a triangle over (-1, 1)
+    return (((float)(x & 0xffff) + (float)(x >> 16)) * (1.0f / 65536.0f)) - 1.0f;
+}
+
+
+static inline int32_t sQuantize(float sample, float scale, float dither)
+{
+    float value = (sample * scale) + dither;
+
+    value = fmaxf(value, -scale);
+    value = fminf(value, scale - 1.0f);
+
+    return (int32_t)lrintf(value);
+}
+
+
+// output is the first sample of this channel; stride is the frame size in samples
+static void sConvertToInt16(WavWriter *self, const float *input, int16_t *output, size_t stride, size_t frameCount)
+{
+    uint32_t *states = self->randomStates;
+    float ditherScale = self->dither ? 1.0f : 0.0f;
+    size_t i = 0;
+
+    for (; (i + sLaneCount) <= frameCount; i += sLaneCount) {
+        for (size_t lane = 0; lane < sLaneCount; lane++) {
+            float dither = sNextDither(&states[lane]) * ditherScale;
+            output[(i + lane) * stride] = (int16_t)sQuantize(input[i + lane], 32768.0f, dither);
+        }
+    }
+
+    for (size_t lane = 0; i < frameCount; i++, lane++) {
+        float dither = sNextDither(&states[lane]) * ditherScale;
+        output[i * stride] = (int16_t)sQuantize(input[i], 32768.0f, dither);
+    }
+}
+
+
+// output is the first byte of this channel; stride is the frame size in bytes
+static void sConvertToInt24(WavWriter *self, const float *input, uint8_t *output, size_t stride, size_t frameCount)
+{
+    uint32_t *states = self->randomStates;
+    float ditherScale = self->dither ? 1.0f : 0.0f;
+    size_t i = 0;
+
+    for (; (i + sLaneCount) <= frameCount; i += sLaneCount) {
+        for (size_t lane = 0; lane < sLaneCount; lane++) {
+            float dither = sNextDither(&states[lane]) * ditherScale;
+            int32_t value = sQuantize(input[i + lane], 8388608.0f, dither);
+
+            uint8_t *bytes = output + ((i + lane) * stride);
+            bytes[0] = value & 0xff;
+            bytes[1] = (value >> 8)  & 0xff;
+            bytes[2] = (value >> 16) & 0xff;
+        }
+    }
+
+    for (size_t lane = 0; i < frameCount; i++, lane++) {
+        float dither = sNextDither(&states[lane]) * ditherScale;
+        int32_t value = sQuantize(input[i], 8388608.0f, dither);
+
+        uint8_t *bytes = output + (i * stride);
+        bytes[0] = value & 0xff;
+        bytes[1] = (value >> 8)  & 0xff;
+        bytes[2] = (value >> 16) & 0xff;
+    }
+}
+
+
+static void sConvertToFloat32(const float *input, float *output, size_t stride, size_t frameCount)
+{
+    if (stride == 1) {
+        memcpy(output, input, frameCount * sizeof(float));
+    } else {
+        for (size_t i = 0; i < frameCount; i++) {
+            output[i * stride] = input[i];
+        }
+    }
+}
+
+
+static void sConvert(WavWriter *self, const float *left, const float *right, uint8_t *output, size_t frameCount)
+{
+    size_t channelCount = self->channelCount;
+
+    for (size_t c = 0; c < channelCount; c++) {
+        const float *input = (c == 0) ? left : right;
+
+        if (self->format == WavWriterFormatInt16) {
+            sConvertToInt16(self, input, (int16_t *)output + c, channelCount, frameCount);
+        } else if (self->format == WavWriterFormatInt24) {
+            sConvertToInt24(self, input, output + (c * 3), channelCount * 3, frameCount);
+        } else {
+            sConvertToFloat32(input, (float *)output + c, channelCount, frameCount);
+        }
+    }
+}
+
+
+#pragma mark - Public Functions
+
+WavWriter *WavWriterCreate(
+    const char *path,
+    double sampleRate,
+    size_t channelCount,
+    WavWriterFormat format,
+    bool dither
+) {
+    if (channelCount < 1 || channelCount > 2 || sampleRate <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+
+    WavWriter *self = calloc(1, sizeof(WavWriter));
+
+    self->fd           = fd;
+    self->channelCount = channelCount;
+    self->sampleRate   = (uint32_t)lround(sampleRate);
+    self->format       = format;
+    self->dither       = dither && (format != WavWriterFormatFloat32);
+
+    self->bytesPerSample =
+        format == WavWriterFormatInt16 ? 2 :
+        format == WavWriterFormatInt24 ? 3 :
+        4;
+
+    // A whole number of both pages and frames
+    size_t unit = sPageSize * self->bytesPerSample * channelCount;
+    self->bufferSize = MAX(sTargetBufferSize / unit, 1) * unit;
+
+    if (posix_memalign((void **)&self->buffer, sPageSize, self->bufferSize) != 0) {
+        close(fd);
+        free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (size_t lane = 0; lane < sLaneCount; lane++) {
+        self->randomStates[lane] = 0x9E3779B9u * (uint32_t)(lane + 1);
+    }
+
+    uint8_t header[sMaxHeaderSize];
+    self->headerSize = sMakeHeader(self, header, 0);
+    self->fileOffset = self->headerSize;
+
+    if (!sWriteFully(fd, header, self->headerSize, 0)) {
+        int error = errno;
+
+        close(fd);
+        free(self->buffer);
+        free(self);
+
+        errno = error;
+        return NULL;
+    }
+
+    return self;
+}
+
+
+bool WavWriterWrite(WavWriter *self, const float *left, const float *right, size_t frameCount)
+{
+    size_t frameSize = self->bytesPerSample * self->channelCount;
+
+    while (frameCount > 0) {
+        size_t available = (self->bufferSize - self->bufferLength) / frameSize;
+
+        if (available == 0) {
+            if (!sWriteBuffer(self)) return false;
+            continue;
+        }
+
+        size_t framesToWrite = MIN(frameCount, available);
+
+        sConvert(self, left, right, self->buffer + self->bufferLength, framesToWrite);
+
+        self->bufferLength += framesToWrite * frameSize;
+        self->dataSize     += framesToWrite * frameSize;
+
+        left += framesToWrite;
+        if (right) right += framesToWrite;
+
+        frameCount -= framesToWrite;
+    }
+
+    return true;
+}
+
+
+bool WavWriterFlush(WavWriter *self)
+{
+    if (!sWriteBuffer(self)) return false;
+
+    // Pad byte. Overwritten by the next samples, if any.
+    if (self->dataSize & 1) {
+        uint8_t zero = 0;
+        if (!sWriteFully(self->fd, &zero, 1, self->fileOffset)) return false;
+    }
+
+    uint8_t header[sMaxHeaderSize];
+    size_t headerSize = sMakeHeader(self, header, self->dataSize);
+
+    return sWriteFully(self->fd, header, headerSize, 0);
+}
+
+
+bool WavWriterClose(WavWriter *self)
+{
+    if (!self) return true;
+
+    bool result = WavWriterFlush(self);
+    int error = errno;
+
+    if (close(self->fd) != 0 && result) {
+        result = false;
+        error = errno;
+    }
+
+    free(self->buffer);
+    free(self);
+
+    errno = error;
+    return result;
+}
+
+
+uint64_t WavWriterGetFrameCount(WavWriter *self)
+{
+    return self->dataSize / (self->bytesPerSample * self->channelCount);
+}
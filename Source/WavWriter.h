@@ -0,0 +1,52 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _WAV_WRITER_H_
+#define _WAV_WRITER_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Streaming WAV writer for 16-bit, 24-bit, and 32-bit float files.
+
+    Samples are interleaved and converted into a large page-aligned buffer,
+    which is written with pwrite() once full. Integer formats use TPDF
+    dither (two uniform variables, +/- 1 LSB peak) unless disabled.
+
+    A JUNK chunk reserves room for a "ds64" chunk. If the file grows past
+    the 4 GB limit of RIFF, it is promoted to RF64 (EBU Tech 3306) when
+    flushed or closed.
+
+    Functions return false on failure, with errno set.
+*/
+
+typedef struct WavWriter WavWriter;
+
+typedef enum {
+    WavWriterFormatInt16,
+    WavWriterFormatInt24,
+    WavWriterFormatFloat32
+} WavWriterFormat;
+
+extern WavWriter *WavWriterCreate(
+    const char *path,
+    double sampleRate,
+    size_t channelCount,
+    WavWriterFormat format,
+    bool dither
+);
+
+// right is ignored for mono files
+extern bool WavWriterWrite(WavWriter *self, const float *left, const float *right, size_t frameCount);
+
+// Writes buffered samples and updates the header, leaving a complete file
+extern bool WavWriterFlush(WavWriter *self);
+
+// Flushes, closes, and frees the writer
+extern bool WavWriterClose(WavWriter *self);
+
+extern uint64_t WavWriterGetFrameCount(WavWriter *self);
+
+#endif
@@ -0,0 +1,388 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#include "WorkerPool.h"
+#include "FloatingPoint.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <dispatch/dispatch.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+
+
+// Time spent polling before a worker sleeps, or before the render thread waits:
+// a small fraction of the period, and never more than a few microseconds
+static const double sMaxSpinDuration    = 5e-6;
+static const double sSpinPeriodFraction = 0.01;
+
+// How often a waiting render thread rechecks the job, as a fraction of the period
+static const double sWaitPeriodFraction = 0.25;
+
+// Used until WorkerPoolSetPeriod() is called
+static const double sDefaultPeriod = 0.004;
+
+// State word layout: sequence (32 bits) | task count (16 bits) | next index (16 bits)
+static const uint64_t sFieldMask = 0xffff;
+static const size_t sMaxTaskCount = 0xffff;
+
+
+typedef struct WorkerPoolJob {
+    WorkerPoolFunction function;
+    void *context;
+} WorkerPoolJob;
+
+
+typedef struct WorkerPool {
+    size_t threadCount;
+    pthread_t *threads;
+
+    _Atomic(uint64_t) state;
+    _Atomic(size_t) doneCount;
+    _Atomic(bool) busy;
+
+    // Indexed by the low bit of the sequence. A slot is only rewritten two
+    // jobs later, after every task that could read it has finished.
+    WorkerPoolJob jobs[2];
+    uint32_t sequence;
+
+    _Atomic(int) sleepingCount;
+    dispatch_semaphore_t wakeSemaphore;
+
+    _Atomic(bool) callerWaiting;
+    dispatch_semaphore_t doneSemaphore;
+
+    // Set by WorkerPoolSetPeriod()
+    _Atomic(uint64_t) spinTicks;
+    _Atomic(int64_t) waitNanoseconds;
+
+    pthread_mutex_t workgroupMutex;
+    os_workgroup_t workgroup;
+    _Atomic(uint64_t) workgroupGeneration;
+
+    _Atomic(bool) quit;
+} WorkerPool;
+
+
+#pragma mark - Private Functions
+
+static inline void sPause(void)
+{
+#if defined(__arm64__)
+    __builtin_arm_yield();
+#elif defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+
+static double sGetTicksPerSecond(void)
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+
+    return (1e9 * timebase.denom) / timebase.numer;
+}
+
+
+static void sSetRealTimePolicy(void)
+{
+    double ticksPerMillisecond = sGetTicksPerSecond() / 1000.0;
+
+    // Aperiodic, like the audio device thread. Workers also join the device's
+    // workgroup when one is available, which informs the scheduler's deadlines.
+    struct thread_time_constraint_policy policy = {
+        .period      = 0,
+        .computation = (uint32_t)(0.5 * ticksPerMillisecond),
+        .constraint  = (uint32_t)(2.5 * ticksPerMillisecond),
+        .preemptible = true
+    };
+
+    thread_policy_set(
+        pthread_mach_thread_np(pthread_self()),
+        THREAD_TIME_CONSTRAINT_POLICY,
+        (thread_policy_t)&policy,
+        THREAD_TIME_CONSTRAINT_POLICY_COUNT
+    );
+}
+
+
+static bool sHasTask(WorkerPool *self)
+{
+    uint64_t state = atomic_load_explicit(&self->state, memory_order_relaxed);
+    return (state & sFieldMask) < ((state >> 16) & sFieldMask);
+}
+
+
+static bool sIsDone(WorkerPool *self, size_t count)
+{
+    return atomic_load_explicit(&self->doneCount, memory_order_acquire) == count;
+}
+
+
+// Claims and runs tasks of the current job until none are left. Returns true if any ran.
+static bool sRunTasks(WorkerPool *self)
+{
+    bool ranTask = false;
+    uint64_t state = atomic_load_explicit(&self->state, memory_order_acquire);
+
+    while (true) {
+        uint64_t index = state & sFieldMask;
+        uint64_t count = (state >> 16) & sFieldMask;
+
+        if (index >= count) break;
+
+        if (!atomic_compare_exchange_weak_explicit(
+            &self->state, &state, state + 1,
+            memory_order_acquire, memory_order_acquire
+        )) {
+            continue;
+        }
+
+        WorkerPoolJob *job = &self->jobs[(state >> 32) & 1];
+        job->function(job->context, (size_t)index);
+        ranTask = true;
+
+        size_t doneCount = atomic_fetch_add(&self->doneCount, 1) + 1;
+
+        if (doneCount == count && atomic_load(&self->callerWaiting)) {
+            dispatch_semaphore_signal(self->doneSemaphore);
+        }
+
+        state = atomic_load_explicit(&self->state, memory_order_acquire);
+    }
+
+    return ranTask;
+}
+
+
+static void sUpdateWorkgroup(
+    WorkerPool *self,
+    uint64_t *inOutGeneration,
+    os_workgroup_t *inOutWorkgroup,
+    os_workgroup_join_token_s *token
+) {
+    uint64_t generation = atomic_load_explicit(&self->workgroupGeneration, memory_order_acquire);
+    if (generation == *inOutGeneration) return;
+
+    if (*inOutWorkgroup) {
+        os_workgroup_leave(*inOutWorkgroup, token);
+        os_release(*inOutWorkgroup);
+        *inOutWorkgroup = NULL;
+    }
+
+    pthread_mutex_lock(&self->workgroupMutex);
+    os_workgroup_t workgroup = self->workgroup;
+    if (workgroup) os_retain(workgroup);
+    pthread_mutex_unlock(&self->workgroupMutex);
+
+    if (workgroup && os_workgroup_join(workgroup, token) != 0) {
+        os_release(workgroup);
+        workgroup = NULL;
+    }
+
+    *inOutWorkgroup = workgroup;
+    *inOutGeneration = generation;
+}
+
+
+static void *sWorkerMain(void *context)
+{
+    WorkerPool *self = context;
+
+    sSetRealTimePolicy();
+
+    FloatingPointState floatingPointState;
+    FloatingPointEnableFlushToZero(&floatingPointState);
+
+    uint64_t workgroupGeneration = 0;
+    os_workgroup_t workgroup = NULL;
+    os_workgroup_join_token_s token;
+
+    while (!atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+        sUpdateWorkgroup(self, &workgroupGeneration, &workgroup, &token);
+
+        if (sRunTasks(self)) continue;
+
+        bool hasTask = false;
+        uint64_t spinEnd = mach_absolute_time() + atomic_load_explicit(&self->spinTicks, memory_order_relaxed);
+
+        do {
+            if (sHasTask(self) || atomic_load_explicit(&self->quit, memory_order_relaxed)) {
+                hasTask = true;
+                break;
+            }
+
+            sPause();
+        } while (mach_absolute_time() < spinEnd);
+
+        if (hasTask) continue;
+
+        // Recheck after announcing, so that a job published in between isn't missed
+        atomic_fetch_add(&self->sleepingCount, 1);
+
+        if (!sHasTask(self) && !atomic_load(&self->quit)) {
+            dispatch_semaphore_wait(self->wakeSemaphore, DISPATCH_TIME_FOREVER);
+        }
+
+        atomic_fetch_sub(&self->sleepingCount, 1);
+    }
+
+    if (workgroup) {
+        os_workgroup_leave(workgroup, &token);
+        os_release(workgroup);
+    }
+
+    FloatingPointRestore(&floatingPointState);
+
+    return NULL;
+}
+
+
+#pragma mark - Public Functions
+
+WorkerPool *WorkerPoolCreate(size_t threadCount)
+{
+    WorkerPool *self = calloc(1, sizeof(WorkerPool));
+
+    self->threadCount = threadCount;
+    self->threads = calloc(threadCount + 1, sizeof(pthread_t));
+
+    self->wakeSemaphore = dispatch_semaphore_create(0);
+    self->doneSemaphore = dispatch_semaphore_create(0);
+
+    pthread_mutex_init(&self->workgroupMutex, NULL);
+
+    WorkerPoolSetPeriod(self, sDefaultPeriod);
+
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_create(&self->threads[i], NULL, sWorkerMain, self);
+    }
+
+    return self;
+}
+
+
+void WorkerPoolFree(WorkerPool *self)
+{
+    if (!self) return;
+
+    atomic_store(&self->quit, true);
+
+    for (size_t i = 0; i < self->threadCount; i++) {
+        dispatch_semaphore_signal(self->wakeSemaphore);
+    }
+
+    for (size_t i = 0; i < self->threadCount; i++) {
+        pthread_join(self->threads[i], NULL);
+    }
+
+    if (self->workgroup) os_release(self->workgroup);
+    pthread_mutex_destroy(&self->workgroupMutex);
+
+    dispatch_release(self->wakeSemaphore);
+    dispatch_release(self->doneSemaphore);
+
+    free(self->threads);
+    free(self);
+}
+
+
+size_t WorkerPoolGetThreadCount(WorkerPool *self)
+{
+    return self ? self->threadCount : 0;
+}
+
+
+void WorkerPoolSetWorkgroup(WorkerPool *self, os_workgroup_t workgroup)
+{
+    pthread_mutex_lock(&self->workgroupMutex);
+
+    if (workgroup) os_retain(workgroup);
+    if (self->workgroup) os_release(self->workgroup);
+    self->workgroup = workgroup;
+
+    pthread_mutex_unlock(&self->workgroupMutex);
+
+    atomic_fetch_add_explicit(&self->workgroupGeneration, 1, memory_order_release);
+
+    // Sleeping workers switch when they next wake
+    for (size_t i = 0; i < self->threadCount; i++) {
+        dispatch_semaphore_signal(self->wakeSemaphore);
+    }
+}
+
+
+void WorkerPoolSetPeriod(WorkerPool *self, double period)
+{
+    if (!self || period <= 0) return;
+
+    double spinDuration = period * sSpinPeriodFraction;
+    if (spinDuration > sMaxSpinDuration) spinDuration = sMaxSpinDuration;
+
+    int64_t waitNanoseconds = (int64_t)(period * sWaitPeriodFraction * NSEC_PER_SEC);
+    if (waitNanoseconds < 1) waitNanoseconds = 1;
+
+    atomic_store_explicit(&self->spinTicks, (uint64_t)(spinDuration * sGetTicksPerSecond()), memory_order_relaxed);
+    atomic_store_explicit(&self->waitNanoseconds, waitNanoseconds, memory_order_relaxed);
+}
+
+
+void WorkerPoolRun(WorkerPool *self, WorkerPoolFunction function, void *context, size_t count)
+{
+    bool serial = !self || self->threadCount == 0 || count < 2 || count > sMaxTaskCount;
+
+    // A task which itself calls WorkerPoolRun() runs its tasks serially
+    if (!serial && atomic_exchange_explicit(&self->busy, true, memory_order_acquire)) {
+        serial = true;
+    }
+
+    if (serial) {
+        for (size_t i = 0; i < count; i++) {
+            function(context, i);
+        }
+
+        return;
+    }
+
+    uint32_t sequence = ++self->sequence;
+
+    self->jobs[sequence & 1] = (WorkerPoolJob){ function, context };
+    atomic_store_explicit(&self->doneCount, 0, memory_order_relaxed);
+
+    // Publishes the job, and pairs with the sleeping count check in sWorkerMain()
+    atomic_store(&self->state, ((uint64_t)sequence << 32) | ((uint64_t)count << 16));
+
+    int sleepingCount = atomic_load(&self->sleepingCount);
+    int wakeCount = sleepingCount < (int)(count - 1) ? sleepingCount : (int)(count - 1);
+
+    for (int i = 0; i < wakeCount; i++) {
+        dispatch_semaphore_signal(self->wakeSemaphore);
+    }
+
+    sRunTasks(self);
+
+    // Wait for tasks which workers claimed but have not finished
+    uint64_t spinEnd = mach_absolute_time() + atomic_load_explicit(&self->spinTicks, memory_order_relaxed);
+
+    while (!sIsDone(self, count) && mach_absolute_time() < spinEnd) {
+        sPause();
+    }
+
+    if (!sIsDone(self, count)) {
+        int64_t waitNanoseconds = atomic_load_explicit(&self->waitNanoseconds, memory_order_relaxed);
+
+        atomic_store(&self->callerWaiting, true);
+
+        // The timeout only guards against a missed signal
+        while (atomic_load(&self->doneCount) != count) {
+            dispatch_semaphore_wait(self->doneSemaphore, dispatch_time(DISPATCH_TIME_NOW, waitNanoseconds));
+        }
+
+        atomic_store(&self->callerWaiting, false);
+    }
+
+    atomic_store_explicit(&self->busy, false, memory_order_release);
+}
@@ -0,0 +1,49 @@
+// (c) 2025-2026 Ricci Adams
+// MIT License (or) 1-clause BSD License
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <os/workgroup.h>
+
+/*
+    A small pool of real-time threads which help the render thread run
+    independent tasks (split branches, channel lists) within one callback.
+
+    WorkerPoolRun() publishes a job and then works on it alongside the
+    workers, so the job finishes even if no worker is scheduled in time.
+    Tasks are claimed with a compare-and-swap on a single word which holds
+    the job's sequence number, task count, and next index, so a worker that
+    wakes late can never run a task of a later job.
+
+    Idle workers spin briefly before waiting on a semaphore, and the render
+    thread only signals when a worker is waiting. The render thread also
+    spins before waiting for the last task to finish. Both spins are bounded
+    by time, a small fraction of the period passed to WorkerPoolSetPeriod().
+
+    Calls made while a job is running (from within a task) run serially.
+    Only one thread may call WorkerPoolRun() at a time.
+*/
+
+typedef struct WorkerPool WorkerPool;
+
+typedef void (*WorkerPoolFunction)(void *context, size_t index);
+
+extern WorkerPool *WorkerPoolCreate(size_t threadCount);
+extern void WorkerPoolFree(WorkerPool *self);
+
+extern size_t WorkerPoolGetThreadCount(WorkerPool *self);
+
+// Workers join the workgroup (such as the output device's) the next time they wake. Pass NULL to leave.
+extern void WorkerPoolSetWorkgroup(WorkerPool *self, os_workgroup_t workgroup);
+
+// The render callback's period in seconds. Scales how long threads spin before sleeping.
+extern void WorkerPoolSetPeriod(WorkerPool *self, double period);
+
+// Calls function(context, index) for each index below count and returns once all calls finish.
+// Does not allocate or lock.
+extern void WorkerPoolRun(WorkerPool *self, WorkerPoolFunction function, void *context, size_t count);
+
+#endif
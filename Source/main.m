@@ -3,7 +3,17 @@
 
 @import AppKit;
 
+#import "Benchmark.h"
+
 int main(int argc, const char * argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--benchmark") == 0) {
+            @autoreleasepool {
+                return BenchmarkMain(argc, argv);
+            }
+        }
+    }
+
     return NSApplicationMain(argc, argv);
 }